@@ -0,0 +1,192 @@
+#include <sstream>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include <rviz/properties/property.h>
+#include <rviz/properties/float_property.h>
+#include <rviz/properties/int_property.h>
+#include <rviz/properties/bool_property.h>
+
+#include "display_statistics.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+template<class T>
+std::string toString( const T& value )
+{
+  std::ostringstream ss;
+  ss << value;
+  return ss.str();
+}
+
+diagnostic_msgs::KeyValue keyValue( const std::string& key, const std::string& value )
+{
+  diagnostic_msgs::KeyValue kv;
+  kv.key = key;
+  kv.value = value;
+  return kv;
+}
+}
+
+const int DisplayStatistics::BUCKETS;
+
+DisplayStatistics::DisplayStatistics()
+  : received_( 0 )
+  , processed_( 0 )
+  , culled_( 0 )
+  , dropped_( 0 )
+  , visuals_( 0 )
+  , memory_( 0 )
+  , elapsed_( 0 )
+  , last_received_( 0 )
+  , statistics_property_( NULL )
+{
+  for( int i = 0; i < BUCKETS; i++ )
+  {
+    histogram_[i] = 0;
+  }
+}
+
+void DisplayStatistics::initialize( rviz::Property* parent )
+{
+  statistics_property_ = new rviz::Property( "Statistics", QVariant(),
+                                             "Performance of this display, refreshed once a second.",
+                                             parent );
+  rate_property_ = new rviz::FloatProperty( "Message Rate", 0, "Received messages per second.",
+                                            statistics_property_ );
+  processed_property_ = new rviz::IntProperty( "Processed", 0, "Messages applied to the scene.",
+                                               statistics_property_ );
+  dropped_property_ = new rviz::IntProperty( "Dropped", 0,
+                                             "Messages discarded before they were applied to the scene.",
+                                             statistics_property_ );
+  culled_property_ = new rviz::IntProperty( "Culled Elements", 0,
+                                            "Elements skipped by the culling settings before any other work.",
+                                            statistics_property_ );
+  p50_property_ = new rviz::FloatProperty( "Process Time p50 (ms)", 0,
+                                           "Median render-thread time per message in the last second.",
+                                           statistics_property_ );
+  p99_property_ = new rviz::FloatProperty( "Process Time p99 (ms)", 0,
+                                           "99th percentile render-thread time per message in the last second.",
+                                           statistics_property_ );
+  visuals_property_ = new rviz::IntProperty( "Visuals", 0, "WrenchVisuals currently alive, including the envelope. "
+                                             "The Batched render mode draws without them.",
+                                             statistics_property_ );
+  memory_property_ = new rviz::FloatProperty( "Memory (KiB)", 0,
+                                              "Estimated memory held for the shown wrenches.",
+                                              statistics_property_ );
+  // The values change once a second; they must neither mark the config
+  // modified nor end up in the saved file.
+  rviz::Property* values[] = { rate_property_, processed_property_, dropped_property_, culled_property_,
+                               p50_property_, p99_property_, visuals_property_, memory_property_ };
+  for( size_t i = 0; i < sizeof( values ) / sizeof( values[0] ); i++ )
+  {
+    values[i]->setReadOnly( true );
+    values[i]->setShouldBeSaved( false );
+  }
+
+  diagnostics_property_ = new rviz::BoolProperty( "Publish Diagnostics", false,
+                                                  "Also publish these values on /diagnostics once a second.",
+                                                  statistics_property_ );
+}
+
+void DisplayStatistics::processed( const ros::WallDuration& time )
+{
+  processed_.fetch_add( 1, std::memory_order_relaxed );
+  int64_t us = time.toNSec() / 1000;
+  int bucket = 0;
+  while( bucket < BUCKETS - 1 && us >= ( int64_t( 2 ) << bucket ))
+  {
+    bucket++;
+  }
+  histogram_[bucket].fetch_add( 1, std::memory_order_relaxed );
+}
+
+bool DisplayStatistics::due( float wall_dt )
+{
+  elapsed_ += wall_dt;
+  return elapsed_ >= 1.0f;
+}
+
+double DisplayStatistics::percentile( double p ) const
+{
+  uint64_t total = 0;
+  for( int i = 0; i < BUCKETS; i++ )
+  {
+    total += histogram_[i].load( std::memory_order_relaxed );
+  }
+  if( total == 0 )
+  {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>( p * total );
+  uint64_t count = 0;
+  for( int i = 0; i < BUCKETS; i++ )
+  {
+    count += histogram_[i].load( std::memory_order_relaxed );
+    if( count > rank )
+    {
+      return ( uint64_t( 2 ) << i ) * 1e-6;
+    }
+  }
+  return ( uint64_t( 2 ) << ( BUCKETS - 1 )) * 1e-6;
+}
+
+void DisplayStatistics::publish( ros::NodeHandle& nh, const std::string& name )
+{
+  uint64_t received = received_.load( std::memory_order_relaxed );
+  uint64_t processed = processed_.load( std::memory_order_relaxed );
+  uint64_t culled = culled_.load( std::memory_order_relaxed );
+  float rate = elapsed_ > 0 ? ( received - last_received_ ) / elapsed_ : 0;
+  last_received_ = received;
+  elapsed_ = 0;
+  double p50 = percentile( 0.5 );
+  double p99 = percentile( 0.99 );
+  for( int i = 0; i < BUCKETS; i++ )
+  {
+    histogram_[i].store( 0, std::memory_order_relaxed );
+  }
+
+  if( statistics_property_ )
+  {
+    rate_property_->setValue( rate );
+    processed_property_->setValue( static_cast<int>( processed ));
+    dropped_property_->setValue( static_cast<int>( dropped_ ));
+    culled_property_->setValue( static_cast<int>( culled ));
+    p50_property_->setValue( p50 * 1000 );
+    p99_property_->setValue( p99 * 1000 );
+    visuals_property_->setValue( static_cast<int>( visuals_ ));
+    memory_property_->setValue( memory_ / 1024.0 );
+  }
+
+  if( !statistics_property_ || !diagnostics_property_->getBool() )
+  {
+    diagnostics_pub_.shutdown();
+    return;
+  }
+  if( !diagnostics_pub_ )
+  {
+    diagnostics_pub_ = nh.advertise<diagnostic_msgs::DiagnosticArray>( "/diagnostics", 1 );
+  }
+
+  diagnostic_msgs::DiagnosticArray array;
+  array.header.stamp = ros::Time::now();
+  array.status.resize( 1 );
+  diagnostic_msgs::DiagnosticStatus& status = array.status[0];
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "my_rviz_plugin: " + name;
+  status.message = "OK";
+  status.values.push_back( keyValue( "message_rate", toString( rate )));
+  status.values.push_back( keyValue( "processed", toString( processed )));
+  status.values.push_back( keyValue( "dropped", toString( dropped_ )));
+  status.values.push_back( keyValue( "culled_elements", toString( culled )));
+  status.values.push_back( keyValue( "process_time_p50_ms", toString( p50 * 1000 )));
+  status.values.push_back( keyValue( "process_time_p99_ms", toString( p99 * 1000 )));
+  status.values.push_back( keyValue( "visuals", toString( visuals_ )));
+  status.values.push_back( keyValue( "memory_bytes", toString( memory_ )));
+  diagnostics_pub_.publish( array );
+}
+
+} // end namespace my_rviz_plugin
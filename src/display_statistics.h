@@ -0,0 +1,107 @@
+#ifndef MY_RVIZ_PLUGIN_DISPLAY_STATISTICS_H
+#define MY_RVIZ_PLUGIN_DISPLAY_STATISTICS_H
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+#include <ros/ros.h>
+
+namespace rviz
+{
+class Property;
+class FloatProperty;
+class IntProperty;
+class BoolProperty;
+}
+
+namespace my_rviz_plugin
+{
+
+// Cheap always-on statistics of a display.
+//
+// Counters and the processing time histogram are relaxed atomics, so
+// recording is a few uncontended increments and may happen on any thread.
+// Once a second publish() copies them to read-only properties under a
+// "Statistics" property and, if enabled, to diagnostic_msgs on
+// /diagnostics. The histogram is reset at every publish(), so the
+// percentiles describe the last second.
+class DisplayStatistics
+{
+public:
+  // Bucket i holds times in [2^i, 2^(i+1)) microseconds; the last bucket
+  // holds everything longer.
+  static const int BUCKETS = 24;
+
+  DisplayStatistics();
+
+  // Creates the properties as children of parent.
+  void initialize( rviz::Property* parent );
+
+  void received() { received_.fetch_add( 1, std::memory_order_relaxed ); }
+  void culled( size_t elements ) { culled_.fetch_add( elements, std::memory_order_relaxed ); }
+  void processed( const ros::WallDuration& time );
+
+  // Call from Display::update(). Returns true once a second; the display
+  // then sets the values it owns and calls publish().
+  bool due( float wall_dt );
+
+  void setDropped( size_t dropped ) { dropped_ = dropped; }
+  void setVisuals( size_t visuals ) { visuals_ = visuals; }
+  void setMemory( size_t bytes ) { memory_ = bytes; }
+
+  // name identifies the display on /diagnostics.
+  void publish( ros::NodeHandle& nh, const std::string& name );
+
+  // Percentile in seconds of the processing times since the last publish(),
+  // at the upper end of the bucket it falls into. 0 if nothing was recorded.
+  double percentile( double p ) const;
+
+private:
+  std::atomic<uint64_t> received_;
+  std::atomic<uint64_t> processed_;
+  std::atomic<uint64_t> culled_;
+  std::atomic<uint32_t> histogram_[BUCKETS];
+  size_t dropped_;
+  size_t visuals_;
+  size_t memory_;
+
+  float elapsed_;
+  uint64_t last_received_;
+
+  rviz::Property* statistics_property_;
+  rviz::FloatProperty* rate_property_;
+  rviz::IntProperty* processed_property_;
+  rviz::IntProperty* dropped_property_;
+  rviz::IntProperty* culled_property_;
+  rviz::FloatProperty* p50_property_;
+  rviz::FloatProperty* p99_property_;
+  rviz::IntProperty* visuals_property_;
+  rviz::FloatProperty* memory_property_;
+  rviz::BoolProperty* diagnostics_property_;
+  ros::Publisher diagnostics_pub_;
+};
+
+// Records the time until the end of the scope as one processed message.
+class ScopedProcessTimer
+{
+public:
+  explicit ScopedProcessTimer( DisplayStatistics& statistics )
+    : statistics_( statistics )
+    , start_( ros::WallTime::now() )
+  {
+  }
+
+  ~ScopedProcessTimer()
+  {
+    statistics_.processed( ros::WallTime::now() - start_ );
+  }
+
+private:
+  DisplayStatistics& statistics_;
+  ros::WallTime start_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_DISPLAY_STATISTICS_H
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "event_trace.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+uint32_t threadId()
+{
+  static thread_local uint32_t id = syscall( SYS_gettid );
+  return id;
+}
+}
+
+const size_t EventTrace::CAPACITY;
+
+EventTrace::EventTrace()
+  : next_( 0 )
+  , enabled_( false )
+{
+}
+
+void EventTrace::setEnabled( bool enabled )
+{
+  if( enabled && !enabled_ )
+  {
+    if( !events_ )
+    {
+      events_.reset( new Event[CAPACITY] );
+    }
+    for( size_t i = 0; i < CAPACITY; i++ )
+    {
+      events_[i].sequence.store( 0, std::memory_order_relaxed );
+    }
+    next_ = 0;
+  }
+  enabled_ = enabled;
+}
+
+void EventTrace::complete( const char* name, const ros::WallTime& start, const ros::WallTime& end, uint64_t arg )
+{
+  if( !enabled() )
+  {
+    return;
+  }
+  int64_t begin = start.toNSec();
+  record( name, 'X', begin, end.toNSec() - begin, arg );
+}
+
+void EventTrace::instant( const char* name, uint64_t arg )
+{
+  if( enabled() )
+  {
+    record( name, 'i', ros::WallTime::now().toNSec(), 0, arg );
+  }
+}
+
+void EventTrace::record( const char* name, char phase, int64_t start, int64_t duration, uint64_t arg )
+{
+  uint64_t index = next_.fetch_add( 1, std::memory_order_relaxed );
+  Event& event = events_[index % CAPACITY];
+  event.sequence.store( 0, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+  event.data.name = name;
+  event.data.phase = phase;
+  event.data.thread = threadId();
+  event.data.start = start;
+  event.data.duration = duration;
+  event.data.arg = arg;
+  event.sequence.store( index + 1, std::memory_order_release );
+}
+
+void EventTrace::copy( std::vector<TraceEvent>& events ) const
+{
+  events.clear();
+  uint64_t end = events_ ? next_.load( std::memory_order_acquire ) : 0;
+  uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+  events.reserve( end - begin );
+  for( uint64_t i = begin; i < end; i++ )
+  {
+    const Event& event = events_[i % CAPACITY];
+    if( event.sequence.load( std::memory_order_acquire ) != i + 1 )
+    {
+      continue;
+    }
+    TraceEvent data = event.data;
+    std::atomic_thread_fence( std::memory_order_acquire );
+    // Overwritten while it was copied.
+    if( event.sequence.load( std::memory_order_relaxed ) != i + 1 )
+    {
+      continue;
+    }
+    events.push_back( data );
+  }
+}
+
+long EventTrace::write( const std::string& path ) const
+{
+  std::vector<TraceEvent> events;
+  copy( events );
+  return write( path, events );
+}
+
+long EventTrace::write( const std::string& path, const std::vector<TraceEvent>& events )
+{
+  FILE* file = std::fopen( path.c_str(), "w" );
+  if( !file )
+  {
+    return -1;
+  }
+  std::fprintf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+  long written = 0;
+  int pid = getpid();
+  for( size_t i = 0; i < events.size(); i++ )
+  {
+    const TraceEvent& event = events[i];
+    // Chrome trace timestamps are in microseconds.
+    std::fprintf( file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f",
+                  written ? "," : "", event.name, event.phase, pid, event.thread, event.start * 1e-3 );
+    if( event.phase == 'X' )
+    {
+      std::fprintf( file, ",\"dur\":%.3f", event.duration * 1e-3 );
+    }
+    else
+    {
+      std::fprintf( file, ",\"s\":\"t\"" );
+    }
+    std::fprintf( file, ",\"args\":{\"n\":%llu}}", static_cast<unsigned long long>( event.arg ));
+    written++;
+  }
+  std::fprintf( file, "\n]}\n" );
+  if( std::fclose( file ) != 0 )
+  {
+    return -1;
+  }
+  return written;
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,124 @@
+#ifndef MY_RVIZ_PLUGIN_EVENT_TRACE_H
+#define MY_RVIZ_PLUGIN_EVENT_TRACE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_array.hpp>
+#endif
+
+#include <ros/ros.h>
+
+namespace my_rviz_plugin
+{
+
+struct TraceEvent
+{
+  // Names are string literals, so only the pointer is kept.
+  const char* name;
+  char phase;
+  uint32_t thread;
+  int64_t start;
+  int64_t duration;
+  uint64_t arg;
+};
+
+// Timeline of what a display did, for finding out why a frame hitched.
+//
+// Events go into a fixed-size ring; once it is full the oldest events are
+// overwritten. Any thread may record, a slot is claimed with one atomic
+// increment. write() exports the ring as Chrome trace JSON, which
+// chrome://tracing and Perfetto open; to keep the file writing off a
+// thread, copy() the ring there and write the copy elsewhere. While disabled, recording costs one
+// relaxed load and the ring is not even allocated.
+class EventTrace
+{
+public:
+  static const size_t CAPACITY = 65536;
+
+  EventTrace();
+
+  // Enabling starts a new, empty trace.
+  void setEnabled( bool enabled );
+  bool enabled() const { return enabled_.load( std::memory_order_relaxed ); }
+
+  // Records an event that lasted from start to end, on the calling thread.
+  // arg is shown with the event, e.g. a number of elements.
+  void complete( const char* name, const ros::WallTime& start, const ros::WallTime& end, uint64_t arg = 0 );
+  // Records an event without duration.
+  void instant( const char* name, uint64_t arg = 0 );
+
+  // Copies the events in the ring into events, oldest first. Events still
+  // being recorded by another thread are left out.
+  void copy( std::vector<TraceEvent>& events ) const;
+  // Writes events to path. Returns the number of events written, or -1 if
+  // the file could not be written.
+  static long write( const std::string& path, const std::vector<TraceEvent>& events );
+  // Both at once.
+  long write( const std::string& path ) const;
+
+private:
+  struct Event
+  {
+    // Index of the event plus one once it is complete, 0 while written.
+    std::atomic<uint64_t> sequence;
+    TraceEvent data;
+  };
+
+  void record( const char* name, char phase, int64_t start, int64_t duration, uint64_t arg );
+
+  // Allocated when the trace is first enabled and kept from then on, so
+  // that a thread still recording never writes to freed memory.
+  boost::scoped_array<Event> events_;
+  std::atomic<uint64_t> next_;
+  std::atomic<bool> enabled_;
+};
+
+// Records the time until the end of the scope as one event, if the trace
+// is enabled when the scope is entered.
+class TraceScope
+{
+public:
+  TraceScope( EventTrace* trace, const char* name, uint64_t arg = 0 )
+    : trace_( trace && trace->enabled() ? trace : NULL )
+    , name_( name )
+    , arg_( arg )
+  {
+    if( trace_ )
+    {
+      start_ = ros::WallTime::now();
+    }
+  }
+
+  ~TraceScope()
+  {
+    end();
+  }
+
+  // Records the event now instead of at the end of the scope.
+  void end()
+  {
+    if( trace_ )
+    {
+      trace_->complete( name_, start_, ros::WallTime::now(), arg_ );
+      trace_ = NULL;
+    }
+  }
+
+  void setArg( uint64_t arg ) { arg_ = arg; }
+  // Drops the event, e.g. when the scope turned out to do nothing.
+  void cancel() { trace_ = NULL; }
+
+private:
+  EventTrace* trace_;
+  const char* name_;
+  uint64_t arg_;
+  ros::WallTime start_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_EVENT_TRACE_H
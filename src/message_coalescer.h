@@ -0,0 +1,81 @@
+#ifndef MY_RVIZ_PLUGIN_MESSAGE_COALESCER_H
+#define MY_RVIZ_PLUGIN_MESSAGE_COALESCER_H
+
+#ifndef Q_MOC_RUN
+#include <boost/circular_buffer.hpp>
+#endif
+
+namespace my_rviz_plugin
+{
+
+// Keeps only the newest messages that can still be seen after the next
+// render frame. A display with History Length n never shows more than the
+// last n messages, so older ones are dropped before any validation, TF or
+// Ogre work is done for them.
+template<class MessageType>
+class MessageCoalescer
+{
+public:
+  typedef typename MessageType::ConstPtr MessageConstPtr;
+
+  MessageCoalescer()
+    : pending_( 1 )
+    , coalesced_( 0 )
+    , elapsed_( 0 )
+  {
+  }
+
+  void setCapacity( size_t capacity )
+  {
+    while( pending_.size() > capacity )
+    {
+      pending_.pop_front();
+      coalesced_++;
+    }
+    pending_.set_capacity( capacity );
+  }
+
+  void push( const MessageConstPtr& msg )
+  {
+    if( pending_.full() )
+    {
+      coalesced_++;
+    }
+    pending_.push_back( msg );
+  }
+
+  // Hands the pending messages, oldest first, to process() if at least
+  // 1/max_rate seconds passed since the last flush. max_rate <= 0 flushes
+  // on every call.
+  template<class Function>
+  void flush( float wall_dt, float max_rate, Function process )
+  {
+    elapsed_ += wall_dt;
+    if( max_rate > 0 && elapsed_ < 1.0f / max_rate )
+    {
+      return;
+    }
+    elapsed_ = 0;
+    for( size_t i = 0; i < pending_.size(); i++ )
+    {
+      process( pending_[i] );
+    }
+    pending_.clear();
+  }
+
+  void clear()
+  {
+    pending_.clear();
+  }
+
+  size_t coalesced() const { return coalesced_; }
+
+private:
+  boost::circular_buffer<MessageConstPtr> pending_;
+  size_t coalesced_;
+  float elapsed_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_MESSAGE_COALESCER_H
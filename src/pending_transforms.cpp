@@ -0,0 +1,99 @@
+#include "pending_transforms.h"
+
+namespace my_rviz_plugin
+{
+
+PendingTransforms::PendingTransforms()
+  : timeout_( 0 )
+  , capacity_( 10000 )
+  , message_capacity_( 1000 )
+  , waiting_( 0 )
+  , resolved_late_( 0 )
+  , expired_( 0 )
+  , dropped_( 0 )
+{
+}
+
+void PendingTransforms::setCapacity( size_t elements, size_t messages )
+{
+  capacity_ = elements;
+  message_capacity_ = messages;
+  enforceCapacity();
+}
+
+void PendingTransforms::push( const WrenchRecordBatch& batch, const ros::WallTime& now )
+{
+  messages_.push_back( Message() );
+  Message& message = messages_.back();
+  message.stamp = batch.stamp;
+  message.glyphs = batch.glyphs;
+  message.indices = batch.elements;
+  message.elements = batch.unresolved;
+  message.deadline = now + ros::WallDuration( timeout_ );
+  waiting_ += batch.unresolved.size();
+  enforceCapacity();
+}
+
+void PendingTransforms::clear()
+{
+  messages_.clear();
+  waiting_ = 0;
+}
+
+void PendingTransforms::retry( TransformSource& source, TransformCache& cache, const ros::WallTime& now )
+{
+  if( waiting_ == 0 )
+  {
+    return;
+  }
+  cache.beginMessage();
+  for( size_t m = 0; m < messages_.size(); m++ )
+  {
+    Message& message = messages_[m];
+    bool expired = now >= message.deadline;
+    size_t kept = 0;
+    for( size_t i = 0; i < message.elements.size(); i++ )
+    {
+      const UnresolvedWrench& element = message.elements[i];
+      WrenchGlyph glyph;
+      if( cache.getTransform( source, element.frame, element.stamp, glyph.position, glyph.orientation ) &&
+          !glyph.position.isNaN() )
+      {
+        glyph.force = element.force;
+        glyph.torque = element.torque;
+        message.glyphs.push_back( glyph );
+        message.indices.push_back( element.element );
+        resolved_late_++;
+        waiting_--;
+      }
+      else if( expired )
+      {
+        expired_++;
+        waiting_--;
+      }
+      else
+      {
+        if( kept != i )
+        {
+          message.elements[kept] = element;
+        }
+        kept++;
+      }
+    }
+    message.elements.resize( kept );
+  }
+}
+
+// Messages without waiting elements are handed on by the next process().
+void PendingTransforms::enforceCapacity()
+{
+  for( size_t m = 0; m < messages_.size() &&
+       ( waiting_ > capacity_ || messages_.size() - m > message_capacity_ ); m++ )
+  {
+    dropped_ += messages_[m].elements.size();
+    waiting_ -= messages_[m].elements.size();
+    messages_[m].elements.clear();
+  }
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,92 @@
+#ifndef MY_RVIZ_PLUGIN_PENDING_TRANSFORMS_H
+#define MY_RVIZ_PLUGIN_PENDING_TRANSFORMS_H
+
+#include <deque>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "wrench_elements.h"
+
+namespace my_rviz_plugin
+{
+
+// Messages with elements whose transform was not available yet.
+//
+// The MessageFilter of a display only waits for the frame of the array
+// header, so element frames that lag behind in tf would otherwise be lost.
+// Here such elements wait up to a timeout and are retried once per frame,
+// all lookups of a pass going through one TransformCache so that elements
+// sharing a frame and stamp cost one lookup. A message is handed on, in
+// arrival order, once all of its elements are resolved or expired; later
+// messages wait behind it so that the history stays in order. Both the
+// waiting elements and the queued messages are bounded.
+class PendingTransforms
+{
+public:
+  PendingTransforms();
+
+  // timeout <= 0 disables waiting.
+  void setTimeout( double seconds ) { timeout_ = seconds; }
+  double timeout() const { return timeout_; }
+  // Beyond elements waiting elements or messages queued messages, the
+  // elements of the oldest messages are dropped.
+  void setCapacity( size_t elements, size_t messages );
+
+  bool empty() const { return messages_.empty(); }
+
+  // Queues the resolved glyphs of batch together with its unresolved elements.
+  void push( const WrenchRecordBatch& batch, const ros::WallTime& now );
+
+  // Retries the waiting elements and calls apply( stamp, glyphs, elements )
+  // for the messages that are complete, oldest first, where elements[k] is
+  // the index of glyphs[k] in the whole array.
+  template<class Function>
+  void process( TransformSource& source, TransformCache& cache, const ros::WallTime& now,
+                Function apply )
+  {
+    retry( source, cache, now );
+    while( !messages_.empty() && messages_.front().elements.empty() )
+    {
+      apply( messages_.front().stamp, messages_.front().glyphs, messages_.front().indices );
+      messages_.pop_front();
+    }
+  }
+
+  void clear();
+
+  // Elements currently waiting.
+  size_t waiting() const { return waiting_; }
+  size_t resolvedLate() const { return resolved_late_; }
+  size_t expired() const { return expired_; }
+  // Elements dropped because of the capacity.
+  size_t dropped() const { return dropped_; }
+
+private:
+  struct Message
+  {
+    ros::Time stamp;
+    std::vector<WrenchGlyph> glyphs;
+    std::vector<uint32_t> indices;
+    std::vector<UnresolvedWrench> elements;
+    ros::WallTime deadline;
+  };
+
+  void retry( TransformSource& source, TransformCache& cache, const ros::WallTime& now );
+  // Gives up on the elements of the oldest messages until at most
+  // capacity_ elements wait in at most message_capacity_ messages.
+  void enforceCapacity();
+
+  std::deque<Message> messages_;
+  double timeout_;
+  size_t capacity_;
+  size_t message_capacity_;
+  size_t waiting_;
+  size_t resolved_late_;
+  size_t expired_;
+  size_t dropped_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_PENDING_TRANSFORMS_H
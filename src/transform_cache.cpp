@@ -0,0 +1,69 @@
+#include "transform_cache.h"
+
+namespace my_rviz_plugin
+{
+
+TransformCache::TransformCache( size_t capacity )
+  : capacity_( capacity )
+  , message_( 0 )
+  , hits_( 0 )
+  , misses_( 0 )
+{
+  entries_.reserve( capacity_ );
+}
+
+void TransformCache::beginMessage()
+{
+  message_++;
+}
+
+bool TransformCache::getTransform( TransformSource& source,
+                                   const std::string& frame, const ros::Time& stamp,
+                                   Ogre::Vector3& position, Ogre::Quaternion& orientation )
+{
+  Entry* victim = NULL;
+  for( size_t i = 0; i < entries_.size(); i++ )
+  {
+    Entry& entry = entries_[i];
+    // "latest" and failures may change between messages.
+    bool reusable = entry.created == message_ || ( entry.valid && !entry.stamp.isZero() );
+    if( reusable && entry.stamp == stamp && entry.frame == frame )
+    {
+      entry.used = message_;
+      hits_++;
+      position = entry.position;
+      orientation = entry.orientation;
+      return entry.valid;
+    }
+    if( !reusable )
+    {
+      entry.used = 0;
+    }
+    if( victim == NULL || entry.used < victim->used )
+    {
+      victim = &entry;
+    }
+  }
+
+  misses_++;
+  if( entries_.size() < capacity_ )
+  {
+    entries_.push_back( Entry() );
+    victim = &entries_.back();
+  }
+  victim->frame = frame;
+  victim->stamp = stamp;
+  victim->valid = source.getTransform( frame, stamp, victim->position, victim->orientation );
+  victim->used = message_;
+  victim->created = message_;
+  position = victim->position;
+  orientation = victim->orientation;
+  return victim->valid;
+}
+
+void TransformCache::clear()
+{
+  entries_.clear();
+}
+
+} // end namespace my_rviz_plugin
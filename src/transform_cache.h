@@ -0,0 +1,61 @@
+#ifndef MY_RVIZ_PLUGIN_TRANSFORM_CACHE_H
+#define MY_RVIZ_PLUGIN_TRANSFORM_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "transform_source.h"
+
+namespace my_rviz_plugin
+{
+
+// Cache of fixed-frame transforms keyed by (frame_id, stamp).
+//
+// Lookups are deduplicated within a message and successful ones are kept
+// across messages, since a transform at a given stamp does not change.
+// Results for stamp 0 ("latest") and failed lookups are only reused
+// within the message that produced them. The cache must be cleared when
+// the fixed frame changes.
+class TransformCache
+{
+public:
+  explicit TransformCache( size_t capacity = 64 );
+
+  // Call once per message before the lookups of that message.
+  void beginMessage();
+
+  // Same contract as TransformSource::getTransform().
+  bool getTransform( TransformSource& source,
+                     const std::string& frame, const ros::Time& stamp,
+                     Ogre::Vector3& position, Ogre::Quaternion& orientation );
+
+  // Drops every entry, e.g. when the fixed frame changed.
+  void clear();
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+private:
+  struct Entry
+  {
+    std::string frame;
+    ros::Time stamp;
+    Ogre::Vector3 position;
+    Ogre::Quaternion orientation;
+    bool valid;
+    // Message in which the entry was last used, for LRU replacement and
+    // for expiring per-message entries.
+    unsigned long used;
+    unsigned long created;
+  };
+
+  std::vector<Entry> entries_;
+  size_t capacity_;
+  unsigned long message_;
+  size_t hits_;
+  size_t misses_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_TRANSFORM_CACHE_H
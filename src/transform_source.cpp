@@ -0,0 +1,24 @@
+#include <rviz/frame_manager.h>
+
+#include "transform_source.h"
+
+namespace my_rviz_plugin
+{
+
+FrameManagerTransformSource::FrameManagerTransformSource( rviz::FrameManager* frame_manager )
+  : frame_manager_( frame_manager )
+{
+}
+
+void FrameManagerTransformSource::setFrameManager( rviz::FrameManager* frame_manager )
+{
+  frame_manager_ = frame_manager;
+}
+
+bool FrameManagerTransformSource::getTransform( const std::string& frame, const ros::Time& stamp,
+                                                Ogre::Vector3& position, Ogre::Quaternion& orientation )
+{
+  return frame_manager_->getTransform( frame, stamp, position, orientation );
+}
+
+} // end namespace my_rviz_plugin
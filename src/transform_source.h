@@ -0,0 +1,47 @@
+#ifndef MY_RVIZ_PLUGIN_TRANSFORM_SOURCE_H
+#define MY_RVIZ_PLUGIN_TRANSFORM_SOURCE_H
+
+#include <string>
+
+#include <ros/time.h>
+#include <OgreVector3.h>
+#include <OgreQuaternion.h>
+
+namespace rviz
+{
+class FrameManager;
+}
+
+namespace my_rviz_plugin
+{
+
+// Where the message processing gets fixed-frame transforms from. The
+// displays use the rviz::FrameManager; anything else, e.g. a table of
+// fixed poses, lets the same processing run without tf or a render window.
+class TransformSource
+{
+public:
+  virtual ~TransformSource() {}
+
+  // Same contract as rviz::FrameManager::getTransform().
+  virtual bool getTransform( const std::string& frame, const ros::Time& stamp,
+                             Ogre::Vector3& position, Ogre::Quaternion& orientation ) = 0;
+};
+
+class FrameManagerTransformSource : public TransformSource
+{
+public:
+  explicit FrameManagerTransformSource( rviz::FrameManager* frame_manager = NULL );
+
+  void setFrameManager( rviz::FrameManager* frame_manager );
+
+  virtual bool getTransform( const std::string& frame, const ros::Time& stamp,
+                             Ogre::Vector3& position, Ogre::Quaternion& orientation );
+
+private:
+  rviz::FrameManager* frame_manager_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_TRANSFORM_SOURCE_H
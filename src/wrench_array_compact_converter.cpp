@@ -0,0 +1,33 @@
+// Republishes WrenchStampedArray messages as WrenchStampedArrayCompact.
+//
+//   rosrun my_rviz_plugin wrench_array_compact_converter input:=/wrenches output:=/wrenches_compact
+
+#include <ros/ros.h>
+
+#include "wrench_compact_conversion.h"
+
+namespace
+{
+ros::Publisher g_publisher;
+
+void callback( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+{
+  my_rviz_plugin::WrenchStampedArrayCompact compact;
+  if( !my_rviz_plugin::toCompact( *msg, compact ))
+  {
+    ROS_ERROR_THROTTLE( 1.0, "Dropping an array with more than 65536 distinct frame ids" );
+    return;
+  }
+  g_publisher.publish( compact );
+}
+}
+
+int main( int argc, char** argv )
+{
+  ros::init( argc, argv, "wrench_array_compact_converter" );
+  ros::NodeHandle nh;
+  g_publisher = nh.advertise<my_rviz_plugin::WrenchStampedArrayCompact>( "output", 10 );
+  ros::Subscriber subscriber = nh.subscribe( "input", 10, callback );
+  ros::spin();
+  return 0;
+}
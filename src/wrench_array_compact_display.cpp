@@ -0,0 +1,119 @@
+//from https://github.com/ros-visualization/rviz/blob/kinetic-devel/src/rviz/default_plugin/wrench_display.cpp
+
+/*
+Upstream Authors (2005-2009):
+
+    Ulisse Perusin <uli.peru@gmail.com>
+    Steven Garrity <sgarrity@silverorange.com>
+    Lapo Calamandrei <calamandrei@gmail.com>
+    Ryan Collier <rcollier@novell.com>
+    Rodney Dawes <dobey@novell.com>
+    Andreas Nilsson <nisses.mail@home.se>
+    Tuomas Kuosmanen <tigert@tigert.com>
+    Garrett LeSage <garrett@novell.com>
+    Jakub Steiner <jimmac@novell.com>
+
+Other icons and graphics contained in this package are released into the Public Domain as well.
+
+Authors (2012-2017):
+
+    David Gossow
+    Chad Rockey
+    Kei Okada
+    Julius Kammerl
+    Acorn Pooley
+
+Copyright notice for all icons and graphics in this package:
+
+Public Domain Dedication
+
+Copyright-Only Dedication (based on United States law) or Public Domain
+Certification
+
+The person or persons who have associated work with this document (the
+"Dedicator" or "Certifier") hereby either (a) certifies that, to the best
+of his knowledge, the work of authorship identified is in the public
+domain of the country from which the work is published, or (b)
+hereby dedicates whatever copyright the dedicators holds in the work
+of authorship identified below (the "Work") to the public domain. A
+certifier, moreover, dedicates any copyright interest he may have in
+the associated work, and for these purposes, is described as a
+"dedicator" below.
+
+A certifier has taken reasonable steps to verify the copyright
+status of this work. Certifier recognizes that his good faith efforts
+may not shield him from liability if in fact the work certified is not
+in the public domain.
+
+Dedicator makes this dedication for the benefit of the public at
+large and to the detriment of the Dedicator's heirs and successors.
+Dedicator intends this dedication to be an overt act of relinquishment
+in perpetuity of all present and future rights under copyright law,
+whether vested or contingent, in the Work. Dedicator understands that
+such relinquishment of all rights includes the relinquishment of all
+rights to enforce (by lawsuit or otherwise) those copyrights in the
+Work.
+
+Dedicator recognizes that, once placed in the public domain, the Work
+may be freely reproduced, distributed, transmitted, used, modified,
+built upon, or otherwise exploited by anyone for any purpose, commercial
+or non-commercial, and in any way, including by methods that have not
+yet been invented or conceived.
+
+ */
+
+#include "wrench_array_compact_display.h"
+
+namespace my_rviz_plugin
+{
+
+WrenchStampedArrayCompactDisplay::WrenchStampedArrayCompactDisplay()
+  : engine_( this )
+{
+}
+
+void WrenchStampedArrayCompactDisplay::onInitialize()
+{
+    MFDClass::onInitialize();
+    sub_.registerCallback( boost::bind( &WrenchDisplayEngine<WrenchStampedArrayCompactElements>::receiveMessage,
+                                        &engine_, _1 ));
+    engine_.initialize( context_, scene_node_ );
+}
+
+WrenchStampedArrayCompactDisplay::~WrenchStampedArrayCompactDisplay()
+{
+}
+
+// Override rviz::Display's reset() function to add a call to clear().
+void WrenchStampedArrayCompactDisplay::reset()
+{
+    MFDClass::reset();
+    engine_.reset();
+}
+
+void WrenchStampedArrayCompactDisplay::update( float wall_dt, float ros_dt )
+{
+    MFDClass::update( wall_dt, ros_dt );
+    engine_.update( wall_dt );
+    engine_.updateStatistics( wall_dt, update_nh_, 0 );
+}
+
+// Cached transforms are relative to the old fixed frame.
+void WrenchStampedArrayCompactDisplay::fixedFrameChanged()
+{
+    engine_.fixedFrameChanged();
+    MFDClass::fixedFrameChanged();
+}
+
+// This is our callback to handle an incoming message.
+void WrenchStampedArrayCompactDisplay::processMessage( const my_rviz_plugin::WrenchStampedArrayCompact::ConstPtr& msg )
+{
+  engine_.processMessage( msg );
+}
+
+} // end namespace my_rviz_plugin
+
+// Tell pluginlib about this class.  It is important to do this in
+// global scope, outside our package's namespace.
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( my_rviz_plugin::WrenchStampedArrayCompactDisplay, rviz::Display )
@@ -0,0 +1,104 @@
+//from https://github.com/ros-visualization/rviz/blob/kinetic-devel/src/rviz/default_plugin/wrench_display.h
+
+/*
+Upstream Authors (2005-2009):
+
+    Ulisse Perusin <uli.peru@gmail.com>
+    Steven Garrity <sgarrity@silverorange.com>
+    Lapo Calamandrei <calamandrei@gmail.com>
+    Ryan Collier <rcollier@novell.com>
+    Rodney Dawes <dobey@novell.com>
+    Andreas Nilsson <nisses.mail@home.se>
+    Tuomas Kuosmanen <tigert@tigert.com>
+    Garrett LeSage <garrett@novell.com>
+    Jakub Steiner <jimmac@novell.com>
+
+Other icons and graphics contained in this package are released into the Public Domain as well.
+
+Authors (2012-2017):
+
+    David Gossow
+    Chad Rockey
+    Kei Okada
+    Julius Kammerl
+    Acorn Pooley
+
+Copyright notice for all icons and graphics in this package:
+
+  Public Domain Dedication
+
+Copyright-Only Dedication (based on United States law) or Public Domain
+Certification
+
+The person or persons who have associated work with this document (the
+"Dedicator" or "Certifier") hereby either (a) certifies that, to the best
+of his knowledge, the work of authorship identified is in the public
+domain of the country from which the work is published, or (b)
+hereby dedicates whatever copyright the dedicators holds in the work
+of authorship identified below (the "Work") to the public domain. A
+certifier, moreover, dedicates any copyright interest he may have in
+the associated work, and for these purposes, is described as a
+"dedicator" below.
+
+A certifier has taken reasonable steps to verify the copyright
+status of this work. Certifier recognizes that his good faith efforts
+may not shield him from liability if in fact the work certified is not
+in the public domain.
+
+Dedicator makes this dedication for the benefit of the public at
+large and to the detriment of the Dedicator's heirs and successors.
+Dedicator intends this dedication to be an overt act of relinquishment
+in perpetuity of all present and future rights under copyright law,
+whether vested or contingent, in the Work. Dedicator understands that
+such relinquishment of all rights includes the relinquishment of all
+rights to enforce (by lawsuit or otherwise) those copyrights in the
+Work.
+
+Dedicator recognizes that, once placed in the public domain, the Work
+may be freely reproduced, distributed, transmitted, used, modified,
+built upon, or otherwise exploited by anyone for any purpose, commercial
+or non-commercial, and in any way, including by methods that have not
+yet been invented or conceived.
+
+
+ */
+
+#ifndef MY_RVIZ_PLUGIN_WRENCHSTAMPEDARRAYCOMPACT_DISPLAY_H
+#define MY_RVIZ_PLUGIN_WRENCHSTAMPEDARRAYCOMPACT_DISPLAY_H
+
+#include <my_rviz_plugin/WrenchStampedArrayCompact.h>
+#include <rviz/message_filter_display.h>
+#include "wrench_display_engine.h"
+
+namespace my_rviz_plugin
+{
+
+// Same as WrenchStampedArrayDisplay for the structure-of-arrays message.
+// Elements are read straight from the flat arrays, no WrenchStamped is
+// built for them.
+class WrenchStampedArrayCompactDisplay: public rviz::MessageFilterDisplay<my_rviz_plugin::WrenchStampedArrayCompact>
+{
+    Q_OBJECT
+public:
+    // Constructor.  pluginlib::ClassLoader creates instances by calling
+    // the default constructor, so make sure you have one.
+    WrenchStampedArrayCompactDisplay();
+    virtual ~WrenchStampedArrayCompactDisplay();
+
+protected:
+    // Overrides of public virtual functions from the Display class.
+    virtual void onInitialize();
+    virtual void reset();
+    virtual void update( float wall_dt, float ros_dt );
+    virtual void fixedFrameChanged();
+
+private:
+  // Function to handle an incoming ROS message.
+  void processMessage( const my_rviz_plugin::WrenchStampedArrayCompact::ConstPtr& msg );
+
+  // History, rendering and the properties shared with the other wrench displays.
+  WrenchDisplayEngine<WrenchStampedArrayCompactElements> engine_;
+};
+} // end namespace rviz_plugin_tutorials
+
+#endif // MY_RVIZ_PLUGIN_WRENCHSTAMPED_DISPLAY_H
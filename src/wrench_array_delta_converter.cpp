@@ -0,0 +1,45 @@
+// Republishes WrenchStampedArray messages as WrenchStampedArrayDelta.
+//
+//   rosrun my_rviz_plugin wrench_array_delta_converter input:=/wrenches output:=/wrenches_delta
+//       _force_threshold:=0.5 _torque_threshold:=0.05 _keyframe_interval:=100
+
+#include <ros/ros.h>
+
+#include "wrench_delta_encoder.h"
+
+namespace
+{
+ros::Publisher g_publisher;
+my_rviz_plugin::WrenchDeltaEncoder g_encoder;
+
+void callback( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+{
+  my_rviz_plugin::WrenchStampedArrayDelta delta;
+  g_encoder.encode( *msg, delta );
+  g_publisher.publish( delta );
+}
+
+// A receiver that subscribes late gets a keyframe right away.
+void connected( const ros::SingleSubscriberPublisher& )
+{
+  g_encoder.requestKeyframe();
+}
+}
+
+int main( int argc, char** argv )
+{
+  ros::init( argc, argv, "wrench_array_delta_converter" );
+  ros::NodeHandle nh;
+  ros::NodeHandle private_nh( "~" );
+  double force_threshold, torque_threshold;
+  int keyframe_interval;
+  private_nh.param( "force_threshold", force_threshold, 0.5 );
+  private_nh.param( "torque_threshold", torque_threshold, 0.05 );
+  private_nh.param( "keyframe_interval", keyframe_interval, 100 );
+  g_encoder.setThresholds( force_threshold, torque_threshold );
+  g_encoder.setKeyframeInterval( keyframe_interval > 0 ? keyframe_interval : 0 );
+  g_publisher = nh.advertise<my_rviz_plugin::WrenchStampedArrayDelta>( "output", 10, connected );
+  ros::Subscriber subscriber = nh.subscribe( "input", 10, callback );
+  ros::spin();
+  return 0;
+}
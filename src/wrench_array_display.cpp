@@ -62,20 +62,11 @@ yet been invented or conceived.
 
  */
 
-#include <OgreSceneNode.h>
-#include <OgreSceneManager.h>
+#include <rviz/properties/bool_property.h>
+#include <rviz/properties/string_property.h>
+#include <rviz/properties/ros_topic_property.h>
 
-#include <rviz/visualization_manager.h>
-#include <rviz/frame_manager.h>
-#include <rviz/properties/color_property.h>
-#include <rviz/properties/float_property.h>
-#include <rviz/properties/int_property.h>
-#include <rviz/properties/parse_color.h>
-#include <rviz/validate_floats.h>
-
-#include <boost/foreach.hpp>
-
-#include <rviz/default_plugin/wrench_visual.h>
+#include <boost/bind.hpp>
 
 #include "wrench_array_display.h"
 
@@ -83,166 +74,264 @@ namespace my_rviz_plugin
 {
 
 WrenchStampedArrayDisplay::WrenchStampedArrayDisplay()
+  : engine_( this )
+  , shm_idle_( 0 )
 {
-    force_color_property_ =
-            new rviz::ColorProperty( "Force Color", QColor( 204, 51, 51 ),
-                                     "Color to draw the force arrows.",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    torque_color_property_ =
-            new rviz::ColorProperty( "Torque Color", QColor( 204, 204, 51),
-                                     "Color to draw the torque arrows.",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    alpha_property_ =
-            new rviz::FloatProperty( "Alpha", 1.0,
-                                     "0 is fully transparent, 1.0 is fully opaque.",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    force_scale_property_ =
-            new rviz::FloatProperty( "Force Arrow Scale", 2.0,
-                                     "force arrow scale",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    torque_scale_property_ =
-            new rviz::FloatProperty( "Torque Arrow Scale", 2.0,
-                                     "torque arrow scale",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    width_property_ =
-            new rviz::FloatProperty( "Arrow Width", 0.5,
-                                     "arrow width",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-
-    history_length_property_ =
-            new rviz::IntProperty( "History Length", 1,
-                                   "Number of prior measurements to display.",
-                                   this, SLOT( updateHistoryLength() ));
-
-    history_length_property_->setMin( 1 );
-    history_length_property_->setMax( 100000 );
+    threaded_property_ =
+            new rviz::BoolProperty( "Threaded Processing", false,
+                                    "Validate messages and resolve transforms on a worker thread. "
+                                    "Only applying the result to the scene is left to the render thread.",
+                                    this, SLOT( updateThreadedProcessing() ));
+
+    shm_property_ =
+            new rviz::StringProperty( "Shared Memory", "",
+                                      "Name of a shared-memory segment written by a WrenchShmWriter on this host. "
+                                      "Its messages are shown in addition to those of the topic. Empty disables it.",
+                                      this, SLOT( updateSharedMemory() ));
+
+    delta_topic_property_ =
+            new rviz::RosTopicProperty( "Delta Topic", "",
+                                        QString::fromStdString( ros::message_traits::datatype<my_rviz_plugin::WrenchStampedArrayDelta>() ),
+                                        "my_rviz_plugin::WrenchStampedArrayDelta topic, e.g. from wrench_array_delta_converter. "
+                                        "Each message updates the elements it carries and moves those whose frames moved. "
+                                        "Empty disables it.",
+                                        this, SLOT( updateDeltaTopic() ));
+
+    engine_.setHandler( boost::bind( &WrenchStampedArrayDisplay::handleMessage, this, _1 ));
+    connect( &engine_, SIGNAL( cullFilterChanged() ), this, SLOT( updateCulling() ));
 }
 
 void WrenchStampedArrayDisplay::onInitialize()
 {
     MFDClass::onInitialize();
-    updateHistoryLength( );
+    sub_.registerCallback( boost::bind( &WrenchDisplayEngine<WrenchStampedArrayElements>::receiveMessage, &engine_, _1 ));
+    engine_.initialize( context_, scene_node_ );
+    updateThreadedProcessing( );
+    updateDeltaTopic( );
 }
 
 WrenchStampedArrayDisplay::~WrenchStampedArrayDisplay()
 {
+    delta_subscriber_.shutdown();
+    // Join the worker before the frame manager it uses can go away.
+    pipeline_.reset();
 }
 
 // Override rviz::Display's reset() function to add a call to clear().
 void WrenchStampedArrayDisplay::reset()
 {
     MFDClass::reset();
-    visuals_.clear();
+    engine_.reset();
+    delta_state_.clear();
 }
 
-void WrenchStampedArrayDisplay::updateColorAndAlpha()
+void WrenchStampedArrayDisplay::update( float wall_dt, float ros_dt )
 {
-    float alpha = alpha_property_->getFloat();
-    float force_scale = force_scale_property_->getFloat();
-    float torque_scale = torque_scale_property_->getFloat();
-    float width = width_property_->getFloat();
-    Ogre::ColourValue force_color = force_color_property_->getOgreColor();
-    Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
-
-    for( size_t i = 0; i < visuals_.size(); i++ )
-    {
-      for(size_t j = 0; j< visuals_[i]->size(); j++){
-        (*visuals_[i])[j]->setForceColor( force_color.r, force_color.g, force_color.b, alpha );
-	(*visuals_[i])[j]->setTorqueColor( torque_color.r, torque_color.g, torque_color.b, alpha );
-	(*visuals_[i])[j]->setForceScale( force_scale );
-        (*visuals_[i])[j]->setTorqueScale( torque_scale );
-	(*visuals_[i])[j]->setWidth( width );
+    MFDClass::update( wall_dt, ros_dt );
+    if( pipeline_ )
+    {
+      WrenchRecordBatch* batch;
+      while(( batch = pipeline_->pop() ))
+      {
+        ScopedProcessTimer timer( engine_.statistics() );
+        engine_.applyBatch( *batch );
+        pipeline_->recycle( batch );
       }
     }
+    if( !shm_property_->getStdString().empty() )
+    {
+      readSharedMemory( wall_dt );
+    }
+    engine_.update( wall_dt );
+    if( !engine_.updateStatistics( wall_dt, update_nh_,
+                                   ( pipeline_ ? pipeline_->dropped() : 0 ) +
+                                   shm_reader_.overruns() + shm_reader_.skipped() +
+                                   delta_state_.dropped() ))
+    {
+      return;
+    }
+    if( pipeline_ )
+    {
+      // The worker thread resolves with a cache of its own.
+      const TransformCache& cache = engine_.transformCache();
+      setStatus( rviz::StatusProperty::Ok, "Pipeline",
+                 QString( "%1 queued, %2 dropped" ).arg( pipeline_->depth() ).arg( pipeline_->dropped() ));
+      setStatus( rviz::StatusProperty::Ok, "TF Cache",
+                 QString( "%1 hits, %2 misses" ).arg( pipeline_->tfHits() + cache.hits() )
+                 .arg( pipeline_->tfMisses() + cache.misses() ));
+    }
+    if( shm_reader_.isOpen() )
+    {
+      setStatus( rviz::StatusProperty::Ok, "Shared Memory",
+                 QString( "%1 overruns, %2 skipped" ).arg( shm_reader_.overruns() ).arg( shm_reader_.skipped() ));
+    }
 }
 
-// Set the number of past visuals to show.
-void WrenchStampedArrayDisplay::updateHistoryLength()
+// Cached transforms are relative to the old fixed frame.
+void WrenchStampedArrayDisplay::fixedFrameChanged()
 {
-  //visuals_.rset_capacity(history_length_property_->getInt());
-  if (visuals_.size()>history_length_property_->getInt()){
-    for(int i=0;i<history_length_property_->getInt()-visuals_.size();i++){
-      visuals_.pop_front();
+    engine_.fixedFrameChanged();
+    if( pipeline_ )
+    {
+      pipeline_->invalidateTransforms();
     }
-  }
+    MFDClass::fixedFrameChanged();
 }
 
-// bool validateFloats( const geometry_msgs::WrenchStamped& msg )
-// {
-//     return rviz::validateFloats(msg.wrench.force) && rviz::validateFloats(msg.wrench.torque) ;
-// }
-
-// This is our callback to handle an incoming message.
-void WrenchStampedArrayDisplay::processMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+void WrenchStampedArrayDisplay::updateThreadedProcessing()
 {
-  boost::shared_ptr<std::vector<boost::shared_ptr<rviz::WrenchVisual> > > visuals;
-  if( visuals_.size()>=history_length_property_->getInt() )
+    if( !context_ )
     {
-      visuals = visuals_.front();
-      visuals_.pop_front();
-      visuals->clear();
+      return;
     }
-  else
+    if( threaded_property_->getBool() )
     {
-      visuals.reset(new std::vector<boost::shared_ptr<rviz::WrenchVisual> >{});
-    }
-  for (int i=0;i<msg->wrenchstampeds.size();i++){
-    if( !validateFloats( msg->wrenchstampeds[i] ))
+      if( !pipeline_ )
       {
-        setStatus( rviz::StatusProperty::Error, "Topic", "Message contained invalid floating point values (nans or infs)" );
-        continue;
+        pipeline_.reset( new WrenchPipeline( &engine_.transformSource(), 64, &engine_.trace() ));
+        pipeline_->setCullFilter( engine_.cullFilter() );
       }
-    
-    // Here we call the rviz::FrameManager to get the transform from the
-    // fixed frame to the frame in the header of this Imu message.  If
-    // it fails, we can't do anything else so we return.
-    Ogre::Quaternion orientation;
-    Ogre::Vector3 position;
-    if( !context_->getFrameManager()->getTransform( msg->wrenchstampeds[i].header.frame_id,
-                                                    msg->wrenchstampeds[i].header.stamp,
-                                                    position, orientation ))
+    }
+    else
+    {
+      pipeline_.reset();
+      deleteStatus( "Pipeline" );
+    }
+}
+
+// The worker thread keeps its own copy of the cull filter, and the delta
+// state only resolves changed elements again unless told otherwise.
+void WrenchStampedArrayDisplay::updateCulling()
+{
+    if( pipeline_ )
+    {
+      pipeline_->setCullFilter( engine_.cullFilter() );
+    }
+    delta_state_.invalidate();
+}
+
+void WrenchStampedArrayDisplay::updateDeltaTopic()
+{
+    if( !context_ )
+    {
+      return;
+    }
+    delta_subscriber_.shutdown();
+    delta_state_.clear();
+    deleteStatus( "Delta" );
+    std::string topic = delta_topic_property_->getStdString();
+    if( topic.empty() )
+    {
+      return;
+    }
+    try
+    {
+      // Callbacks come on the main thread, like those of the MessageFilter.
+      delta_subscriber_ = update_nh_.subscribe<my_rviz_plugin::WrenchStampedArrayDelta>(
+              topic, 10, boost::bind( &WrenchStampedArrayDisplay::processDelta, this, _1 ));
+    }
+    catch( ros::Exception& e )
+    {
+      setStatus( rviz::StatusProperty::Error, "Delta", QString( "Error subscribing: " ) + e.what() );
+    }
+}
+
+void WrenchStampedArrayDisplay::updateSharedMemory()
+{
+    shm_reader_.close();
+    shm_idle_ = 1.0f;
+    deleteStatus( "Shared Memory" );
+}
+
+void WrenchStampedArrayDisplay::readSharedMemory( float wall_dt )
+{
+    // A writer that restarts replaces the segment, so once it has been
+    // quiet for a while, check that its writer is still there and look
+    // for a new one if not. Opening is retried once a second.
+    shm_idle_ += wall_dt;
+    if( shm_idle_ >= 1.0f )
+    {
+      shm_idle_ = 0;
+      if( shm_reader_.stale() && !shm_reader_.open( shm_property_->getStdString() ))
       {
-	//ROS_ERROR( "Error transforming from frame '%s' to frame '%s'",
-	ROS_DEBUG( "Error transforming from frame '%s' to frame '%s'",
-                   msg->wrenchstampeds[i].header.frame_id.c_str(), qPrintable( fixed_frame_ ));
-        continue;
+        setStatus( rviz::StatusProperty::Warn, "Shared Memory",
+                   QString( "Segment '%1' not found" ).arg( shm_property_->getString() ));
+        return;
       }
-    
-    if ( position.isNaN() )
-      {
-        ROS_ERROR_THROTTLE(1.0, "Wrench position contains NaNs. Skipping render as long as the position is invalid");
-        continue;
-    }
-
-    boost::shared_ptr<rviz::WrenchVisual> visual{new rviz::WrenchVisual{context_->getSceneManager(), scene_node_ }};
-    // Now set or update the contents of the chosen visual.
-    visual->setWrench( msg->wrenchstampeds[i].wrench );
-    //std::this_thread::sleep_for(std::chrono::seconds(3));
-    visual->setFramePosition( position );
-    visual->setFrameOrientation( orientation );
-    float alpha = alpha_property_->getFloat();
-    float force_scale = force_scale_property_->getFloat();
-    float torque_scale = torque_scale_property_->getFloat();
-    float width = width_property_->getFloat();
-    Ogre::ColourValue force_color = force_color_property_->getOgreColor();
-    Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
-    visual->setForceColor( force_color.r, force_color.g, force_color.b, alpha );
-    visual->setTorqueColor( torque_color.r, torque_color.g, torque_color.b, alpha );
-    visual->setForceScale( force_scale );
-    visual->setTorqueScale( torque_scale );
-    visual->setWidth( width );
-    //visuals->push_back(std::move(visual));
-    visuals->push_back(visual);
-    //std::cerr<<"$$$$$$$$$$$$$$$"<<std::endl;
-  }
-  // And send it to the end of the circular buffer
-  visuals_.push_back(visuals);
+    }
+    if( !shm_reader_.isOpen() )
+    {
+      return;
+    }
+
+    // Only the newest messages that fit in the history can be seen.
+    if( engine_.historyLength() > 0 )
+    {
+      shm_reader_.skip( engine_.historyLength() );
+    }
+    while( shm_reader_.read( shm_message_ ))
+    {
+      shm_idle_ = 0;
+      engine_.statistics().received();
+      ScopedProcessTimer timer( engine_.statistics() );
+      TraceScope scope( &engine_.trace(), "shared memory", shm_message_.frame_indices.size() );
+      engine_.transformCache().beginMessage();
+      resolveElements( WrenchShmElements( shm_message_, shm_reader_.frameIds() ), engine_.cullFilter(),
+                       engine_.transformSource(), engine_.transformCache(), shm_resolved_, &engine_.trace() );
+      engine_.applyBatch( shm_resolved_ );
+    }
+}
+
+// This is our callback to handle an incoming message.
+void WrenchStampedArrayDisplay::processMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+{
+  engine_.processMessage( msg );
+}
+
+// Messages of the delta topic bypass coalescing, filtering and the worker
+// thread, as the state must see every one of them. Only the elements a
+// delta carries and those in frames that moved are resolved again.
+void WrenchStampedArrayDisplay::processDelta( const my_rviz_plugin::WrenchStampedArrayDelta::ConstPtr& msg )
+{
+  if( !isEnabled() )
+    {
+      return;
+    }
+  engine_.statistics().received();
+  if( !delta_state_.accept( *msg ))
+    {
+      setStatus( rviz::StatusProperty::Warn, "Delta",
+                 QString( "Waiting for a keyframe, %1 gaps, %2 messages dropped" )
+                 .arg( delta_state_.gaps() ).arg( delta_state_.dropped() ));
+      return;
+    }
+  ScopedProcessTimer timer( engine_.statistics() );
+  engine_.transformCache().beginMessage();
+  delta_state_.apply( *msg, engine_.transformSource(), engine_.transformCache() );
+  const my_rviz_plugin::WrenchStampedArray& array = delta_state_.array();
+  TraceScope scope( &engine_.trace(), "delta", delta_state_.elements().size() );
+  resolveElements( WrenchStampedArraySubsetElements( array, delta_state_.elements(), msg->header.stamp ),
+                   engine_.cullFilter(), engine_.transformSource(), engine_.transformCache(),
+                   delta_resolved_, &engine_.trace() );
+  delta_state_.update( delta_resolved_ );
+  engine_.sampleEnvelope( delta_state_.samples(), delta_state_.sampleElements(), delta_state_.keyframe() );
+  engine_.applyElements( msg->header.stamp, delta_state_.glyphs(), delta_state_.changed() );
+  setStatus( rviz::StatusProperty::Ok, "Delta",
+             QString( "%1 of %2 elements sent, %3 resolved, %4 redrawn, %5 gaps, %6 messages dropped" )
+             .arg( msg->wrenchstampeds.size() ).arg( array.wrenchstampeds.size() )
+             .arg( delta_state_.elements().size() )
+             .arg( delta_state_.changed().size() )
+             .arg( delta_state_.gaps() ).arg( delta_state_.dropped() ));
+}
+
+void WrenchStampedArrayDisplay::handleMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+{
+  if( pipeline_ )
+    {
+      pipeline_->push( msg );
+      return;
+    }
+  engine_.handleMessage( msg );
 }
 
 } // end namespace my_rviz_plugin
@@ -251,4 +340,3 @@ void WrenchStampedArrayDisplay::processMessage( const my_rviz_plugin::WrenchStam
 // global scope, outside our package's namespace.
 #include <pluginlib/class_list_macros.hpp>
 PLUGINLIB_EXPORT_CLASS( my_rviz_plugin::WrenchStampedArrayDisplay, rviz::Display )
-
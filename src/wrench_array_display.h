@@ -66,33 +66,23 @@ yet been invented or conceived.
 #ifndef MY_RVIZ_PLUGIN_WRENCHSTAMPEDARRAY_DISPLAY_H
 #define MY_RVIZ_PLUGIN_WRENCHSTAMPEDARRAY_DISPLAY_H
 
-//#ifndef Q_MOC_RUN
-//#include <boost/circular_buffer.hpp>
-//#endif
-#include <deque>
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#endif
 
 
 #include <my_rviz_plugin/WrenchStampedArray.h>
 #include <rviz/message_filter_display.h>
-#include <thread>
-#include "wrench_display.h"
-
-namespace Ogre
-{
-class SceneNode;
-}
+#include "wrench_display_engine.h"
+#include "wrench_pipeline.h"
+#include "wrench_shm_reader.h"
+#include "wrench_delta_state.h"
 
 namespace rviz
 {
-class ColorProperty;
-class ROSTopicStringProperty;
-class FloatProperty;
-class IntProperty;
-}
-
-namespace rviz
-{
-  class WrenchVisual;
+class BoolProperty;
+class StringProperty;
+class RosTopicProperty;
 }
 
 namespace my_rviz_plugin
@@ -111,29 +101,52 @@ protected:
     // Overrides of public virtual functions from the Display class.
     virtual void onInitialize();
     virtual void reset();
+    virtual void update( float wall_dt, float ros_dt );
+    virtual void fixedFrameChanged();
 
 private Q_SLOTS:
-    // Helper function to apply color and alpha to all visuals.
-    void updateColorAndAlpha();
-    void updateHistoryLength();
+    void updateCulling();
+    void updateSharedMemory();
+    void updateThreadedProcessing();
+    void updateDeltaTopic();
 
 private:
+  // Processes the messages written to the shared-memory segment since the
+  // last frame.
+  void readSharedMemory( float wall_dt );
+
   // Function to handle an incoming ROS message.
   void processMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg );
-  
-  // Storage for the list of visuals par each joint intem
-  // Storage for the list of visuals.  It is a circular buffer where
-  // data gets popped from the front (oldest) and pushed to the back (newest)
-  //注意!! rviz::WrenchVisualはshared_prtの状態で扱うこと。解体する際に、rviz側でまだ利用中の場合に、突然プログラムが落ちる。
-  std::deque<boost::shared_ptr<std::vector<boost::shared_ptr<rviz::WrenchVisual> > > > visuals_;
-  
+  // Does the actual work for a message that was not coalesced away.
+  void handleMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg );
+  // Applies a delta message to the array it is based on and shows the array.
+  void processDelta( const my_rviz_plugin::WrenchStampedArrayDelta::ConstPtr& msg );
+
+  // History, rendering and the properties shared with the other wrench displays.
+  WrenchDisplayEngine<WrenchStampedArrayElements> engine_;
+
+  // Input from a WrenchShmWriter on the same host, read once per frame.
+  WrenchShmReader shm_reader_;
+  WrenchShmMessage shm_message_;
+  WrenchRecordBatch shm_resolved_;
+  // Seconds since the segment was last opened or last had a new message.
+  float shm_idle_;
+
+  // Input of delta-coded arrays. Deltas save bandwidth, deserialization and
+  // resolving the unchanged elements.
+  ros::Subscriber delta_subscriber_;
+  WrenchDeltaState delta_state_;
+  WrenchRecordBatch delta_resolved_;
+
+  // Validates and resolves messages on a worker thread when
+  // "Threaded Processing" is enabled.
+  boost::scoped_ptr<WrenchPipeline> pipeline_;
 
   // Property objects for user-editable properties.
-  rviz::ColorProperty *force_color_property_, *torque_color_property_;
-  rviz::FloatProperty *alpha_property_, *force_scale_property_, *torque_scale_property_, *width_property_;
-  rviz::IntProperty *history_length_property_;
+  rviz::BoolProperty *threaded_property_;
+  rviz::StringProperty *shm_property_;
+  rviz::RosTopicProperty *delta_topic_property_;
 };
 } // end namespace rviz_plugin_tutorials
 
 #endif // MY_RVIZ_PLUGIN_WRENCHSTAMPED_DISPLAY_H
-
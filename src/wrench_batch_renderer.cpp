@@ -0,0 +1,544 @@
+#include <cmath>
+#include <sstream>
+
+#include <OgreSceneNode.h>
+#include <OgreSceneManager.h>
+#include <OgreManualObject.h>
+#include <OgreHardwareVertexBuffer.h>
+#include <OgreVertexIndexData.h>
+#include <OgreMaterialManager.h>
+#include <OgreTechnique.h>
+#include <OgrePass.h>
+#include <OgreHighLevelGpuProgramManager.h>
+
+#include "wrench_batch_renderer.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+// Same proportions as rviz::Arrow used by rviz::WrenchVisual.
+const float SHAFT_RATIO = 1.0f / 1.3f;
+const float SHAFT_RADIUS = 0.05f;
+const float HEAD_RADIUS = 0.1f;
+// Two crossed quads for the shaft and two crossed triangles for the head.
+const size_t ARROW_VERTICES = 14;
+const size_t ARROW_INDICES = 18;
+// Torque ring drawn from 1/8 turn to a full turn, as rviz::WrenchVisual does.
+const int RING_FIRST = 4;
+const int RING_LAST = 32;
+const size_t RING_VERTICES = 2 * ( RING_LAST - RING_FIRST );
+// Position, normal and two texture coordinates.
+const size_t VERTEX_BYTES = 10 * sizeof( float );
+
+const char* VERTEX_PROGRAM = "WrenchBatchRendererVP";
+const char* FRAGMENT_PROGRAM = "WrenchBatchRendererFP";
+
+// gl_Normal is the offset along the glyph per unit of wrench magnitude,
+// gl_MultiTexCoord0 the offset across the glyph per unit of arrow width and
+// gl_MultiTexCoord1.x the wrench magnitude. Glyphs shorter than the arrow
+// width collapse to their origin, as rviz::WrenchVisual hides them.
+//
+// With colormap set, the magnitude also picks the color from palette, the
+// same way as WrenchColormap::level().
+const char* VERTEX_SOURCE =
+  "#version 120\n"
+  "uniform mat4 world_view_proj;\n"
+  "uniform float length_scale;\n"
+  "uniform float width;\n"
+  "uniform float range_min;\n"
+  "uniform float range_max;\n"
+  "uniform vec4 palette[16];\n"
+  "varying vec4 magnitude_color;\n"
+  "void main()\n"
+  "{\n"
+  "  float magnitude = gl_MultiTexCoord1.x;\n"
+  "  float visible = step( width, magnitude * length_scale );\n"
+  "  vec3 offset = gl_Normal * length_scale + gl_MultiTexCoord0.xyz * width;\n"
+  "  gl_Position = world_view_proj * vec4( gl_Vertex.xyz + offset * visible, 1.0 );\n"
+  "  float span = range_max - range_min;\n"
+  "  float t = span > 0.0 ? clamp( ( magnitude - range_min ) / span, 0.0, 1.0 ) : step( range_max, magnitude );\n"
+  "  magnitude_color = palette[int( floor( t * 15.0 + 0.5 ))];\n"
+  "}\n";
+
+const char* FRAGMENT_SOURCE =
+  "#version 120\n"
+  "uniform vec4 color;\n"
+  "uniform float colormap;\n"
+  "varying vec4 magnitude_color;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = mix( color, vec4( magnitude_color.rgb, color.a ), colormap );\n"
+  "}\n";
+
+// The programs are shared by every renderer.
+void createPrograms()
+{
+  Ogre::HighLevelGpuProgramManager& manager = Ogre::HighLevelGpuProgramManager::getSingleton();
+  if( !manager.resourceExists( VERTEX_PROGRAM ))
+  {
+    Ogre::HighLevelGpuProgramPtr program =
+      manager.createProgram( VERTEX_PROGRAM, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+                             "glsl", Ogre::GPT_VERTEX_PROGRAM );
+    program->setSource( VERTEX_SOURCE );
+    program->load();
+  }
+  if( !manager.resourceExists( FRAGMENT_PROGRAM ))
+  {
+    Ogre::HighLevelGpuProgramPtr program =
+      manager.createProgram( FRAGMENT_PROGRAM, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,
+                             "glsl", Ogre::GPT_FRAGMENT_PROGRAM );
+    program->setSource( FRAGMENT_SOURCE );
+    program->load();
+  }
+}
+}
+
+WrenchBatchRenderer::WrenchBatchRenderer( Ogre::SceneManager* scene_manager, Ogre::SceneNode* parent_node )
+  : scene_manager_( scene_manager )
+  , force_color_( 0.8, 0.2, 0.2, 1.0 )
+  , torque_color_( 0.8, 0.8, 0.2, 1.0 )
+  , force_scale_( 1.0 )
+  , torque_scale_( 1.0 )
+  , width_( 1.0 )
+  , creating_section_( false )
+  , patching_( false )
+  , section_vertices_( 0 )
+  , version_( 0 )
+  , lod_version_( 0 )
+  , built_with_lod_( false )
+  , full_detail_( true )
+  , built_full_detail_( true )
+  , glyphs_( 0 )
+  , lines_( 0 )
+  , triangles_( 0 )
+  , batches_( 0 )
+{
+  createPrograms();
+
+  static int count = 0;
+  std::stringstream ss;
+  ss << "WrenchBatchRenderer" << count++;
+
+  scene_node_ = parent_node->createChildSceneNode();
+  manual_object_ = scene_manager_->createManualObject( ss.str() );
+  manual_object_->setDynamic( true );
+  scene_node_->attachObject( manual_object_ );
+
+  force_material_ = ss.str() + "Force";
+  torque_material_ = ss.str() + "Torque";
+  const std::string* names[] = { &force_material_, &torque_material_ };
+  for( int i = 0; i < 2; i++ )
+  {
+    Ogre::MaterialPtr material =
+      Ogre::MaterialManager::getSingleton().create( *names[i], Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME );
+    material->setReceiveShadows( false );
+    material->getTechnique( 0 )->setLightingEnabled( false );
+    material->setCullingMode( Ogre::CULL_NONE );
+    Ogre::Pass* pass = material->getTechnique( 0 )->getPass( 0 );
+    pass->setVertexProgram( VERTEX_PROGRAM );
+    pass->setFragmentProgram( FRAGMENT_PROGRAM );
+    pass->getVertexProgramParameters()->setIgnoreMissingParams( true );
+    pass->getVertexProgramParameters()->setNamedAutoConstant( "world_view_proj",
+                                                              Ogre::GpuProgramParameters::ACT_WORLDVIEWPROJ_MATRIX );
+    pass->getFragmentProgramParameters()->setIgnoreMissingParams( true );
+  }
+  updateMaterial( force_material_, force_color_, force_scale_, force_colormap_ );
+  updateMaterial( torque_material_, torque_color_, torque_scale_, torque_colormap_ );
+}
+
+WrenchBatchRenderer::~WrenchBatchRenderer()
+{
+  scene_manager_->destroyManualObject( manual_object_ );
+  scene_manager_->destroySceneNode( scene_node_ );
+  Ogre::MaterialManager::getSingleton().remove( force_material_ );
+  Ogre::MaterialManager::getSingleton().remove( torque_material_ );
+}
+
+void WrenchBatchRenderer::setForceColor( float r, float g, float b, float a )
+{
+  force_color_ = Ogre::ColourValue( r, g, b, a );
+  updateMaterial( force_material_, force_color_, force_scale_, force_colormap_ );
+}
+
+void WrenchBatchRenderer::setTorqueColor( float r, float g, float b, float a )
+{
+  torque_color_ = Ogre::ColourValue( r, g, b, a );
+  updateMaterial( torque_material_, torque_color_, torque_scale_, torque_colormap_ );
+}
+
+void WrenchBatchRenderer::setForceScale( float s )
+{
+  force_scale_ = s;
+  updateMaterial( force_material_, force_color_, force_scale_, force_colormap_ );
+}
+
+void WrenchBatchRenderer::setTorqueScale( float s )
+{
+  torque_scale_ = s;
+  updateMaterial( torque_material_, torque_color_, torque_scale_, torque_colormap_ );
+}
+
+void WrenchBatchRenderer::setWidth( float w )
+{
+  width_ = w;
+  updateMaterial( force_material_, force_color_, force_scale_, force_colormap_ );
+  updateMaterial( torque_material_, torque_color_, torque_scale_, torque_colormap_ );
+}
+
+void WrenchBatchRenderer::setForceColormap( const WrenchColormap& colormap )
+{
+  force_colormap_ = colormap;
+  updateMaterial( force_material_, force_color_, force_scale_, force_colormap_ );
+}
+
+void WrenchBatchRenderer::setTorqueColormap( const WrenchColormap& colormap )
+{
+  torque_colormap_ = colormap;
+  updateMaterial( torque_material_, torque_color_, torque_scale_, torque_colormap_ );
+}
+
+void WrenchBatchRenderer::setFullDetail( bool full_detail )
+{
+  full_detail_ = full_detail;
+}
+
+void WrenchBatchRenderer::setVisible( bool visible )
+{
+  scene_node_->setVisible( visible );
+}
+
+size_t WrenchBatchRenderer::memoryUsage() const
+{
+  size_t vertices = glyphs_ * ( 2 * ARROW_VERTICES + RING_VERTICES ) + lines_ * 2;
+  size_t indices = glyphs_ * 2 * ARROW_INDICES;
+  // Positions, wrenches before and after rotation, rotations and norms.
+  size_t scratch = positions_.capacity() * ( sizeof( Ogre::Vector3 ) + 18 * sizeof( float ));
+  return vertices * VERTEX_BYTES + indices * sizeof( Ogre::uint32 ) + scratch;
+}
+
+void WrenchBatchRenderer::updateMaterial( const std::string& name, const Ogre::ColourValue& color, float scale,
+                                          const WrenchColormap& colormap )
+{
+  Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().getByName( name );
+  Ogre::Pass* pass = material->getTechnique( 0 )->getPass( 0 );
+  pass->getVertexProgramParameters()->setNamedConstant( "length_scale", scale );
+  pass->getVertexProgramParameters()->setNamedConstant( "width", width_ );
+  pass->getVertexProgramParameters()->setNamedConstant( "range_min", colormap.min() );
+  pass->getVertexProgramParameters()->setNamedConstant( "range_max", colormap.max() );
+  pass->getVertexProgramParameters()->setNamedConstant( "palette", colormap.lut(), WrenchColormap::LEVELS );
+  pass->getFragmentProgramParameters()->setNamedConstant( "color", color );
+  pass->getFragmentProgramParameters()->setNamedConstant( "colormap", colormap.active() ? 1.0f : 0.0f );
+
+  if( color.a < 0.9998 )
+  {
+    material->setSceneBlending( Ogre::SBT_TRANSPARENT_ALPHA );
+    material->setDepthWriteEnabled( false );
+  }
+  else
+  {
+    material->setSceneBlending( Ogre::SBT_REPLACE );
+    material->setDepthWriteEnabled( true );
+  }
+}
+
+bool WrenchBatchRenderer::drawn( const WrenchLevelOfDetail* lod, size_t i, WrenchLevelOfDetail::Tier tier ) const
+{
+  if( !lod )
+  {
+    return tier == WrenchLevelOfDetail::FULL && full_detail_;
+  }
+  if( tier == WrenchLevelOfDetail::FULL && !full_detail_ )
+  {
+    return false;
+  }
+  return lod->tiers()[i] == tier;
+}
+
+void WrenchBatchRenderer::update( const WrenchHistory& history, const WrenchLevelOfDetail* lod )
+{
+  bool history_changed = history.version() != version_;
+  if( !history_changed && ( lod != NULL ) == built_with_lod_ && full_detail_ == built_full_detail_ &&
+      ( !lod || lod->version() == lod_version_ ))
+  {
+    return;
+  }
+  const std::vector<uint32_t>* replaced = NULL;
+  if( !lod && !built_with_lod_ && full_detail_ && built_full_detail_ &&
+      history.records() == positions_.size() && history.replacedSince( version_, replaced ))
+  {
+    updateRecords( history, *replaced );
+    version_ = history.version();
+    return;
+  }
+  version_ = history.version();
+  lod_version_ = lod ? lod->version() : 0;
+  built_with_lod_ = ( lod != NULL );
+  built_full_detail_ = full_detail_;
+
+  size_t records = history.records();
+  if( lod && lod->tiers().size() != records )
+  {
+    lod = NULL;
+  }
+
+  // Rotate all wrenches into the fixed frame at once. The scales stay in
+  // the vertex program, so the kernel runs with unit scale. Only a change
+  // of the tiers keeps the rotated wrenches of the last build.
+  if( history_changed )
+  {
+    history.copyTo( positions_, rotations_, wrenches_ );
+    transformWrenches( wrenches_, rotations_, 1.0f, 1.0f, rotated_, force_norms_, torque_norms_ );
+  }
+
+  size_t glyphs = 0;
+  size_t lines = 0;
+  for( size_t i = 0; i < records; i++ )
+  {
+    glyphs += drawn( lod, i, WrenchLevelOfDetail::FULL );
+    lines += drawn( lod, i, WrenchLevelOfDetail::LINE );
+  }
+  glyphs_ = glyphs;
+  lines_ = lines;
+
+  // Section 0: force arrows.
+  beginSection( 0, force_material_, Ogre::RenderOperation::OT_TRIANGLE_LIST,
+                glyphs * ARROW_VERTICES, glyphs * ARROW_INDICES );
+  for( size_t i = 0; i < records; i++ )
+  {
+    if( drawn( lod, i, WrenchLevelOfDetail::FULL ))
+    {
+      appendArrow( positions_[i], Ogre::Vector3( rotated_.fx[i], rotated_.fy[i], rotated_.fz[i] ),
+                   force_norms_[i] );
+    }
+  }
+  size_t force_vertices = section_vertices_;
+  endSection();
+
+  // Section 1: torque arrows.
+  beginSection( 1, torque_material_, Ogre::RenderOperation::OT_TRIANGLE_LIST,
+                glyphs * ARROW_VERTICES, glyphs * ARROW_INDICES );
+  for( size_t i = 0; i < records; i++ )
+  {
+    if( drawn( lod, i, WrenchLevelOfDetail::FULL ))
+    {
+      appendArrow( positions_[i], Ogre::Vector3( rotated_.tx[i], rotated_.ty[i], rotated_.tz[i] ),
+                   torque_norms_[i] );
+    }
+  }
+  size_t torque_vertices = section_vertices_;
+  endSection();
+
+  // Section 2: torque rings.
+  beginSection( 2, torque_material_, Ogre::RenderOperation::OT_LINE_LIST,
+                glyphs * RING_VERTICES, 0 );
+  for( size_t i = 0; i < records; i++ )
+  {
+    if( drawn( lod, i, WrenchLevelOfDetail::FULL ))
+    {
+      appendRing( positions_[i], Ogre::Vector3( rotated_.tx[i], rotated_.ty[i], rotated_.tz[i] ),
+                  torque_norms_[i] );
+    }
+  }
+  size_t ring_vertices = section_vertices_;
+  endSection();
+
+  // Sections 3 and 4: force and torque lines of the LINE tier.
+  beginSection( 3, force_material_, Ogre::RenderOperation::OT_LINE_LIST, lines * 2, 0 );
+  for( size_t i = 0; i < records; i++ )
+  {
+    if( drawn( lod, i, WrenchLevelOfDetail::LINE ))
+    {
+      appendLine( positions_[i], Ogre::Vector3( rotated_.fx[i], rotated_.fy[i], rotated_.fz[i] ),
+                  force_norms_[i] );
+    }
+  }
+  size_t force_line_vertices = section_vertices_;
+  endSection();
+
+  beginSection( 4, torque_material_, Ogre::RenderOperation::OT_LINE_LIST, lines * 2, 0 );
+  for( size_t i = 0; i < records; i++ )
+  {
+    if( drawn( lod, i, WrenchLevelOfDetail::LINE ))
+    {
+      appendLine( positions_[i], Ogre::Vector3( rotated_.tx[i], rotated_.ty[i], rotated_.tz[i] ),
+                  torque_norms_[i] );
+    }
+  }
+  size_t torque_line_vertices = section_vertices_;
+  endSection();
+
+  // Each arrow has 6 triangles for 14 vertices.
+  triangles_ = ( force_vertices + torque_vertices ) / ARROW_VERTICES * ( ARROW_INDICES / 3 );
+  batches_ = ( force_vertices > 0 ) + ( torque_vertices > 0 ) + ( ring_vertices > 0 ) +
+             ( force_line_vertices > 0 ) + ( torque_line_vertices > 0 );
+
+  // Vertices sit at the glyph origins and are only moved by the vertex
+  // program, so the bounds Ogre computes from them are too small.
+  manual_object_->setBoundingBox( Ogre::AxisAlignedBox::BOX_INFINITE );
+}
+
+void WrenchBatchRenderer::updateRecords( const WrenchHistory& history, const std::vector<uint32_t>& records )
+{
+  patching_ = true;
+  for( size_t k = 0; k < records.size(); k++ )
+  {
+    size_t i = records[k];
+    // The scratch arrays stay those of the whole history, for a later
+    // rebuild of the tiers only.
+    WrenchGlyph glyph = history.glyph( i );
+    Ogre::Vector3 force = glyph.orientation * glyph.force;
+    Ogre::Vector3 torque = glyph.orientation * glyph.torque;
+    positions_[i] = glyph.position;
+    rotated_.fx[i] = force.x;
+    rotated_.fy[i] = force.y;
+    rotated_.fz[i] = force.z;
+    rotated_.tx[i] = torque.x;
+    rotated_.ty[i] = torque.y;
+    rotated_.tz[i] = torque.z;
+    force_norms_[i] = force.length();
+    torque_norms_[i] = torque.length();
+
+    appendArrow( glyph.position, force, force_norms_[i] );
+    writePatch( 0, i * ARROW_VERTICES );
+    appendArrow( glyph.position, torque, torque_norms_[i] );
+    writePatch( 1, i * ARROW_VERTICES );
+    appendRing( glyph.position, torque, torque_norms_[i] );
+    writePatch( 2, i * RING_VERTICES );
+  }
+  patching_ = false;
+}
+
+void WrenchBatchRenderer::writePatch( unsigned int section, size_t first )
+{
+  Ogre::HardwareVertexBufferSharedPtr buffer =
+    manual_object_->getSection( section )->getRenderOperation()->vertexData->vertexBufferBinding->getBuffer( 0 );
+  buffer->writeData( first * VERTEX_BYTES, patch_.size() * sizeof( float ), &patch_[0] );
+  patch_.clear();
+}
+
+void WrenchBatchRenderer::beginSection( unsigned int index, const std::string& material,
+                                        Ogre::RenderOperation::OperationType operation,
+                                        size_t vertices, size_t indices )
+{
+  creating_section_ = ( manual_object_->getNumSections() <= index );
+  if( creating_section_ )
+  {
+    manual_object_->begin( material, operation );
+  }
+  else
+  {
+    manual_object_->beginUpdate( index );
+  }
+  manual_object_->estimateVertexCount( vertices );
+  manual_object_->estimateIndexCount( indices );
+  section_vertices_ = 0;
+}
+
+void WrenchBatchRenderer::endSection()
+{
+  // Ogre::ManualObject drops a newly created section without vertices,
+  // which would shift the indices of the following sections.
+  if( creating_section_ && section_vertices_ == 0 )
+  {
+    for( int i = 0; i < 6; i++ )
+    {
+      appendVertex( Ogre::Vector3::ZERO, Ogre::Vector3::ZERO, Ogre::Vector3::ZERO, 0 );
+    }
+  }
+  manual_object_->end();
+}
+
+void WrenchBatchRenderer::appendVertex( const Ogre::Vector3& origin, const Ogre::Vector3& along,
+                                        const Ogre::Vector3& across, float magnitude )
+{
+  if( patching_ )
+  {
+    // Same layout as the ManualObject builds from the calls below.
+    const float vertex[] = { origin.x, origin.y, origin.z, along.x, along.y, along.z,
+                             across.x, across.y, across.z, magnitude };
+    patch_.insert( patch_.end(), vertex, vertex + 10 );
+    return;
+  }
+  manual_object_->position( origin );
+  manual_object_->normal( along );
+  manual_object_->textureCoord( across );
+  manual_object_->textureCoord( magnitude );
+}
+
+// A zero value still gets its vertices, all at the origin, so that every
+// glyph has the same number of them.
+void WrenchBatchRenderer::appendArrow( const Ogre::Vector3& origin, const Ogre::Vector3& value,
+                                       float magnitude )
+{
+  Ogre::Vector3 across[2] = { Ogre::Vector3::ZERO, Ogre::Vector3::ZERO };
+  if( magnitude > 0 )
+  {
+    Ogre::Vector3 axis = value / magnitude;
+    across[0] = axis.perpendicular();
+    across[1] = axis.crossProduct( across[0] );
+  }
+
+  Ogre::Vector3 shaft_end = value * SHAFT_RATIO;
+  for( int k = 0; k < 2; k++ )
+  {
+    const Ogre::Vector3& a = across[k];
+    Ogre::uint32 base = section_vertices_;
+    appendVertex( origin, Ogre::Vector3::ZERO, a * -SHAFT_RADIUS, magnitude );
+    appendVertex( origin, Ogre::Vector3::ZERO, a * SHAFT_RADIUS, magnitude );
+    appendVertex( origin, shaft_end, a * SHAFT_RADIUS, magnitude );
+    appendVertex( origin, shaft_end, a * -SHAFT_RADIUS, magnitude );
+    appendVertex( origin, shaft_end, a * -HEAD_RADIUS, magnitude );
+    appendVertex( origin, shaft_end, a * HEAD_RADIUS, magnitude );
+    appendVertex( origin, value, Ogre::Vector3::ZERO, magnitude );
+    if( !patching_ )
+    {
+      manual_object_->triangle( base, base + 1, base + 2 );
+      manual_object_->triangle( base, base + 2, base + 3 );
+      manual_object_->triangle( base + 4, base + 5, base + 6 );
+    }
+    section_vertices_ += 7;
+  }
+}
+
+void WrenchBatchRenderer::appendLine( const Ogre::Vector3& origin, const Ogre::Vector3& value,
+                                      float magnitude )
+{
+  if( magnitude <= 0 )
+  {
+    return;
+  }
+  appendVertex( origin, Ogre::Vector3::ZERO, Ogre::Vector3::ZERO, magnitude );
+  appendVertex( origin, value, Ogre::Vector3::ZERO, magnitude );
+  section_vertices_ += 2;
+}
+
+// Like appendArrow(), a zero value gets a ring collapsed to the origin.
+void WrenchBatchRenderer::appendRing( const Ogre::Vector3& origin, const Ogre::Vector3& value,
+                                       float magnitude )
+{
+  Ogre::Vector3 u = Ogre::Vector3::ZERO;
+  Ogre::Vector3 v = Ogre::Vector3::ZERO;
+  if( magnitude > 0 )
+  {
+    Ogre::Vector3 axis = value / magnitude;
+    u = axis.perpendicular() * ( magnitude / 4 );
+    v = axis.crossProduct( axis.perpendicular() ) * ( magnitude / 4 );
+  }
+  Ogre::Vector3 center = value / 2;
+
+  Ogre::Vector3 previous = center + u * std::cos( RING_FIRST * 2 * M_PI / 32 ) +
+                                    v * std::sin( RING_FIRST * 2 * M_PI / 32 );
+  for( int i = RING_FIRST + 1; i <= RING_LAST; i++ )
+  {
+    Ogre::Vector3 point = center + u * std::cos( i * 2 * M_PI / 32 ) +
+                                   v * std::sin( i * 2 * M_PI / 32 );
+    appendVertex( origin, previous, Ogre::Vector3::ZERO, magnitude );
+    appendVertex( origin, point, Ogre::Vector3::ZERO, magnitude );
+    previous = point;
+  }
+  section_vertices_ += RING_VERTICES;
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,132 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_BATCH_RENDERER_H
+#define MY_RVIZ_PLUGIN_WRENCH_BATCH_RENDERER_H
+
+#include <vector>
+#include <string>
+
+#include <OgreVector3.h>
+#include <OgreQuaternion.h>
+#include <OgreColourValue.h>
+#include <OgreRenderOperation.h>
+
+#include "wrench_kernel.h"
+#include "wrench_history.h"
+#include "wrench_lod.h"
+#include "wrench_colormap.h"
+
+namespace Ogre
+{
+class SceneManager;
+class SceneNode;
+class ManualObject;
+}
+
+namespace my_rviz_plugin
+{
+
+// Draws every record of a WrenchHistory with a single Ogre::ManualObject,
+// so the number of draw calls does not depend on the number of wrenches in
+// the history.
+//
+// The vertex buffers are rebuilt at most once per frame from update(), and
+// only when the history changed. Records that WrenchHistory::replaceNewest()
+// overwrote are rewritten in place instead, as long as no level of detail
+// is used: every record then has a fixed range of vertices, with
+// degenerate geometry for zero forces and torques.
+//
+// Vertices store the glyph origin plus offsets in units of the wrench
+// magnitude and of the arrow width. Scale, width, color and colormap are
+// uniforms of one shared force material and one shared torque material, so
+// changing them costs the same whatever the history length, and coloring
+// by magnitude needs neither more materials nor vertex colors.
+//
+// With a WrenchLevelOfDetail, records are drawn according to their tier:
+// full glyphs, single line segments or not at all.
+class WrenchBatchRenderer
+{
+public:
+  WrenchBatchRenderer( Ogre::SceneManager* scene_manager, Ogre::SceneNode* parent_node );
+  ~WrenchBatchRenderer();
+
+  void setForceColor( float r, float g, float b, float a );
+  void setTorqueColor( float r, float g, float b, float a );
+  void setForceScale( float s );
+  void setTorqueScale( float s );
+  void setWidth( float w );
+  // Colors by magnitude instead of the force or torque color, except for
+  // the alpha, while the colormap is active.
+  void setForceColormap( const WrenchColormap& colormap );
+  void setTorqueColormap( const WrenchColormap& colormap );
+  void setVisible( bool visible );
+
+  // Whether FULL tier records are drawn. Displays that draw them with
+  // rviz::WrenchVisual only leave the lines to the renderer.
+  void setFullDetail( bool full_detail );
+
+  // Rebuilds the vertex buffers if history or the tiers of lod changed
+  // since the last call. Without lod every record is drawn in full.
+  void update( const WrenchHistory& history, const WrenchLevelOfDetail* lod = NULL );
+
+  // Triangles and non-empty sections, i.e. draw calls, of the last build.
+  size_t triangles() const { return triangles_; }
+  size_t batches() const { return batches_; }
+
+  // Estimated bytes held in vertex buffers and scratch space.
+  size_t memoryUsage() const;
+
+private:
+  void beginSection( unsigned int index, const std::string& material,
+                     Ogre::RenderOperation::OperationType operation, size_t vertices, size_t indices );
+  void endSection();
+  void appendVertex( const Ogre::Vector3& origin, const Ogre::Vector3& along,
+                     const Ogre::Vector3& across, float magnitude );
+  void appendArrow( const Ogre::Vector3& origin, const Ogre::Vector3& value, float magnitude );
+  void appendRing( const Ogre::Vector3& origin, const Ogre::Vector3& value, float magnitude );
+  void appendLine( const Ogre::Vector3& origin, const Ogre::Vector3& value, float magnitude );
+  bool drawn( const WrenchLevelOfDetail* lod, size_t i, WrenchLevelOfDetail::Tier tier ) const;
+  // Rewrites the vertices of records of a build without level of detail.
+  void updateRecords( const WrenchHistory& history, const std::vector<uint32_t>& records );
+  // Writes the vertices appended to patch_ to section from vertex first on.
+  void writePatch( unsigned int section, size_t first );
+  void updateMaterial( const std::string& name, const Ogre::ColourValue& color, float scale,
+                       const WrenchColormap& colormap );
+
+  Ogre::SceneManager* scene_manager_;
+  Ogre::SceneNode* scene_node_;
+  Ogre::ManualObject* manual_object_;
+  std::string force_material_;
+  std::string torque_material_;
+
+  // All records of the history gathered for the transform kernel.
+  std::vector<Ogre::Vector3> positions_;
+  WrenchSoA wrenches_;
+  RotationSoA rotations_;
+  WrenchSoA rotated_;
+  std::vector<float> force_norms_, torque_norms_;
+
+  Ogre::ColourValue force_color_, torque_color_;
+  WrenchColormap force_colormap_, torque_colormap_;
+  float force_scale_, torque_scale_, width_;
+
+  // Geometry of the section being built.
+  bool creating_section_;
+  // Vertices go to patch_ instead of the ManualObject while patching_.
+  bool patching_;
+  std::vector<float> patch_;
+  unsigned int section_vertices_;
+  // Version of the history and of the tiers the vertex buffers were
+  // built from.
+  unsigned long version_;
+  unsigned long lod_version_;
+  bool built_with_lod_;
+  bool full_detail_;
+  bool built_full_detail_;
+  size_t glyphs_;
+  size_t lines_;
+  size_t triangles_;
+  size_t batches_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_BATCH_RENDERER_H
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cmath>
+
+#include "wrench_colormap.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+// Control points of the palettes, evenly spaced over the range.
+const float VIRIDIS_POINTS[][3] = {
+  { 0.267f, 0.005f, 0.329f }, { 0.283f, 0.141f, 0.458f }, { 0.254f, 0.265f, 0.530f },
+  { 0.207f, 0.372f, 0.553f }, { 0.164f, 0.471f, 0.558f }, { 0.128f, 0.567f, 0.551f },
+  { 0.135f, 0.659f, 0.518f }, { 0.267f, 0.749f, 0.441f }, { 0.478f, 0.821f, 0.318f },
+  { 0.741f, 0.873f, 0.150f }, { 0.993f, 0.906f, 0.144f }
+};
+const float HEAT_POINTS[][3] = {
+  { 0.3f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }
+};
+const float RAINBOW_POINTS[][3] = {
+  { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }
+};
+
+Ogre::ColourValue interpolate( const float ( *points )[3], size_t count, float t )
+{
+  float x = t * ( count - 1 );
+  size_t i = std::min<size_t>( static_cast<size_t>( x ), count - 2 );
+  float f = x - i;
+  return Ogre::ColourValue( points[i][0] + f * ( points[i + 1][0] - points[i][0] ),
+                            points[i][1] + f * ( points[i + 1][1] - points[i][1] ),
+                            points[i][2] + f * ( points[i + 1][2] - points[i][2] ));
+}
+}
+
+const size_t WrenchColormap::LEVELS;
+
+WrenchColormap::WrenchColormap()
+  : palette_( NONE )
+  , min_( 0 )
+  , max_( 1 )
+{
+  setPalette( NONE );
+}
+
+void WrenchColormap::setPalette( Palette palette )
+{
+  palette_ = palette;
+  for( size_t i = 0; i < LEVELS; i++ )
+  {
+    float t = static_cast<float>( i ) / ( LEVELS - 1 );
+    switch( palette )
+    {
+    case VIRIDIS:
+      colours_[i] = interpolate( VIRIDIS_POINTS, sizeof( VIRIDIS_POINTS ) / sizeof( VIRIDIS_POINTS[0] ), t );
+      break;
+    case HEAT:
+      colours_[i] = interpolate( HEAT_POINTS, sizeof( HEAT_POINTS ) / sizeof( HEAT_POINTS[0] ), t );
+      break;
+    case RAINBOW:
+      colours_[i] = interpolate( RAINBOW_POINTS, sizeof( RAINBOW_POINTS ) / sizeof( RAINBOW_POINTS[0] ), t );
+      break;
+    default:
+      colours_[i] = Ogre::ColourValue( 1, 1, 1 );
+      break;
+    }
+  }
+}
+
+void WrenchColormap::setRange( float min, float max )
+{
+  min_ = min;
+  max_ = max;
+}
+
+// Must match the lookup in the vertex program of WrenchBatchRenderer.
+size_t WrenchColormap::level( float magnitude ) const
+{
+  if( !( max_ > min_ ))
+  {
+    return magnitude >= max_ ? LEVELS - 1 : 0;
+  }
+  float t = ( magnitude - min_ ) / ( max_ - min_ );
+  if( !( t > 0 ))
+  {
+    return 0;
+  }
+  if( t >= 1 )
+  {
+    return LEVELS - 1;
+  }
+  return static_cast<size_t>( std::floor( t * ( LEVELS - 1 ) + 0.5f ));
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,56 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_COLORMAP_H
+#define MY_RVIZ_PLUGIN_WRENCH_COLORMAP_H
+
+#include <cstddef>
+
+#include <OgreColourValue.h>
+
+namespace my_rviz_plugin
+{
+
+// Colors wrenches by their magnitude with a built-in palette, so that
+// overloaded sensors stand out.
+//
+// A magnitude is quantized to one of LEVELS colors between the ends of
+// the range; magnitudes outside the range get the end colors. The batch
+// renderer does the same lookup in its vertex program from the palette
+// in lut(), so colors cost no material and no vertex rebuild of their own.
+class WrenchColormap
+{
+public:
+  enum Palette
+  {
+    NONE,
+    VIRIDIS,
+    HEAT,
+    RAINBOW
+  };
+
+  static const size_t LEVELS = 16;
+
+  WrenchColormap();
+
+  void setPalette( Palette palette );
+  Palette palette() const { return palette_; }
+  bool active() const { return palette_ != NONE; }
+
+  void setRange( float min, float max );
+  float min() const { return min_; }
+  float max() const { return max_; }
+
+  size_t level( float magnitude ) const;
+  const Ogre::ColourValue& colour( size_t level ) const { return colours_[level]; }
+  const Ogre::ColourValue& colourOf( float magnitude ) const { return colours_[level( magnitude )]; }
+
+  // The palette as LEVELS rgba quadruples.
+  const float* lut() const { return &colours_[0].r; }
+
+private:
+  Palette palette_;
+  float min_, max_;
+  Ogre::ColourValue colours_[LEVELS];
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_COLORMAP_H
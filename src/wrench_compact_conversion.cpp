@@ -0,0 +1,61 @@
+#include <limits>
+
+#include "wrench_compact_conversion.h"
+
+namespace my_rviz_plugin
+{
+
+bool toCompact( const my_rviz_plugin::WrenchStampedArray& in,
+                my_rviz_plugin::WrenchStampedArrayCompact& out )
+{
+  size_t size = in.wrenchstampeds.size();
+  out.header = in.header;
+  out.frame_ids.clear();
+  out.frame_indices.resize( size );
+  out.forces.resize( 3 * size );
+  out.torques.resize( 3 * size );
+  out.stamps.clear();
+
+  bool shared_stamp = true;
+  for( size_t i = 0; i < size; i++ )
+  {
+    const geometry_msgs::WrenchStamped& wrench = in.wrenchstampeds[i];
+
+    // Arrays only have a handful of distinct frames.
+    size_t index = 0;
+    while( index < out.frame_ids.size() && out.frame_ids[index] != wrench.header.frame_id )
+    {
+      index++;
+    }
+    if( index == out.frame_ids.size() )
+    {
+      if( index > std::numeric_limits<uint16_t>::max() )
+      {
+        return false;
+      }
+      out.frame_ids.push_back( wrench.header.frame_id );
+    }
+    out.frame_indices[i] = index;
+
+    out.forces[3 * i] = wrench.wrench.force.x;
+    out.forces[3 * i + 1] = wrench.wrench.force.y;
+    out.forces[3 * i + 2] = wrench.wrench.force.z;
+    out.torques[3 * i] = wrench.wrench.torque.x;
+    out.torques[3 * i + 1] = wrench.wrench.torque.y;
+    out.torques[3 * i + 2] = wrench.wrench.torque.z;
+
+    shared_stamp = shared_stamp && wrench.header.stamp == in.header.stamp;
+  }
+
+  if( !shared_stamp )
+  {
+    out.stamps.resize( size );
+    for( size_t i = 0; i < size; i++ )
+    {
+      out.stamps[i] = in.wrenchstampeds[i].header.stamp;
+    }
+  }
+  return true;
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,19 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_COMPACT_CONVERSION_H
+#define MY_RVIZ_PLUGIN_WRENCH_COMPACT_CONVERSION_H
+
+#include <my_rviz_plugin/WrenchStampedArray.h>
+#include <my_rviz_plugin/WrenchStampedArrayCompact.h>
+
+namespace my_rviz_plugin
+{
+
+// Converts a WrenchStampedArray into its structure-of-arrays form.
+// Frame ids are deduplicated. stamps is left empty when every element
+// carries the stamp of the array header. Returns false if the array has
+// more distinct frames than frame_indices can address.
+bool toCompact( const my_rviz_plugin::WrenchStampedArray& in,
+                my_rviz_plugin::WrenchStampedArrayCompact& out );
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_COMPACT_CONVERSION_H
@@ -0,0 +1,125 @@
+#include <cstdlib>
+#include <cctype>
+
+#include "wrench_cull_filter.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+bool isIndex( const std::string& token )
+{
+  if( token.empty() )
+  {
+    return false;
+  }
+  for( size_t i = 0; i < token.size(); i++ )
+  {
+    if( !std::isdigit( static_cast<unsigned char>( token[i] )))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+WrenchCullFilter::WrenchCullFilter()
+  : min_force2_( 0 )
+  , min_torque2_( 0 )
+  , hide_torque_( false )
+  , pass_all_( true )
+{
+}
+
+void WrenchCullFilter::setMinForce( float magnitude )
+{
+  min_force2_ = magnitude > 0 ? magnitude * magnitude : 0;
+  updatePassAll();
+}
+
+void WrenchCullFilter::setMinTorque( float magnitude )
+{
+  min_torque2_ = magnitude > 0 ? magnitude * magnitude : 0;
+  updatePassAll();
+}
+
+void WrenchCullFilter::setHideTorque( bool hide )
+{
+  hide_torque_ = hide;
+  updatePassAll();
+}
+
+void WrenchCullFilter::setInclude( const std::string& spec )
+{
+  include_.parse( spec );
+  updatePassAll();
+}
+
+void WrenchCullFilter::setExclude( const std::string& spec )
+{
+  exclude_.parse( spec );
+  updatePassAll();
+}
+
+void WrenchCullFilter::updatePassAll()
+{
+  pass_all_ = min_force2_ == 0 && min_torque2_ == 0 && !hide_torque_ && include_.empty() && exclude_.empty();
+}
+
+void WrenchCullFilter::List::parse( const std::string& spec )
+{
+  ranges.clear();
+  frames.clear();
+  size_t pos = 0;
+  while( pos < spec.size() )
+  {
+    size_t end = spec.find_first_of( ", \t", pos );
+    if( end == std::string::npos )
+    {
+      end = spec.size();
+    }
+    std::string token = spec.substr( pos, end - pos );
+    pos = end + 1;
+    if( token.empty() )
+    {
+      continue;
+    }
+
+    size_t dash = token.find( '-' );
+    if( isIndex( token ))
+    {
+      size_t index = std::strtoul( token.c_str(), NULL, 10 );
+      ranges.push_back( std::make_pair( index, index ));
+    }
+    else if( dash != std::string::npos && isIndex( token.substr( 0, dash )) && isIndex( token.substr( dash + 1 )))
+    {
+      ranges.push_back( std::make_pair( std::strtoul( token.substr( 0, dash ).c_str(), NULL, 10 ),
+                                        std::strtoul( token.substr( dash + 1 ).c_str(), NULL, 10 )));
+    }
+    else
+    {
+      // tf2 frame ids carry no leading slash, older publishers may.
+      frames.insert( token[0] == '/' ? token.substr( 1 ) : token );
+    }
+  }
+}
+
+bool WrenchCullFilter::List::contains( size_t index, const std::string& frame ) const
+{
+  for( size_t i = 0; i < ranges.size(); i++ )
+  {
+    if( index >= ranges[i].first && index <= ranges[i].second )
+    {
+      return true;
+    }
+  }
+  if( frames.empty() )
+  {
+    return false;
+  }
+  return frames.count( !frame.empty() && frame[0] == '/' ? frame.substr( 1 ) : frame ) > 0;
+}
+
+} // end namespace my_rviz_plugin
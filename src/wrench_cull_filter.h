@@ -0,0 +1,99 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_CULL_FILTER_H
+#define MY_RVIZ_PLUGIN_WRENCH_CULL_FILTER_H
+
+#include <set>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+#include "wrench_kernel.h"
+
+namespace my_rviz_plugin
+{
+
+// Decides which elements of an array, and which of their parts, are
+// drawn at all. It is consulted before the transform of an element is
+// looked up, so a culled element costs a few comparisons.
+//
+// An element is culled if it is not included, if it is excluded, or if
+// neither its force nor its torque is drawn. Force and torque below their
+// minimum magnitude are not drawn; neither is any torque while torque is
+// hidden.
+class WrenchCullFilter
+{
+public:
+  enum Part
+  {
+    FORCE = 1,
+    TORQUE = 2
+  };
+
+  WrenchCullFilter();
+
+  void setMinForce( float magnitude );
+  void setMinTorque( float magnitude );
+  void setHideTorque( bool hide );
+
+  // spec lists element indices, index ranges like 2-5 and frame ids,
+  // separated by commas or spaces. An empty include list includes all
+  // elements.
+  void setInclude( const std::string& spec );
+  void setExclude( const std::string& spec );
+
+  // Parts of element index of frame to draw; 0 if it is culled.
+  unsigned parts( size_t index, const std::string& frame, const WrenchSoA& wrenches, size_t i ) const
+  {
+    if( pass_all_ )
+    {
+      return FORCE | TORQUE;
+    }
+    if( !accepts( index, frame ))
+    {
+      return 0;
+    }
+    unsigned parts = 0;
+    if( wrenches.fx[i] * wrenches.fx[i] + wrenches.fy[i] * wrenches.fy[i] +
+        wrenches.fz[i] * wrenches.fz[i] >= min_force2_ )
+    {
+      parts |= FORCE;
+    }
+    if( !hide_torque_ &&
+        wrenches.tx[i] * wrenches.tx[i] + wrenches.ty[i] * wrenches.ty[i] +
+        wrenches.tz[i] * wrenches.tz[i] >= min_torque2_ )
+    {
+      parts |= TORQUE;
+    }
+    return parts;
+  }
+
+private:
+  struct List
+  {
+    std::vector<std::pair<size_t, size_t> > ranges;
+    std::set<std::string> frames;
+
+    void parse( const std::string& spec );
+    bool empty() const { return ranges.empty() && frames.empty(); }
+    bool contains( size_t index, const std::string& frame ) const;
+  };
+
+  bool accepts( size_t index, const std::string& frame ) const
+  {
+    return ( include_.empty() || include_.contains( index, frame )) && !exclude_.contains( index, frame );
+  }
+
+  void updatePassAll();
+
+  float min_force2_;
+  float min_torque2_;
+  bool hide_torque_;
+  List include_;
+  List exclude_;
+  // Nothing is culled or hidden.
+  bool pass_all_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_CULL_FILTER_H
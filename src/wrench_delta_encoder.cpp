@@ -0,0 +1,81 @@
+#include "wrench_delta_encoder.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+double distance2( const geometry_msgs::Vector3& a, const geometry_msgs::Vector3& b )
+{
+  double dx = a.x - b.x;
+  double dy = a.y - b.y;
+  double dz = a.z - b.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+}
+
+WrenchDeltaEncoder::WrenchDeltaEncoder()
+  : force_threshold2_( 0 )
+  , torque_threshold2_( 0 )
+  , keyframe_interval_( 100 )
+  , since_keyframe_( 0 )
+  , keyframe_requested_( true )
+  , sequence_( 0 )
+{
+}
+
+void WrenchDeltaEncoder::setThresholds( double force, double torque )
+{
+  force_threshold2_ = force > 0 ? force * force : 0;
+  torque_threshold2_ = torque > 0 ? torque * torque : 0;
+}
+
+void WrenchDeltaEncoder::setKeyframeInterval( size_t interval )
+{
+  keyframe_interval_ = interval;
+}
+
+bool WrenchDeltaEncoder::changed( const geometry_msgs::WrenchStamped& sent,
+                                  const geometry_msgs::WrenchStamped& now ) const
+{
+  // With a threshold of 0 any difference is a change; nans always are.
+  return !( distance2( sent.wrench.force, now.wrench.force ) <= force_threshold2_ ) ||
+         !( distance2( sent.wrench.torque, now.wrench.torque ) <= torque_threshold2_ ) ||
+         sent.header.frame_id != now.header.frame_id;
+}
+
+void WrenchDeltaEncoder::encode( const my_rviz_plugin::WrenchStampedArray& in,
+                                 my_rviz_plugin::WrenchStampedArrayDelta& out )
+{
+  size_t size = in.wrenchstampeds.size();
+  out.header = in.header;
+  out.sequence = sequence_++;
+  out.size = size;
+  out.indices.clear();
+  out.wrenchstampeds.clear();
+
+  since_keyframe_++;
+  out.keyframe = keyframe_requested_ || size != sent_.size() ||
+                 ( keyframe_interval_ > 0 && since_keyframe_ >= keyframe_interval_ );
+  if( out.keyframe )
+  {
+    out.wrenchstampeds = in.wrenchstampeds;
+    sent_ = in.wrenchstampeds;
+    since_keyframe_ = 0;
+    keyframe_requested_ = false;
+    return;
+  }
+
+  for( size_t i = 0; i < size; i++ )
+  {
+    const geometry_msgs::WrenchStamped& now = in.wrenchstampeds[i];
+    if( changed( sent_[i], now ))
+    {
+      out.indices.push_back( i );
+      out.wrenchstampeds.push_back( now );
+      sent_[i] = now;
+    }
+  }
+}
+
+} // end namespace my_rviz_plugin
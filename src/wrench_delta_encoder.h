@@ -0,0 +1,48 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_DELTA_ENCODER_H
+#define MY_RVIZ_PLUGIN_WRENCH_DELTA_ENCODER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <my_rviz_plugin/WrenchStampedArray.h>
+#include <my_rviz_plugin/WrenchStampedArrayDelta.h>
+
+namespace my_rviz_plugin
+{
+
+// Sender side of WrenchStampedArrayDelta: sends the elements whose force
+// or torque moved by more than a threshold since they were last sent, or
+// whose frame changed, and a keyframe with every element every few
+// messages, so that receivers that join late or miss a message recover.
+class WrenchDeltaEncoder
+{
+public:
+  WrenchDeltaEncoder();
+
+  // Changes of the force [N] and torque [Nm] vectors up to these lengths
+  // are not sent. 0 sends every change.
+  void setThresholds( double force, double torque );
+  // Every interval-th message is a keyframe. 0 only sends keyframes when
+  // the array changes size.
+  void setKeyframeInterval( size_t interval );
+  // Makes the next message a keyframe.
+  void requestKeyframe() { keyframe_requested_ = true; }
+
+  void encode( const my_rviz_plugin::WrenchStampedArray& in, my_rviz_plugin::WrenchStampedArrayDelta& out );
+
+private:
+  bool changed( const geometry_msgs::WrenchStamped& sent, const geometry_msgs::WrenchStamped& now ) const;
+
+  // Value of every element as the receivers have it.
+  std::vector<geometry_msgs::WrenchStamped> sent_;
+  double force_threshold2_, torque_threshold2_;
+  size_t keyframe_interval_;
+  size_t since_keyframe_;
+  bool keyframe_requested_;
+  uint32_t sequence_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_DELTA_ENCODER_H
@@ -0,0 +1,245 @@
+#include <algorithm>
+
+#include "wrench_delta_state.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+WrenchGlyph hiddenGlyph()
+{
+  WrenchGlyph glyph;
+  glyph.position = Ogre::Vector3::ZERO;
+  glyph.orientation = Ogre::Quaternion::IDENTITY;
+  glyph.force = Ogre::Vector3::ZERO;
+  glyph.torque = Ogre::Vector3::ZERO;
+  return glyph;
+}
+
+bool sameGlyph( const WrenchGlyph& a, const WrenchGlyph& b )
+{
+  return a.position == b.position && a.orientation == b.orientation &&
+         a.force == b.force && a.torque == b.torque;
+}
+}
+
+WrenchDeltaState::WrenchDeltaState()
+  : keyframe_( false )
+  , all_( false )
+  , last_keyframe_( false )
+  , next_sequence_( 0 )
+  , synchronized_( false )
+  , gaps_( 0 )
+  , dropped_( 0 )
+{
+}
+
+bool WrenchDeltaState::accept( const my_rviz_plugin::WrenchStampedArrayDelta& msg )
+{
+  if( !WrenchStampedArrayDeltaElements( msg ).consistent() )
+  {
+    ROS_ERROR_THROTTLE(1.0, "Wrench delta message arrays have inconsistent sizes. Skipping the message");
+    dropped_++;
+    return false;
+  }
+  if( msg.keyframe )
+  {
+    if( synchronized_ && msg.sequence != next_sequence_ )
+    {
+      gaps_++;
+    }
+    synchronized_ = true;
+    next_sequence_ = msg.sequence + 1;
+    return true;
+  }
+  if( synchronized_ && msg.sequence != next_sequence_ )
+  {
+    gaps_++;
+    synchronized_ = false;
+  }
+  if( !synchronized_ || msg.size != array_.wrenchstampeds.size() )
+  {
+    dropped_++;
+    return false;
+  }
+  for( size_t k = 0; k < msg.indices.size(); k++ )
+  {
+    if( msg.indices[k] >= array_.wrenchstampeds.size() )
+    {
+      ROS_ERROR_THROTTLE(1.0, "Wrench delta message has an index beyond its size. Skipping the message");
+      dropped_++;
+      return false;
+    }
+  }
+  next_sequence_ = msg.sequence + 1;
+  return true;
+}
+
+uint32_t WrenchDeltaState::frameOf( size_t i )
+{
+  const std_msgs::Header& header = array_.wrenchstampeds[i].header;
+  bool latest = header.stamp.isZero();
+  // Arrays only have a handful of distinct frames.
+  uint32_t f = 0;
+  while( f < frames_.size() && ( frames_[f].latest != latest || frames_[f].id != header.frame_id ))
+  {
+    f++;
+  }
+  if( f == frames_.size() )
+  {
+    Frame frame;
+    frame.id = header.frame_id;
+    frame.latest = latest;
+    frame.valid = false;
+    frames_.push_back( frame );
+  }
+  frames_[f].elements.push_back( i );
+  element_frames_[i] = f;
+  return f;
+}
+
+void WrenchDeltaState::rebuildFrames()
+{
+  frames_.clear();
+  element_frames_.resize( array_.wrenchstampeds.size() );
+  for( size_t i = 0; i < array_.wrenchstampeds.size(); i++ )
+  {
+    frameOf( i );
+  }
+}
+
+void WrenchDeltaState::apply( const my_rviz_plugin::WrenchStampedArrayDelta& msg,
+                              TransformSource& source, TransformCache& cache )
+{
+  array_.header = msg.header;
+  all_ = keyframe_ || msg.keyframe;
+  last_keyframe_ = msg.keyframe;
+  keyframe_ = false;
+  elements_.clear();
+  if( msg.keyframe )
+  {
+    array_.wrenchstampeds = msg.wrenchstampeds;
+    carried_.assign( array_.wrenchstampeds.size(), 1 );
+  }
+  else
+  {
+    for( size_t k = 0; k < msg.indices.size(); k++ )
+    {
+      uint32_t i = msg.indices[k];
+      array_.wrenchstampeds[i] = msg.wrenchstampeds[k];
+      if( carried_[i] )
+      {
+        continue;
+      }
+      carried_[i] = 1;
+      elements_.push_back( i );
+      if( all_ )
+      {
+        continue;
+      }
+      // An element that changed frames moves to the other one.
+      const std_msgs::Header& header = array_.wrenchstampeds[i].header;
+      Frame& frame = frames_[element_frames_[i]];
+      if( frame.id != header.frame_id || frame.latest != header.stamp.isZero() )
+      {
+        std::vector<uint32_t>& elements = frame.elements;
+        *std::find( elements.begin(), elements.end(), i ) = elements.back();
+        elements.pop_back();
+        frameOf( i );
+      }
+    }
+  }
+
+  size_t size = array_.wrenchstampeds.size();
+  if( all_ )
+  {
+    rebuildFrames();
+    elements_.resize( size );
+    for( size_t i = 0; i < size; i++ )
+    {
+      elements_[i] = i;
+    }
+    glyphs_.resize( size, hiddenGlyph() );
+  }
+
+  for( size_t f = 0; f < frames_.size(); f++ )
+  {
+    Frame& frame = frames_[f];
+    Ogre::Vector3 position;
+    Ogre::Quaternion orientation;
+    bool valid = cache.getTransform( source, frame.id, frame.latest ? ros::Time() : msg.header.stamp,
+                                     position, orientation );
+    bool moved = valid != frame.valid ||
+                 ( valid && ( position != frame.position || orientation != frame.orientation ));
+    frame.valid = valid;
+    frame.position = position;
+    frame.orientation = orientation;
+    if( !moved || all_ )
+    {
+      continue;
+    }
+    for( size_t k = 0; k < frame.elements.size(); k++ )
+    {
+      if( !carried_[frame.elements[k]] )
+      {
+        elements_.push_back( frame.elements[k] );
+      }
+    }
+  }
+}
+
+void WrenchDeltaState::update( const WrenchRecordBatch& batch )
+{
+  previous_.resize( elements_.size() );
+  for( size_t k = 0; k < elements_.size(); k++ )
+  {
+    previous_[k] = glyphs_[elements_[k]];
+    glyphs_[elements_[k]] = hiddenGlyph();
+  }
+  samples_.clear();
+  sample_elements_.clear();
+  for( size_t j = 0; j < batch.glyphs.size(); j++ )
+  {
+    uint32_t i = batch.elements[j];
+    glyphs_[i] = batch.glyphs[j];
+    if( carried_[i] )
+    {
+      samples_.push_back( batch.glyphs[j] );
+      sample_elements_.push_back( i );
+    }
+  }
+
+  changed_.clear();
+  for( size_t k = 0; k < elements_.size(); k++ )
+  {
+    uint32_t i = elements_[k];
+    if( all_ || !sameGlyph( glyphs_[i], previous_[k] ))
+    {
+      changed_.push_back( i );
+    }
+    carried_[i] = 0;
+  }
+}
+
+void WrenchDeltaState::clear()
+{
+  array_.wrenchstampeds.clear();
+  keyframe_ = false;
+  all_ = false;
+  last_keyframe_ = false;
+  frames_.clear();
+  element_frames_.clear();
+  elements_.clear();
+  carried_.clear();
+  glyphs_.clear();
+  previous_.clear();
+  changed_.clear();
+  samples_.clear();
+  sample_elements_.clear();
+  synchronized_ = false;
+  gaps_ = 0;
+  dropped_ = 0;
+}
+
+} // end namespace my_rviz_plugin
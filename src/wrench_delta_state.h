@@ -0,0 +1,114 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_DELTA_STATE_H
+#define MY_RVIZ_PLUGIN_WRENCH_DELTA_STATE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <my_rviz_plugin/WrenchStampedArray.h>
+#include <my_rviz_plugin/WrenchStampedArrayDelta.h>
+
+#include "wrench_elements.h"
+
+namespace my_rviz_plugin
+{
+
+// Receiver side of WrenchStampedArrayDelta. Keeps the last value of every
+// element in its sensor frame, as a whole WrenchStampedArray, and the
+// resolved elements as glyphs; elements that are not drawn keep a glyph
+// with zero force and torque, so that glyph i always is element i.
+//
+// A message only costs work for the elements it carries and for those in
+// frames that moved: the transform of each distinct frame is looked up
+// once per message and compared with the one of the previous message, and
+// only the elements of frames whose transform changed are resolved again
+// with the carried ones. Every element is looked up at the stamp of the
+// message, or at the latest transform if it is stamped 0.
+class WrenchDeltaState
+{
+public:
+  WrenchDeltaState();
+
+  // Checks the sequence of msg. False if msg cannot be applied: a delta
+  // before the first keyframe or after a missed message, which are
+  // dropped until the next keyframe, or a malformed message.
+  bool accept( const my_rviz_plugin::WrenchStampedArrayDelta& msg );
+
+  // Updates array() with the elements of msg and lists in elements() those
+  // to resolve again: the ones msg carries and the ones in frames that
+  // moved, or all of them after a keyframe or invalidate(). The transforms
+  // of the frames are looked up through cache, like resolveElements() does.
+  void apply( const my_rviz_plugin::WrenchStampedArrayDelta& msg,
+              TransformSource& source, TransformCache& cache );
+  const my_rviz_plugin::WrenchStampedArray& array() const { return array_; }
+  const std::vector<uint32_t>& elements() const { return elements_; }
+
+  // Replaces the glyphs of elements() with batch, the result of
+  // resolveElements() on WrenchStampedArraySubsetElements( array(),
+  // elements(), stamp of the message ).
+  void update( const WrenchRecordBatch& batch );
+  const std::vector<WrenchGlyph>& glyphs() const { return glyphs_; }
+  // Glyphs that differ from those before the last update(), in their
+  // wrench or their pose. All of them after a keyframe.
+  const std::vector<uint32_t>& changed() const { return changed_; }
+  // Glyphs of the elements the last message carried, with their indices,
+  // i.e. the new samples of the message.
+  const std::vector<WrenchGlyph>& samples() const { return samples_; }
+  const std::vector<uint32_t>& sampleElements() const { return sample_elements_; }
+  // Whether the last message was a keyframe, which carries every element.
+  bool keyframe() const { return last_keyframe_; }
+
+  // Resolves every element again with the next message, e.g. after the
+  // culling settings changed.
+  void invalidate() { keyframe_ = true; }
+
+  // Missed messages and messages dropped while waiting for a keyframe.
+  size_t gaps() const { return gaps_; }
+  size_t dropped() const { return dropped_; }
+  bool synchronized() const { return synchronized_; }
+
+  void clear();
+
+private:
+  // Elements that share a frame and are looked up at the same stamp.
+  struct Frame
+  {
+    std::string id;
+    bool latest;
+    bool valid;
+    Ogre::Vector3 position;
+    Ogre::Quaternion orientation;
+    std::vector<uint32_t> elements;
+  };
+
+  // Index in frames_ of the frame element i is in, added if needed.
+  uint32_t frameOf( size_t i );
+  void rebuildFrames();
+
+  my_rviz_plugin::WrenchStampedArray array_;
+  // Resolve every element with the next message.
+  bool keyframe_;
+  std::vector<Frame> frames_;
+  std::vector<uint32_t> element_frames_;
+  std::vector<uint32_t> elements_;
+  // Elements the last message carried; reset after each update().
+  std::vector<uint8_t> carried_;
+  // Whether the last apply() resolves every element.
+  bool all_;
+  bool last_keyframe_;
+  std::vector<WrenchGlyph> glyphs_;
+  // Scratch space of update().
+  std::vector<WrenchGlyph> previous_;
+  std::vector<uint32_t> changed_;
+  std::vector<WrenchGlyph> samples_;
+  std::vector<uint32_t> sample_elements_;
+  uint32_t next_sequence_;
+  bool synchronized_;
+  size_t gaps_;
+  size_t dropped_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_DELTA_STATE_H
@@ -62,72 +62,25 @@ yet been invented or conceived.
 
  */
 
-#include <OgreSceneNode.h>
-#include <OgreSceneManager.h>
-
-#include <rviz/visualization_manager.h>
-#include <rviz/frame_manager.h>
-#include <rviz/properties/color_property.h>
-#include <rviz/properties/float_property.h>
-#include <rviz/properties/int_property.h>
-#include <rviz/properties/parse_color.h>
 #include <rviz/validate_floats.h>
 
-#include <boost/foreach.hpp>
-
-#include <rviz/default_plugin/wrench_visual.h>
-
 #include "wrench_display.h"
 
 namespace my_rviz_plugin
 {
 
 WrenchStampedDisplay::WrenchStampedDisplay()
+  : engine_( this )
 {
-    force_color_property_ =
-            new rviz::ColorProperty( "Force Color", QColor( 204, 51, 51 ),
-                                     "Color to draw the force arrows.",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    torque_color_property_ =
-            new rviz::ColorProperty( "Torque Color", QColor( 204, 204, 51),
-                                     "Color to draw the torque arrows.",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    alpha_property_ =
-            new rviz::FloatProperty( "Alpha", 1.0,
-                                     "0 is fully transparent, 1.0 is fully opaque.",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    force_scale_property_ =
-            new rviz::FloatProperty( "Force Arrow Scale", 2.0,
-                                     "force arrow scale",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    torque_scale_property_ =
-            new rviz::FloatProperty( "Torque Arrow Scale", 2.0,
-                                     "torque arrow scale",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-    width_property_ =
-            new rviz::FloatProperty( "Arrow Width", 0.5,
-                                     "arrow width",
-                                     this, SLOT( updateColorAndAlpha() ));
-
-
-    history_length_property_ =
-            new rviz::IntProperty( "History Length", 1,
-                                   "Number of prior measurements to display.",
-                                   this, SLOT( updateHistoryLength() ));
-
-    history_length_property_->setMin( 1 );
-    history_length_property_->setMax( 100000 );
+    // A wrench with nans or without a transform keeps the last arrow up.
+    engine_.setSkipEmptyMessages( true );
 }
 
 void WrenchStampedDisplay::onInitialize()
 {
     MFDClass::onInitialize();
-    updateHistoryLength( );
+    sub_.registerCallback( boost::bind( &WrenchDisplayEngine<WrenchStampedElements>::receiveMessage, &engine_, _1 ));
+    engine_.initialize( context_, scene_node_ );
 }
 
 WrenchStampedDisplay::~WrenchStampedDisplay()
@@ -138,36 +91,20 @@ WrenchStampedDisplay::~WrenchStampedDisplay()
 void WrenchStampedDisplay::reset()
 {
     MFDClass::reset();
-    visuals_.clear();
+    engine_.reset();
 }
 
-void WrenchStampedDisplay::updateColorAndAlpha()
+void WrenchStampedDisplay::update( float wall_dt, float ros_dt )
 {
-    float alpha = alpha_property_->getFloat();
-    float force_scale = force_scale_property_->getFloat();
-    float torque_scale = torque_scale_property_->getFloat();
-    float width = width_property_->getFloat();
-    Ogre::ColourValue force_color = force_color_property_->getOgreColor();
-    Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
-
-    for( size_t i = 0; i < visuals_.size(); i++ )
-    {
-        visuals_[i]->setForceColor( force_color.r, force_color.g, force_color.b, alpha );
-        visuals_[i]->setTorqueColor( torque_color.r, torque_color.g, torque_color.b, alpha );
-        visuals_[i]->setForceScale( force_scale );
-        visuals_[i]->setTorqueScale( torque_scale );
-        visuals_[i]->setWidth( width );
-    }
+    MFDClass::update( wall_dt, ros_dt );
+    engine_.update( wall_dt );
+    engine_.updateStatistics( wall_dt, update_nh_, 0 );
 }
 
-// Set the number of past visuals to show.
-void WrenchStampedDisplay::updateHistoryLength()
+void WrenchStampedDisplay::fixedFrameChanged()
 {
-  std::cerr<<">>UPDATEHISTORYLENGTH"<<std::endl;
-  //下の行を、visuals_のsizeが1以上のときに呼ぶと、警告なくrvizがcrashする。
-  //rviz_default_pluginでは発生しない。
-  visuals_.rset_capacity(history_length_property_->getInt());
-  std::cerr<<"<<UPDATEHISTORYLENGTH"<<std::endl;
+    engine_.fixedFrameChanged();
+    MFDClass::fixedFrameChanged();
 }
 
 bool validateFloats( const geometry_msgs::WrenchStamped& msg )
@@ -178,65 +115,7 @@ bool validateFloats( const geometry_msgs::WrenchStamped& msg )
 // This is our callback to handle an incoming message.
 void WrenchStampedDisplay::processMessage( const geometry_msgs::WrenchStamped::ConstPtr& msg )
 {
-  std::cerr<<">>PROCESSMESSAGE"<<std::endl;
-    if( !validateFloats( *msg ))
-    {
-        setStatus( rviz::StatusProperty::Error, "Topic", "Message contained invalid floating point values (nans or infs)" );
-        return;
-    }
-
-    // Here we call the rviz::FrameManager to get the transform from the
-    // fixed frame to the frame in the header of this Imu message.  If
-    // it fails, we can't do anything else so we return.
-    Ogre::Quaternion orientation;
-    Ogre::Vector3 position;
-    if( !context_->getFrameManager()->getTransform( msg->header.frame_id,
-                                                    msg->header.stamp,
-                                                    position, orientation ))
-    {
-        ROS_DEBUG( "Error transforming from frame '%s' to frame '%s'",
-                   msg->header.frame_id.c_str(), qPrintable( fixed_frame_ ));
-        return;
-    }
-
-    if ( position.isNaN() )
-    {
-        ROS_ERROR_THROTTLE(1.0, "Wrench position contains NaNs. Skipping render as long as the position is invalid");
-        return;
-    }
-
-    // We are keeping a circular buffer of visual pointers.  This gets
-    // the next one, or creates and stores it if the buffer is not full
-    boost::shared_ptr<rviz::WrenchVisual> visual;
-    if( visuals_.full() )
-    {
-        visual = visuals_.front();
-    }
-    else
-    {
-      visual.reset(new rviz::WrenchVisual( context_->getSceneManager(), scene_node_ ));
-    }
-
-    // Now set or update the contents of the chosen visual.
-    visual->setWrench( msg->wrench );
-    visual->setFramePosition( position );
-    visual->setFrameOrientation( orientation );
-    float alpha = alpha_property_->getFloat();
-    float force_scale = force_scale_property_->getFloat();
-    float torque_scale = torque_scale_property_->getFloat();
-    float width = width_property_->getFloat();
-    Ogre::ColourValue force_color = force_color_property_->getOgreColor();
-    Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
-    visual->setForceColor( force_color.r, force_color.g, force_color.b, alpha );
-    visual->setTorqueColor( torque_color.r, torque_color.g, torque_color.b, alpha );
-    visual->setForceScale( force_scale );
-    visual->setTorqueScale( torque_scale );
-    visual->setWidth( width );
-
-    // And send it to the end of the circular buffer
-    visuals_.push_back(visual);
-
-    std::cerr<<"<<PROCESSMESSAGE"<<std::endl;
+  engine_.processMessage( msg );
 }
 
 } // end namespace my_rviz_plugin
@@ -245,4 +124,3 @@ void WrenchStampedDisplay::processMessage( const geometry_msgs::WrenchStamped::C
 // global scope, outside our package's namespace.
 #include <pluginlib/class_list_macros.hpp>
 PLUGINLIB_EXPORT_CLASS( my_rviz_plugin::WrenchStampedDisplay, rviz::Display )
-
@@ -66,30 +66,10 @@ yet been invented or conceived.
 #ifndef MY_RVIZ_PLUGIN_WRENCHSTAMPED_DISPLAY_H
 #define MY_RVIZ_PLUGIN_WRENCHSTAMPED_DISPLAY_H
 
-#ifndef Q_MOC_RUN
-#include <boost/circular_buffer.hpp>
-#endif
-
 #include <geometry_msgs/WrenchStamped.h>
 #include <rviz/message_filter_display.h>
 
-namespace Ogre
-{
-class SceneNode;
-}
-
-namespace rviz
-{
-class ColorProperty;
-class ROSTopicStringProperty;
-class FloatProperty;
-class IntProperty;
-}
-
-namespace rviz
-{
-  class WrenchVisual;
-}
+#include "wrench_display_engine.h"
 
 namespace my_rviz_plugin
 {
@@ -107,25 +87,16 @@ protected:
     // Overrides of public virtual functions from the Display class.
     virtual void onInitialize();
     virtual void reset();
-
-private Q_SLOTS:
-    // Helper function to apply color and alpha to all visuals.
-    void updateColorAndAlpha();
-    void updateHistoryLength();
+    virtual void update( float wall_dt, float ros_dt );
+    virtual void fixedFrameChanged();
 
 private:
   // Function to handle an incoming ROS message.
   void processMessage( const geometry_msgs::WrenchStamped::ConstPtr& msg );
-  
-  // Storage for the list of visuals par each joint intem
-  // Storage for the list of visuals.  It is a circular buffer where
-  // data gets popped from the front (oldest) and pushed to the back (newest)
-  boost::circular_buffer<boost::shared_ptr<rviz::WrenchVisual> > visuals_;
-
-  // Property objects for user-editable properties.
-  rviz::ColorProperty *force_color_property_, *torque_color_property_;
-  rviz::FloatProperty *alpha_property_, *force_scale_property_, *torque_scale_property_, *width_property_;
-  rviz::IntProperty *history_length_property_;
+
+  // History, rendering and the properties shared with the other wrench
+  // displays. A message is a history record of one element.
+  WrenchDisplayEngine<WrenchStampedElements> engine_;
 };
 
   bool validateFloats( const geometry_msgs::WrenchStamped& msg );
@@ -133,4 +104,3 @@ private:
 } // end namespace my_rviz_plugin
 
 #endif // MY_RVIZ_PLUGIN_WRENCHSTAMPED_DISPLAY_H
-
@@ -0,0 +1,1178 @@
+#include <algorithm>
+
+#include <OgreSceneNode.h>
+#include <OgreSceneManager.h>
+
+#include <rviz/display.h>
+#include <rviz/display_context.h>
+#include <rviz/frame_manager.h>
+#include <rviz/view_manager.h>
+#include <rviz/view_controller.h>
+#include <rviz/properties/color_property.h>
+#include <rviz/properties/float_property.h>
+#include <rviz/properties/int_property.h>
+#include <rviz/properties/enum_property.h>
+#include <rviz/properties/bool_property.h>
+#include <rviz/properties/string_property.h>
+
+#include <rviz/default_plugin/wrench_visual.h>
+
+#include "wrench_batch_renderer.h"
+
+#include "wrench_display_engine.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+// Values of the "Export Format" property.
+enum HistoryExportFormat
+{
+  EXPORT_CSV,
+  EXPORT_BINARY
+};
+
+// Shows glyph with visual, except for colors, scale and width.
+void showGlyph( rviz::WrenchVisual& visual, const WrenchGlyph& glyph )
+{
+  geometry_msgs::Wrench wrench;
+  wrench.force.x = glyph.force.x;
+  wrench.force.y = glyph.force.y;
+  wrench.force.z = glyph.force.z;
+  wrench.torque.x = glyph.torque.x;
+  wrench.torque.y = glyph.torque.y;
+  wrench.torque.z = glyph.torque.z;
+  visual.setWrench( wrench );
+  visual.setVisible( true );
+  visual.setFramePosition( glyph.position );
+  visual.setFrameOrientation( glyph.orientation );
+}
+
+// Newest messages kept between two frames while "History Duration" keeps
+// any number of messages.
+const size_t TIMED_MESSAGE_CAPACITY = 1000;
+}
+
+WrenchDisplayEngineBase::WrenchDisplayEngineBase( rviz::Display* display )
+  : display_( display )
+  , context_( NULL )
+  , scene_node_( NULL )
+  , max_array_size_( 0 )
+  , skip_empty_( false )
+  , envelope_version_( 0 )
+  , since_trace_write_( 0 )
+  , receipts_( 256 )
+  , trace_writing_( false )
+  , trace_written_( 0 )
+{
+    force_color_property_ =
+            new rviz::ColorProperty( "Force Color", QColor( 204, 51, 51 ),
+                                     "Color to draw the force arrows.",
+                                     display, SLOT( updateColorAndAlpha() ), this );
+
+    torque_color_property_ =
+            new rviz::ColorProperty( "Torque Color", QColor( 204, 204, 51),
+                                     "Color to draw the torque arrows.",
+                                     display, SLOT( updateColorAndAlpha() ), this );
+
+    alpha_property_ =
+            new rviz::FloatProperty( "Alpha", 1.0,
+                                     "0 is fully transparent, 1.0 is fully opaque.",
+                                     display, SLOT( updateColorAndAlpha() ), this );
+
+    force_scale_property_ =
+            new rviz::FloatProperty( "Force Arrow Scale", 2.0,
+                                     "force arrow scale",
+                                     display, SLOT( updateColorAndAlpha() ), this );
+
+    torque_scale_property_ =
+            new rviz::FloatProperty( "Torque Arrow Scale", 2.0,
+                                     "torque arrow scale",
+                                     display, SLOT( updateColorAndAlpha() ), this );
+
+    width_property_ =
+            new rviz::FloatProperty( "Arrow Width", 0.5,
+                                     "arrow width",
+                                     display, SLOT( updateColorAndAlpha() ), this );
+
+    colormap_property_ =
+            new rviz::EnumProperty( "Colormap", "None",
+                                    "Color the arrows by their magnitude instead of the force and torque colors.",
+                                    display, SLOT( updateColorAndAlpha() ), this );
+    colormap_property_->addOption( "None", WrenchColormap::NONE );
+    colormap_property_->addOption( "Viridis", WrenchColormap::VIRIDIS );
+    colormap_property_->addOption( "Heat", WrenchColormap::HEAT );
+    colormap_property_->addOption( "Rainbow", WrenchColormap::RAINBOW );
+
+    force_min_property_ =
+            new rviz::FloatProperty( "Force Min", 0.0,
+                                     "Force magnitude [N] at the low end of the colormap.",
+                                     colormap_property_, SLOT( updateColorAndAlpha() ), this );
+
+    force_max_property_ =
+            new rviz::FloatProperty( "Force Max", 100.0,
+                                     "Force magnitude [N] at the high end of the colormap.",
+                                     colormap_property_, SLOT( updateColorAndAlpha() ), this );
+
+    torque_min_property_ =
+            new rviz::FloatProperty( "Torque Min", 0.0,
+                                     "Torque magnitude [Nm] at the low end of the colormap.",
+                                     colormap_property_, SLOT( updateColorAndAlpha() ), this );
+
+    torque_max_property_ =
+            new rviz::FloatProperty( "Torque Max", 10.0,
+                                     "Torque magnitude [Nm] at the high end of the colormap.",
+                                     colormap_property_, SLOT( updateColorAndAlpha() ), this );
+
+
+    history_length_property_ =
+            new rviz::IntProperty( "History Length", 1,
+                                   "Number of prior measurements to display.",
+                                   display, SLOT( updateHistoryLength() ), this );
+
+    history_length_property_->setMin( 1 );
+    history_length_property_->setMax( 100000 );
+
+    history_duration_property_ =
+            new rviz::FloatProperty( "History Duration", 0.0,
+                                     "Seconds of prior measurements to display, by their stamps against the "
+                                     "current ROS time, however many messages that is. 0 displays History "
+                                     "Length messages instead.",
+                                     display, SLOT( updateHistoryLength() ), this );
+    history_duration_property_->setMin( 0.0 );
+
+    history_memory_property_ =
+            new rviz::IntProperty( "History Memory Limit", 0,
+                                   "Most memory [MB] the history and its visuals may take. The oldest "
+                                   "messages are dropped to stay within it. 0 is unlimited.",
+                                   display, SLOT( updateHistoryLength() ), this );
+    history_memory_property_->setMin( 0 );
+    history_memory_property_->setMax( 65536 );
+
+    history_file_property_ =
+            new rviz::StringProperty( "History File", "",
+                                      "File every shown message is also appended to, as a ring of fixed-size "
+                                      "records on disk. Only the History Length newest messages are kept in "
+                                      "memory and drawn. An existing file is reloaded. Empty disables it.",
+                                      display, SLOT( updateHistoryFile() ), this );
+
+    file_records_property_ =
+            new rviz::IntProperty( "File Records", 1000000,
+                                   "Number of wrenches a new history file holds, 52 bytes each. "
+                                   "Existing files keep their size.",
+                                   history_file_property_, SLOT( updateHistoryFile() ), this );
+    file_records_property_->setMin( 1 );
+
+    export_seconds_property_ =
+            new rviz::FloatProperty( "Export Seconds", 60.0,
+                                     "Seconds before the newest message to export. 0 exports the whole file.",
+                                     history_file_property_ );
+    export_seconds_property_->setMin( 0.0 );
+
+    export_format_property_ =
+            new rviz::EnumProperty( "Export Format", "CSV",
+                                    "CSV has one line per wrench. Binary is a history file of its own "
+                                    "that can be set as History File later.",
+                                    history_file_property_ );
+    export_format_property_->addOption( "CSV", EXPORT_CSV );
+    export_format_property_->addOption( "Binary", EXPORT_BINARY );
+
+    export_file_property_ =
+            new rviz::StringProperty( "Export File", "/tmp/wrench_history.csv",
+                                      "File the export is written to.",
+                                      history_file_property_ );
+
+    export_replace_property_ =
+            new rviz::BoolProperty( "Replace Export File", false,
+                                    "Let the export replace an existing Export File. The History File "
+                                    "itself is never replaced.",
+                                    history_file_property_ );
+
+    export_property_ =
+            new rviz::BoolProperty( "Export Now", false,
+                                    "Check to export the history file now.",
+                                    history_file_property_, SLOT( updateExportHistory() ), this );
+
+    render_mode_property_ =
+            new rviz::EnumProperty( "Render Mode", "Batched",
+                                    "Batched draws all wrenches with a few draw calls. "
+                                    "Per Visual creates one rviz WrenchVisual per wrench.",
+                                    display, SLOT( updateRenderMode() ), this );
+    render_mode_property_->addOption( "Batched", RENDER_BATCHED );
+    render_mode_property_->addOption( "Per Visual", RENDER_PER_VISUAL );
+
+    lod_property_ =
+            new rviz::BoolProperty( "Level of Detail", false,
+                                    "Draw wrenches that are small on screen or far away as lines, and skip those "
+                                    "outside the view or below the minimum size. Evaluated every frame.",
+                                    display, SLOT( updateLevelOfDetail() ), this );
+
+    lod_full_size_property_ =
+            new rviz::FloatProperty( "Full Detail Size", 20.0,
+                                     "Wrenches at least this many pixels long are drawn in full, shorter ones as lines.",
+                                     lod_property_, SLOT( updateLevelOfDetail() ), this );
+    lod_full_size_property_->setMin( 0.0 );
+
+    lod_min_size_property_ =
+            new rviz::FloatProperty( "Min Size", 1.0,
+                                     "Wrenches shorter than this many pixels are not drawn.",
+                                     lod_property_, SLOT( updateLevelOfDetail() ), this );
+    lod_min_size_property_->setMin( 0.0 );
+
+    lod_line_distance_property_ =
+            new rviz::FloatProperty( "Line Distance", 0.0,
+                                     "Wrenches farther than this from the camera [m] are drawn as lines at most. "
+                                     "0 disables it.",
+                                     lod_property_, SLOT( updateLevelOfDetail() ), this );
+    lod_line_distance_property_->setMin( 0.0 );
+
+    culling_property_ =
+            new rviz::Property( "Culling", QVariant(),
+                                "Elements left out before their transforms are looked up.",
+                                display );
+
+    min_force_property_ =
+            new rviz::FloatProperty( "Min Force", 0.0,
+                                     "Force arrows with a smaller magnitude are not drawn.",
+                                     culling_property_, SLOT( updateCulling() ), this );
+    min_force_property_->setMin( 0.0 );
+
+    min_torque_property_ =
+            new rviz::FloatProperty( "Min Torque", 0.0,
+                                     "Torque arrows with a smaller magnitude are not drawn.",
+                                     culling_property_, SLOT( updateCulling() ), this );
+    min_torque_property_->setMin( 0.0 );
+
+    hide_torque_property_ =
+            new rviz::BoolProperty( "Hide Torque", false,
+                                    "Draw no torque arrows at all.",
+                                    culling_property_, SLOT( updateCulling() ), this );
+
+    include_property_ =
+            new rviz::StringProperty( "Include", "",
+                                      "Element indices, index ranges like 2-5 and frame ids to draw, "
+                                      "separated by commas. Empty draws all elements.",
+                                      culling_property_, SLOT( updateCulling() ), this );
+
+    exclude_property_ =
+            new rviz::StringProperty( "Exclude", "",
+                                      "Element indices, index ranges like 2-5 and frame ids not to draw, "
+                                      "separated by commas.",
+                                      culling_property_, SLOT( updateCulling() ), this );
+
+    filter_property_ =
+            new rviz::EnumProperty( "Filter", "None",
+                                    "Smooths each element over the last messages in its own frame, before "
+                                    "culling and transforms. Only the newest message of a frame is drawn "
+                                    "while a filter is on.",
+                                    display, SLOT( updateFilter() ), this );
+    filter_property_->addOption( "None", WrenchFilter::NONE );
+    filter_property_->addOption( "Low Pass", WrenchFilter::LOW_PASS );
+    filter_property_->addOption( "Moving Average", WrenchFilter::MOVING_AVERAGE );
+    filter_property_->addOption( "Median", WrenchFilter::MEDIAN );
+
+    filter_window_property_ =
+            new rviz::IntProperty( "Filter Window", 10,
+                                   "Number of messages the filter averages over. The low pass filter "
+                                   "responds like a moving average of this many messages.",
+                                   filter_property_, SLOT( updateFilter() ), this );
+    filter_window_property_->setMin( 1 );
+    filter_window_property_->setMax( WrenchFilter::MAX_WINDOW );
+
+    envelope_property_ =
+            new rviz::BoolProperty( "Envelope", false,
+                                    "Also draws the minimum, maximum and mean force and torque of each element "
+                                    "over its last messages as faint arrows at its newest pose, which shows "
+                                    "the range of a sensor without a long history.",
+                                    display, SLOT( updateEnvelope() ), this );
+
+    envelope_window_property_ =
+            new rviz::IntProperty( "Envelope Window", 100,
+                                   "Number of messages of each element the envelope covers. Elements missing "
+                                   "from as many messages in a row are hidden, and longer windows draw fewer "
+                                   "elements.",
+                                   envelope_property_, SLOT( updateEnvelope() ), this );
+    envelope_window_property_->setMin( 1 );
+    envelope_window_property_->setMax( WrenchElementEnvelope::MAX_WINDOW );
+
+    envelope_alpha_property_ =
+            new rviz::FloatProperty( "Envelope Alpha", 0.3,
+                                     "0 is fully transparent, 1.0 is fully opaque.",
+                                     envelope_property_, SLOT( updateEnvelopeVisuals() ), this );
+    envelope_alpha_property_->setMin( 0.0 );
+    envelope_alpha_property_->setMax( 1.0 );
+
+    latest_only_property_ =
+            new rviz::BoolProperty( "Latest Only", false,
+                                    "Only process the newest messages that fit in the history once per frame. "
+                                    "Superseded messages are dropped before any other work.",
+                                    display, SLOT( updateLatestOnly() ), this );
+
+    max_update_rate_property_ =
+            new rviz::FloatProperty( "Max Update Rate", 0.0,
+                                     "Maximum rate [Hz] at which coalesced messages are processed. "
+                                     "0 processes them on every frame.",
+                                     latest_only_property_ );
+    max_update_rate_property_->setMin( 0.0 );
+
+    transform_timeout_property_ =
+            new rviz::FloatProperty( "Transform Timeout", 0.5,
+                                     "Seconds an element waits for its transform if tf does not have it yet. "
+                                     "0 drops such elements right away.",
+                                     display, SLOT( updateTransformTimeout() ), this );
+    transform_timeout_property_->setMin( 0.0 );
+
+    max_pending_property_ =
+            new rviz::IntProperty( "Max Pending Elements", 10000,
+                                   "Elements waiting for transforms beyond this number are dropped, oldest first.",
+                                   transform_timeout_property_, SLOT( updateTransformTimeout() ), this );
+    max_pending_property_->setMin( 0 );
+
+    max_pending_messages_property_ =
+            new rviz::IntProperty( "Max Pending Messages", 1000,
+                                   "Messages queued behind one that waits for transforms beyond this number "
+                                   "drop their waiting elements, oldest first.",
+                                   transform_timeout_property_, SLOT( updateTransformTimeout() ), this );
+    max_pending_messages_property_->setMin( 1 );
+
+    trace_property_ =
+            new rviz::BoolProperty( "Trace", false,
+                                    "Record a timeline of receipt, tf wait, validation, tf lookups, visual updates "
+                                    "and evictions, for chrome://tracing or Perfetto. Enabling starts a new trace.",
+                                    display, SLOT( updateTrace() ), this );
+
+    trace_file_property_ =
+            new rviz::StringProperty( "Trace File", "/tmp/wrench_trace.json",
+                                      "Chrome trace JSON file the timeline is written to.",
+                                      trace_property_ );
+
+    slow_frame_property_ =
+            new rviz::FloatProperty( "Slow Frame", 0.0,
+                                     "Write the trace when a frame takes longer than this [ms], "
+                                     "at most every 5 seconds. 0 disables it.",
+                                     trace_property_ );
+    slow_frame_property_->setMin( 0.0 );
+
+    write_trace_property_ =
+            new rviz::BoolProperty( "Write Now", false,
+                                    "Check to write the trace file now.",
+                                    trace_property_, SLOT( updateWriteTrace() ), this );
+
+    statistics_.initialize( display );
+}
+
+WrenchDisplayEngineBase::~WrenchDisplayEngineBase()
+{
+    if( trace_writer_.joinable() )
+    {
+      trace_writer_.join();
+    }
+}
+
+void WrenchDisplayEngineBase::initialize( rviz::DisplayContext* context, Ogre::SceneNode* scene_node )
+{
+    context_ = context;
+    scene_node_ = scene_node;
+    transform_source_.setFrameManager( context_->getFrameManager() );
+    batch_renderer_.reset( new WrenchBatchRenderer( context_->getSceneManager(), scene_node_ ));
+    visual_pool_.initialize( context_->getSceneManager(), scene_node_ );
+    updateHistoryLength( );
+    updateColorAndAlpha( );
+    updateRenderMode( );
+    updateLevelOfDetail( );
+    updateTransformTimeout( );
+    updateCulling( );
+    updateFilter( );
+    updateEnvelope( );
+    updateHistoryFile( );
+}
+
+void WrenchDisplayEngineBase::reset()
+{
+    clearMessages();
+    filter_.clear();
+    envelope_.clear();
+    pending_.clear();
+    clearVisuals();
+    trimVisualPool();
+}
+
+void WrenchDisplayEngineBase::clearVisuals()
+{
+    releaseVisuals( visuals_.size() );
+    releaseEnvelopeVisuals();
+    history_.clear();
+}
+
+void WrenchDisplayEngineBase::update( float wall_dt )
+{
+    if( trace_writer_.joinable() && !trace_writing_ )
+    {
+      trace_writer_.join();
+      showTraceWritten();
+    }
+    if( trace_.enabled() )
+    {
+      since_trace_write_ += wall_dt;
+      float slow_frame = slow_frame_property_->getFloat();
+      if( slow_frame > 0 && wall_dt * 1000 > slow_frame && since_trace_write_ >= 5.0f )
+      {
+        writeTrace();
+      }
+    }
+    if( latest_only_property_->getBool() )
+    {
+      flushMessages( wall_dt, max_update_rate_property_->getFloat() );
+    }
+    applyFiltered();
+    trimHistory();
+    if( !pending_.empty() )
+    {
+      TraceScope scope( &trace_, "pending transforms", pending_.waiting() );
+      pending_.process( transform_source_, tf_cache_, ros::WallTime::now(),
+                        boost::bind( &WrenchDisplayEngineBase::addPending, this, _1, _2, _3 ));
+    }
+    if( envelope_property_->getBool() && envelope_.version() != envelope_version_ )
+    {
+      updateEnvelopeVisuals();
+    }
+    if( lod_property_->getBool() )
+    {
+      TraceScope scope( &trace_, "level of detail", history_.records() );
+      evaluateLevelOfDetail();
+    }
+    if( batch_renderer_ && ( render_mode_property_->getOptionInt() == RENDER_BATCHED || lod_property_->getBool() ))
+    {
+      TraceScope scope( &trace_, "batch render", history_.records() );
+      batch_renderer_->update( history_, lod_property_->getBool() ? &lod_ : NULL );
+      display_->setStatus( rviz::StatusProperty::Ok, "Geometry",
+                           QString( "%1 triangles in %2 batches" )
+                           .arg( batch_renderer_->triangles() ).arg( batch_renderer_->batches() ));
+    }
+}
+
+// Cached transforms are relative to the old fixed frame.
+void WrenchDisplayEngineBase::fixedFrameChanged()
+{
+    tf_cache_.clear();
+}
+
+bool WrenchDisplayEngineBase::updateStatistics( float wall_dt, ros::NodeHandle& nh, size_t dropped )
+{
+    if( !statistics_.due( wall_dt ))
+    {
+      return false;
+    }
+    // Statuses that change with every message are refreshed here too.
+    if( latest_only_property_->getBool() )
+    {
+      display_->setStatus( rviz::StatusProperty::Ok, "Coalescing",
+                           QString( "%1 messages coalesced" ).arg( coalesced() ));
+    }
+    if( tf_cache_.hits() || tf_cache_.misses() )
+    {
+      display_->setStatus( rviz::StatusProperty::Ok, "TF Cache",
+                           QString( "%1 hits, %2 misses" ).arg( tf_cache_.hits() ).arg( tf_cache_.misses() ));
+    }
+    if( pending_.resolvedLate() || pending_.expired() || pending_.dropped() )
+    {
+      display_->setStatus( pending_.expired() || pending_.dropped() ? rviz::StatusProperty::Warn
+                                                                    : rviz::StatusProperty::Ok,
+                           "Pending Transforms",
+                           QString( "%1 waiting, %2 resolved late, %3 expired, %4 dropped over capacity" )
+                           .arg( pending_.waiting() ).arg( pending_.resolvedLate() ).arg( pending_.expired() )
+                           .arg( pending_.dropped() ));
+    }
+    size_t memory = history_.memoryUsage() + filter_.memoryUsage() + envelope_.memoryUsage() +
+                    envelope_visuals_.size() * WrenchVisualPool::VISUAL_BYTES;
+    if( render_mode_property_->getOptionInt() == RENDER_BATCHED )
+    {
+      if( batch_renderer_ )
+      {
+        memory += batch_renderer_->memoryUsage();
+      }
+    }
+    else
+    {
+      memory += ( visuals_.size() + visual_pool_.idle() ) * WrenchVisualPool::VISUAL_BYTES;
+    }
+    if( render_mode_property_->getOptionInt() == RENDER_PER_VISUAL )
+    {
+      display_->setStatus( rviz::StatusProperty::Ok, "Visual Pool",
+                           QString( "%1 allocated, %2 reused, %3 idle" )
+                           .arg( visual_pool_.allocations() )
+                           .arg( visual_pool_.reuses() )
+                           .arg( visual_pool_.idle() ));
+    }
+    else
+    {
+      display_->deleteStatus( "Visual Pool" );
+    }
+    if( history_file_.isOpen() )
+    {
+      display_->setStatus( rviz::StatusProperty::Ok, "History File",
+                           QString( "%1 messages on disk" )
+                           .arg( history_file_.endEntry() - history_file_.firstEntry() ));
+    }
+    if( history_duration_property_->getFloat() > 0 || history_memory_property_->getInt() > 0 )
+    {
+      display_->setStatus( rviz::StatusProperty::Ok, "History",
+                           QString( "%1 messages, %2 wrenches, about %3 kB" )
+                           .arg( history_.size() ).arg( history_.records() )
+                           .arg( history_.memoryEstimate() / 1024 ));
+    }
+    else
+    {
+      display_->deleteStatus( "History" );
+    }
+    statistics_.setDropped( coalesced() + dropped );
+    statistics_.setVisuals( visuals_.size() + envelope_visuals_.size() );
+    statistics_.setMemory( memory );
+    statistics_.publish( nh, display_->getName().toStdString() );
+    return true;
+}
+
+size_t WrenchDisplayEngineBase::historyLength() const
+{
+    return history_duration_property_->getFloat() > 0 ? 0 : history_length_property_->getInt();
+}
+
+bool WrenchDisplayEngineBase::latestOnly() const
+{
+    return latest_only_property_->getBool();
+}
+
+void WrenchDisplayEngineBase::noteReceipt( const void* msg )
+{
+    receipts_.push_back( std::make_pair( msg, ros::WallTime::now() ));
+}
+
+// Newest receipts first, as an address may be reused by a later message.
+void WrenchDisplayEngineBase::traceReceipt( const void* msg )
+{
+    trace_.instant( "receive" );
+    for( size_t i = receipts_.size(); i > 0; i-- )
+    {
+      if( receipts_[i - 1].first == msg )
+      {
+        trace_.complete( "tf filter wait", receipts_[i - 1].second, ros::WallTime::now() );
+        return;
+      }
+    }
+}
+
+void WrenchDisplayEngineBase::updateTrace()
+{
+    trace_.setEnabled( trace_property_->getBool() );
+    since_trace_write_ = 0;
+    if( !trace_property_->getBool() )
+    {
+      display_->deleteStatus( "Trace" );
+    }
+}
+
+void WrenchDisplayEngineBase::updateWriteTrace()
+{
+    if( write_trace_property_->getBool() )
+    {
+      writeTrace();
+      write_trace_property_->setBool( false );
+    }
+}
+
+void WrenchDisplayEngineBase::writeTrace()
+{
+    since_trace_write_ = 0;
+    if( trace_writing_ )
+    {
+      return;
+    }
+    if( trace_writer_.joinable() )
+    {
+      trace_writer_.join();
+      showTraceWritten();
+    }
+    // Copying the ring takes a fraction of formatting it.
+    trace_.copy( trace_copy_ );
+    trace_path_ = trace_file_property_->getStdString();
+    trace_writing_ = true;
+    trace_writer_ = boost::thread( &WrenchDisplayEngineBase::writeTraceCopy, this );
+}
+
+void WrenchDisplayEngineBase::writeTraceCopy()
+{
+    trace_written_ = EventTrace::write( trace_path_, trace_copy_ );
+    trace_writing_ = false;
+}
+
+void WrenchDisplayEngineBase::showTraceWritten()
+{
+    long written = trace_written_;
+    if( written < 0 )
+    {
+      display_->setStatus( rviz::StatusProperty::Error, "Trace",
+                           QString( "Could not write '%1'" ).arg( QString::fromStdString( trace_path_ ) ));
+      return;
+    }
+    display_->setStatus( rviz::StatusProperty::Ok, "Trace",
+                         QString( "%1 events written to '%2'" ).arg( written ).arg( QString::fromStdString( trace_path_ ) ));
+}
+
+void WrenchDisplayEngineBase::updateHistoryFile()
+{
+    if( !context_ )
+    {
+      return;
+    }
+    history_file_.close();
+    display_->deleteStatus( "History File" );
+    std::string path = history_file_property_->getStdString();
+    if( path.empty() )
+    {
+      return;
+    }
+    if( !history_file_.open( path, file_records_property_->getInt() ))
+    {
+      display_->setStatus( rviz::StatusProperty::Error, "History File",
+                           QString::fromStdString( history_file_.error() ));
+      return;
+    }
+    // Show the newest messages of a file written before, e.g. by an
+    // earlier run of rviz.
+    if( history_.size() == 0 )
+    {
+      uint64_t end = history_file_.endEntry();
+      uint64_t begin = history_file_.firstEntry();
+      double duration = history_duration_property_->getFloat();
+      ros::Time now = ros::Time::now();
+      if( history_.length() > 0 )
+      {
+        begin = end - std::min<uint64_t>( end - begin, history_.length() );
+      }
+      else if( duration > 0 && now.toSec() > duration )
+      {
+        // Only what trimHistory() would keep, not the whole file.
+        begin = history_file_.findEntry( now - ros::Duration( duration ));
+      }
+      history_file_.load( begin, end, history_ );
+      trimHistory();
+      if( render_mode_property_->getOptionInt() == RENDER_PER_VISUAL )
+      {
+        createVisuals();
+      }
+    }
+}
+
+void WrenchDisplayEngineBase::updateExportHistory()
+{
+    if( export_property_->getBool() )
+    {
+      exportHistory();
+      export_property_->setBool( false );
+    }
+}
+
+void WrenchDisplayEngineBase::exportHistory()
+{
+    if( !history_file_.isOpen() )
+    {
+      display_->setStatus( rviz::StatusProperty::Warn, "History Export", "No history file" );
+      return;
+    }
+    uint64_t begin = history_file_.firstEntry();
+    uint64_t end = history_file_.endEntry();
+    float seconds = export_seconds_property_->getFloat();
+    if( seconds > 0 && end > begin )
+    {
+      begin = history_file_.findEntry( history_file_.entryStamp( end - 1 ) - ros::Duration( seconds ));
+    }
+    std::string path = export_file_property_->getStdString();
+    TraceScope scope( &trace_, "export history", end - begin );
+    bool replace = export_replace_property_->getBool();
+    long written = export_format_property_->getOptionInt() == EXPORT_BINARY ?
+                   history_file_.exportBinary( path, begin, end, replace ) :
+                   history_file_.exportCsv( path, begin, end, replace );
+    scope.end();
+    if( written < 0 )
+    {
+      display_->setStatus( rviz::StatusProperty::Error, "History Export",
+                           QString::fromStdString( history_file_.error() ));
+      return;
+    }
+    display_->setStatus( rviz::StatusProperty::Ok, "History Export",
+                         QString( "%1 wrenches written to '%2'" ).arg( written ).arg( export_file_property_->getString() ));
+}
+
+// Messages still pending are processed right away when coalescing is turned off.
+void WrenchDisplayEngineBase::updateLatestOnly()
+{
+    if( !latest_only_property_->getBool() )
+    {
+      flushMessages( 0, 0 );
+      display_->deleteStatus( "Coalescing" );
+    }
+}
+
+void WrenchDisplayEngineBase::updateCulling()
+{
+    cull_filter_.setMinForce( min_force_property_->getFloat() );
+    cull_filter_.setMinTorque( min_torque_property_->getFloat() );
+    cull_filter_.setHideTorque( hide_torque_property_->getBool() );
+    cull_filter_.setInclude( include_property_->getStdString() );
+    cull_filter_.setExclude( exclude_property_->getStdString() );
+    Q_EMIT cullFilterChanged();
+}
+
+// The filter restarts from the next message.
+void WrenchDisplayEngineBase::updateFilter()
+{
+    filter_.setType( static_cast<WrenchFilter::Type>( filter_property_->getOptionInt() ));
+    filter_.setWindow( filter_window_property_->getInt() );
+    clearMessages();
+}
+
+void WrenchDisplayEngineBase::updateEnvelope()
+{
+    envelope_.setWindow( envelope_window_property_->getInt() );
+    releaseEnvelopeVisuals();
+}
+
+// The envelope is drawn with three visuals per element in either render
+// mode, updated at most once per frame.
+void WrenchDisplayEngineBase::updateEnvelopeVisuals()
+{
+    envelope_version_ = envelope_.version();
+    if( !envelope_property_->getBool() )
+    {
+      return;
+    }
+    TraceScope scope( &trace_, "envelope", envelope_.elements() );
+    float alpha = envelope_alpha_property_->getFloat();
+    float force_scale = force_scale_property_->getFloat();
+    float torque_scale = torque_scale_property_->getFloat();
+    float width = width_property_->getFloat();
+    Ogre::ColourValue force_color = force_color_property_->getOgreColor();
+    Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
+    while( envelope_visuals_.size() < 3 * envelope_.elements() )
+    {
+      envelope_visuals_.push_back( visual_pool_.acquire() );
+    }
+    WrenchGlyph glyphs[3];
+    for( size_t i = 0; i < envelope_.elements(); i++ )
+    {
+      if( !envelope_.shown( i ))
+      {
+        for( size_t k = 0; k < 3; k++ )
+        {
+          envelope_visuals_[3 * i + k]->setVisible( false );
+        }
+        continue;
+      }
+      envelope_.get( i, glyphs[0], glyphs[1], glyphs[2] );
+      for( size_t k = 0; k < 3; k++ )
+      {
+        rviz::WrenchVisual& visual = *envelope_visuals_[3 * i + k];
+        showGlyph( visual, glyphs[k] );
+        Ogre::ColourValue force = force_color;
+        Ogre::ColourValue torque = torque_color;
+        if( force_colormap_.active() )
+        {
+          force = force_colormap_.colourOf( glyphs[k].force.length() );
+          torque = torque_colormap_.colourOf( glyphs[k].torque.length() );
+        }
+        visual.setForceColor( force.r, force.g, force.b, alpha );
+        visual.setTorqueColor( torque.r, torque.g, torque.b, alpha );
+        visual.setForceScale( force_scale );
+        visual.setTorqueScale( torque_scale );
+        visual.setWidth( width );
+      }
+    }
+}
+
+void WrenchDisplayEngineBase::releaseEnvelopeVisuals()
+{
+    for( size_t i = 0; i < envelope_visuals_.size(); i++ )
+    {
+      visual_pool_.release( envelope_visuals_[i] );
+    }
+    envelope_visuals_.clear();
+}
+
+void WrenchDisplayEngineBase::updateTransformTimeout()
+{
+    pending_.setTimeout( transform_timeout_property_->getFloat() );
+    pending_.setCapacity( max_pending_property_->getInt(), max_pending_messages_property_->getInt() );
+}
+
+// Switching the render mode keeps the history and redraws it with the other path.
+void WrenchDisplayEngineBase::updateRenderMode()
+{
+    if( !batch_renderer_ )
+    {
+      return;
+    }
+    releaseVisuals( visuals_.size() );
+    if( render_mode_property_->getOptionInt() == RENDER_PER_VISUAL )
+    {
+      createVisuals();
+    }
+    trimVisualPool();
+    updateLevelOfDetail();
+}
+
+// In Per Visual render mode the batch renderer only draws the LINE tier,
+// visuals of the other tiers are hidden.
+void WrenchDisplayEngineBase::updateLevelOfDetail()
+{
+    lod_.setSizes( lod_full_size_property_->getFloat(), lod_min_size_property_->getFloat() );
+    lod_.setLineDistance( lod_line_distance_property_->getFloat() );
+    bool batched = render_mode_property_->getOptionInt() == RENDER_BATCHED;
+    if( batch_renderer_ )
+    {
+      batch_renderer_->setFullDetail( batched );
+      batch_renderer_->setVisible( batched || lod_property_->getBool() );
+    }
+    if( !lod_property_->getBool() )
+    {
+      for( size_t i = 0; i < visuals_.size(); i++ )
+      {
+        visuals_[i]->setVisible( true );
+      }
+      display_->deleteStatus( "Level of Detail" );
+    }
+    if( !batched )
+    {
+      display_->deleteStatus( "Geometry" );
+    }
+}
+
+void WrenchDisplayEngineBase::evaluateLevelOfDetail()
+{
+    rviz::ViewController* view_controller = context_->getViewManager()->getCurrent();
+    LodView view;
+    if( !view_controller || !LodView::fromCamera( view_controller->getCamera(), view ))
+    {
+      return;
+    }
+    if( lod_.update( history_, scene_node_->_getFullTransform(), view ) &&
+        render_mode_property_->getOptionInt() == RENDER_PER_VISUAL )
+    {
+      const std::vector<uint8_t>& tiers = lod_.tiers();
+      for( size_t i = 0; i < visuals_.size() && i < tiers.size(); i++ )
+      {
+        visuals_[i]->setVisible( tiers[i] == WrenchLevelOfDetail::FULL );
+      }
+    }
+    display_->setStatus( rviz::StatusProperty::Ok, "Level of Detail",
+                         QString( "%1 full, %2 lines, %3 culled" )
+                         .arg( lod_.count( WrenchLevelOfDetail::FULL ))
+                         .arg( lod_.count( WrenchLevelOfDetail::LINE ))
+                         .arg( lod_.count( WrenchLevelOfDetail::CULLED )));
+}
+
+void WrenchDisplayEngineBase::updateColorAndAlpha()
+{
+    TraceScope scope( &trace_, "update visuals", visuals_.size() );
+    float alpha = alpha_property_->getFloat();
+    float force_scale = force_scale_property_->getFloat();
+    float torque_scale = torque_scale_property_->getFloat();
+    float width = width_property_->getFloat();
+    Ogre::ColourValue force_color = force_color_property_->getOgreColor();
+    Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
+    WrenchColormap::Palette palette = static_cast<WrenchColormap::Palette>( colormap_property_->getOptionInt() );
+    force_colormap_.setPalette( palette );
+    force_colormap_.setRange( force_min_property_->getFloat(), force_max_property_->getFloat() );
+    torque_colormap_.setPalette( palette );
+    torque_colormap_.setRange( torque_min_property_->getFloat(), torque_max_property_->getFloat() );
+
+    if( batch_renderer_ )
+    {
+      batch_renderer_->setForceColor( force_color.r, force_color.g, force_color.b, alpha );
+      batch_renderer_->setTorqueColor( torque_color.r, torque_color.g, torque_color.b, alpha );
+      batch_renderer_->setForceColormap( force_colormap_ );
+      batch_renderer_->setTorqueColormap( torque_colormap_ );
+      batch_renderer_->setForceScale( force_scale );
+      batch_renderer_->setTorqueScale( torque_scale );
+      batch_renderer_->setWidth( width );
+    }
+    lod_.setScales( force_scale, torque_scale );
+
+    for( size_t i = 0; i < visuals_.size(); i++ )
+    {
+        colorVisual( *visuals_[i], i, force_color, torque_color, alpha );
+        visuals_[i]->setForceScale( force_scale );
+        visuals_[i]->setTorqueScale( torque_scale );
+        visuals_[i]->setWidth( width );
+    }
+    updateEnvelopeVisuals();
+}
+
+// Set the number of past visuals to show.
+void WrenchDisplayEngineBase::updateHistoryLength()
+{
+  size_t length = historyLength();
+  history_length_property_->setHidden( length == 0 );
+  setMessageCapacity( length > 0 ? length : TIMED_MESSAGE_CAPACITY );
+  visual_pool_.reserve( max_array_size_ * length );
+  // Shrinking drops the oldest messages right away.
+  releaseVisuals( history_.setLength( length ));
+  trimHistory();
+}
+
+// Drops the messages beyond "History Duration" and "History Memory Limit",
+// then the idle visuals they leave behind.
+void WrenchDisplayEngineBase::trimHistory()
+{
+  // Visuals and batched geometry cost memory per record, too.
+  size_t overhead = 0;
+  size_t limit = static_cast<size_t>( history_memory_property_->getInt() ) << 20;
+  // The envelope and the idle visuals trimVisualPool() keeps are no
+  // records, but share the limit.
+  size_t fixed = envelope_.memoryUsage();
+  if( render_mode_property_->getOptionInt() == RENDER_PER_VISUAL )
+    {
+      overhead += WrenchVisualPool::VISUAL_BYTES;
+      fixed += ( max_array_size_ + envelope_visuals_.size() ) * WrenchVisualPool::VISUAL_BYTES;
+    }
+  if( limit > 0 )
+    {
+      limit = limit > fixed ? limit - fixed : 1;
+    }
+  if( batch_renderer_ && history_.records() > 0 &&
+      ( render_mode_property_->getOptionInt() == RENDER_BATCHED || lod_property_->getBool() ))
+    {
+      overhead += batch_renderer_->memoryUsage() / history_.records();
+    }
+  size_t dropped = history_.setMemoryLimit( limit, overhead );
+
+  double duration = history_duration_property_->getFloat();
+  ros::Time now = ros::Time::now();
+  if( duration > 0 && now.toSec() > duration )
+    {
+      dropped += history_.expire( now - ros::Duration( duration ));
+    }
+  if( dropped )
+    {
+      trace_.instant( "expire", dropped );
+      releaseVisuals( dropped );
+    }
+  trimVisualPool();
+}
+
+void WrenchDisplayEngineBase::applyBatch( const WrenchRecordBatch& batch )
+{
+  if( batch.invalid )
+    {
+      display_->setStatus( rviz::StatusProperty::Error, "Topic",
+                           "Message contained invalid floating point values (nans or infs)" );
+    }
+  else if( batch.clamped )
+    {
+      display_->setStatus( rviz::StatusProperty::Warn, "Topic",
+                           "Message contained values beyond the float range, drawn clamped to it" );
+    }
+  statistics_.culled( batch.culled );
+  TraceScope scope( &trace_, "apply", batch.glyphs.size() );
+
+  // Keep the history in order: once a message waits, later ones wait behind
+  // it. addPending() samples the envelope once its elements are resolved.
+  if( pending_.timeout() > 0 && ( !batch.unresolved.empty() || !pending_.empty() ))
+    {
+      pending_.push( batch, ros::WallTime::now() );
+      return;
+    }
+  sampleEnvelope( batch.glyphs, batch.elements );
+  if( skip_empty_ && batch.glyphs.empty() && !batch.culled )
+    {
+      return;
+    }
+  addToHistory( batch.stamp, batch.glyphs );
+}
+
+void WrenchDisplayEngineBase::sampleEnvelope( const std::vector<WrenchGlyph>& glyphs,
+                                              const std::vector<uint32_t>& elements, bool complete )
+{
+  if( envelope_property_->getBool() )
+    {
+      envelope_.push( glyphs, elements, complete );
+    }
+}
+
+void WrenchDisplayEngineBase::applyElements( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs,
+                                             const std::vector<uint32_t>& changed )
+{
+  // With a history of one message, the changed elements are updated in
+  // place, visuals included, so the cost follows the number of changes.
+  if( history_.length() != 1 || history_.size() != 1 || history_.records() != glyphs.size() )
+    {
+      addToHistory( stamp, glyphs );
+      return;
+    }
+  TraceScope scope( &trace_, "update elements", changed.size() );
+  history_.replaceNewest( stamp, glyphs.empty() ? NULL : &glyphs[0],
+                          changed.empty() ? NULL : &changed[0], changed.size() );
+  if( history_file_.isOpen() )
+    {
+      history_file_.append( stamp, glyphs );
+    }
+  if( visuals_.size() == glyphs.size() )
+    {
+      float alpha = alpha_property_->getFloat();
+      Ogre::ColourValue force_color = force_color_property_->getOgreColor();
+      Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
+      for( size_t k = 0; k < changed.size(); k++ )
+        {
+          updateVisual( *visuals_[changed[k]], changed[k], force_color, torque_color, alpha );
+        }
+    }
+}
+
+void WrenchDisplayEngineBase::addPending( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs,
+                                          const std::vector<uint32_t>& elements )
+{
+  sampleEnvelope( glyphs, elements );
+  // An empty message here mostly expired. One that was culled while an
+  // earlier one waited is skipped as well, until the next message.
+  if( glyphs.empty() && skip_empty_ )
+    {
+      return;
+    }
+  addToHistory( stamp, glyphs );
+}
+
+void WrenchDisplayEngineBase::addToHistory( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs )
+{
+  size_t evicted = history_.push( stamp, glyphs );
+  if( evicted )
+    {
+      trace_.instant( "evict", evicted );
+    }
+  if( history_file_.isOpen() )
+    {
+      TraceScope scope( &trace_, "history file", glyphs.size() );
+      history_file_.append( stamp, glyphs );
+    }
+
+  // In batched mode the history is drawn as a whole in update().
+  if( render_mode_property_->getOptionInt() == RENDER_BATCHED )
+    {
+      return;
+    }
+
+  // Size the pool from the largest array seen so far, so that visuals
+  // released by shorter messages fit without reallocation.
+  if( glyphs.size() > max_array_size_ )
+    {
+      max_array_size_ = glyphs.size();
+      visual_pool_.reserve( max_array_size_ * historyLength() );
+    }
+
+  // Visuals of the evicted message go back to the pool and are reused for
+  // the new one, so a steady-state message creates no Ogre objects.
+  releaseVisuals( evicted );
+  createVisuals();
+}
+
+void WrenchDisplayEngineBase::releaseVisuals( size_t n )
+{
+  TraceScope scope( &trace_, "release visuals", std::min( n, visuals_.size() ));
+  for( size_t i = 0; i < n && !visuals_.empty(); i++ )
+    {
+      visual_pool_.release( visuals_.front() );
+      visuals_.pop_front();
+    }
+}
+
+// The pool keeps at most max_array_size_ visuals per message of History
+// Length, shown and idle together, and none in the Batched render mode.
+// Under a "History Memory Limit" it keeps one message worth, which
+// trimHistory() counts against the limit.
+void WrenchDisplayEngineBase::trimVisualPool()
+{
+  size_t keep = 0;
+  if( render_mode_property_->getOptionInt() == RENDER_PER_VISUAL )
+    {
+      size_t length = historyLength();
+      if( length > 0 )
+        {
+          size_t bound = max_array_size_ * length;
+          keep = bound > visuals_.size() ? bound - visuals_.size() : 0;
+        }
+      else
+        {
+          // A history kept by duration holds about as many visuals as now.
+          keep = std::max( visuals_.size(), max_array_size_ );
+        }
+      if( history_memory_property_->getInt() > 0 )
+        {
+          keep = std::min( keep, max_array_size_ );
+        }
+    }
+  visual_pool_.trim( keep );
+}
+
+void WrenchDisplayEngineBase::updateVisual( rviz::WrenchVisual& visual, size_t record,
+                                            const Ogre::ColourValue& force_color,
+                                            const Ogre::ColourValue& torque_color, float alpha ) const
+{
+  Ogre::Vector3 force = history_.force( record );
+  Ogre::Vector3 torque = history_.torque( record );
+  geometry_msgs::Wrench wrench;
+  wrench.force.x = force.x;
+  wrench.force.y = force.y;
+  wrench.force.z = force.z;
+  wrench.torque.x = torque.x;
+  wrench.torque.y = torque.y;
+  wrench.torque.z = torque.z;
+  visual.setWrench( wrench );
+  // Pooled visuals may have been hidden by the level of detail.
+  visual.setVisible( true );
+  visual.setFramePosition( history_.position( record ));
+  visual.setFrameOrientation( history_.orientation( record ));
+  colorVisual( visual, record, force_color, torque_color, alpha );
+}
+
+// The colormap is quantized, so records of similar magnitude get exactly
+// the same color.
+void WrenchDisplayEngineBase::colorVisual( rviz::WrenchVisual& visual, size_t record,
+                                           const Ogre::ColourValue& force_color,
+                                           const Ogre::ColourValue& torque_color, float alpha ) const
+{
+  Ogre::ColourValue force = force_color;
+  Ogre::ColourValue torque = torque_color;
+  if( force_colormap_.active() )
+    {
+      force = force_colormap_.colourOf( history_.force( record ).length() );
+      torque = torque_colormap_.colourOf( history_.torque( record ).length() );
+    }
+  visual.setForceColor( force.r, force.g, force.b, alpha );
+  visual.setTorqueColor( torque.r, torque.g, torque.b, alpha );
+}
+
+void WrenchDisplayEngineBase::createVisuals()
+{
+  if( visuals_.capacity() < history_.records() )
+    {
+      visuals_.set_capacity( std::max( 2 * visuals_.capacity(), history_.records() ));
+    }
+  float alpha = alpha_property_->getFloat();
+  float force_scale = force_scale_property_->getFloat();
+  float torque_scale = torque_scale_property_->getFloat();
+  float width = width_property_->getFloat();
+  Ogre::ColourValue force_color = force_color_property_->getOgreColor();
+  Ogre::ColourValue torque_color = torque_color_property_->getOgreColor();
+  TraceScope scope( &trace_, "create visuals", history_.records() - visuals_.size() );
+  for( size_t i = visuals_.size(); i < history_.records(); i++ )
+    {
+      boost::shared_ptr<rviz::WrenchVisual> visual = visual_pool_.acquire();
+      updateVisual( *visual, i, force_color, torque_color, alpha );
+      visual->setForceScale( force_scale );
+      visual->setTorqueScale( torque_scale );
+      visual->setWidth( width );
+      // And send it to the end of the circular buffer
+      visuals_.push_back( visual );
+    }
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,438 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_DISPLAY_ENGINE_H
+#define MY_RVIZ_PLUGIN_WRENCH_DISPLAY_ENGINE_H
+
+#ifndef Q_MOC_RUN
+#include <boost/circular_buffer.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+#include <atomic>
+
+#include <QObject>
+
+#include <ros/ros.h>
+
+#include "message_coalescer.h"
+#include "display_statistics.h"
+#include "wrench_history.h"
+#include "wrench_visual_pool.h"
+#include "transform_source.h"
+#include "transform_cache.h"
+#include "pending_transforms.h"
+#include "wrench_cull_filter.h"
+#include "wrench_elements.h"
+#include "wrench_lod.h"
+#include "event_trace.h"
+#include "wrench_filter.h"
+#include "wrench_history_file.h"
+#include "wrench_colormap.h"
+#include "wrench_element_envelope.h"
+
+namespace Ogre
+{
+class SceneNode;
+}
+
+namespace rviz
+{
+class Display;
+class DisplayContext;
+class ColorProperty;
+class FloatProperty;
+class IntProperty;
+class EnumProperty;
+class BoolProperty;
+class Property;
+class StringProperty;
+class WrenchVisual;
+}
+
+namespace my_rviz_plugin
+{
+
+class WrenchBatchRenderer;
+
+// Values of the "Render Mode" property shared by the wrench displays.
+enum WrenchRenderMode
+{
+  RENDER_BATCHED,
+  RENDER_PER_VISUAL
+};
+
+// Everything the wrench displays have in common that does not depend on
+// the message type: the properties for style, history, render mode, level
+// of detail, coalescing, transform timeout and culling, the history with
+// both render paths, pending transforms and statistics.
+//
+// Qt's moc cannot handle class templates, so this part is a plain QObject
+// that owns the slots, and WrenchDisplayEngine adds the message type on
+// top of it, as rviz::MessageFilterDisplay does for rviz::Display. The
+// display forwards onInitialize(), reset(), update() and
+// fixedFrameChanged() to it.
+class WrenchDisplayEngineBase: public QObject
+{
+    Q_OBJECT
+public:
+    // Creates the common properties as children of display.
+    WrenchDisplayEngineBase( rviz::Display* display );
+    virtual ~WrenchDisplayEngineBase();
+
+    void initialize( rviz::DisplayContext* context, Ogre::SceneNode* scene_node );
+    void reset();
+    void update( float wall_dt );
+    void fixedFrameChanged();
+
+    // Refreshes the "Statistics" properties and the per message statuses
+    // once a second. dropped counts messages the display dropped before
+    // they reached the engine. True if they were refreshed.
+    bool updateStatistics( float wall_dt, ros::NodeHandle& nh, size_t dropped );
+
+    // Adds a resolved message to the history, or queues it while some of
+    // its elements wait for their transforms. Main thread only.
+    void applyBatch( const WrenchRecordBatch& batch );
+
+    // Adds glyphs[k] as a sample of element elements[k] to the envelope
+    // while "Envelope" is on; see WrenchElementEnvelope::push() for
+    // complete. applyBatch() does this itself.
+    void sampleEnvelope( const std::vector<WrenchGlyph>& glyphs, const std::vector<uint32_t>& elements,
+                         bool complete = true );
+
+    // Shows the current elements of a delta-coded array, glyph i being
+    // element i. changed lists the elements that differ from the last
+    // call. With a History Length of 1 the changed elements are written
+    // into the shown message in place, and only their visuals or, in the
+    // Batched render mode without level of detail, their vertices are
+    // updated; an open history file still gets the whole message. With a
+    // longer history the glyphs are added like those of a full message.
+    // Main thread only.
+    void applyElements( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs,
+                        const std::vector<uint32_t>& changed );
+
+    // For displays that resolve messages from other sources themselves.
+    TransformSource& transformSource() { return transform_source_; }
+    TransformCache& transformCache() { return tf_cache_; }
+    const WrenchCullFilter& cullFilter() const { return cull_filter_; }
+    DisplayStatistics& statistics() { return statistics_; }
+    EventTrace& trace() { return trace_; }
+    // Number of messages the history keeps, 0 while "History Duration"
+    // keeps any number of them.
+    size_t historyLength() const;
+    // Messages of which no element can be drawn, because of nans or
+    // missing transforms, are not added to the history, so that the last
+    // drawn message stays up as rviz does for a single wrench. Culled
+    // messages still are. Off by default: arrays show what each message
+    // has.
+    void setSkipEmptyMessages( bool skip ) { skip_empty_ = skip; }
+
+Q_SIGNALS:
+    void cullFilterChanged();
+
+private Q_SLOTS:
+    // Helper function to apply color and alpha to all visuals.
+    void updateColorAndAlpha();
+    void updateHistoryLength();
+    void updateHistoryFile();
+    void updateExportHistory();
+    void updateRenderMode();
+    void updateLevelOfDetail();
+    void updateLatestOnly();
+    void updateTransformTimeout();
+    void updateCulling();
+    void updateFilter();
+    void updateEnvelope();
+    void updateEnvelopeVisuals();
+    void updateTrace();
+    void updateWriteTrace();
+
+protected:
+    bool latestOnly() const;
+
+    // Records that msg arrived at the subscriber, ahead of the tf
+    // MessageFilter, while the trace is on.
+    void noteReceipt( const void* msg );
+    // Records that msg reached the display, and the wall time it waited in
+    // the tf MessageFilter if noteReceipt() saw it.
+    void traceReceipt( const void* msg );
+
+    // Implemented by WrenchDisplayEngine for its MessageCoalescer.
+    virtual void flushMessages( float wall_dt, float max_rate ) = 0;
+    virtual void clearMessages() = 0;
+    virtual void setMessageCapacity( size_t capacity ) = 0;
+    virtual size_t coalesced() const = 0;
+    // Resolves and applies the newest filtered message, if any arrived
+    // since the last frame.
+    virtual void applyFiltered() = 0;
+
+    DisplayStatistics statistics_;
+
+    // Timeline of the work done for the display, recorded while "Trace" is on.
+    EventTrace trace_;
+
+    // Elements usually share a few frames and stamps.
+    FrameManagerTransformSource transform_source_;
+    TransformCache tf_cache_;
+    WrenchRecordBatch resolved_;
+
+    // Elements that are not drawn at all, applied before their transforms
+    // are looked up.
+    WrenchCullFilter cull_filter_;
+
+    // Smooths every message before it is resolved. While it is active only
+    // the newest message of a frame is resolved and shown.
+    WrenchFilter filter_;
+    WrenchSoA filter_input_;
+
+private:
+    // Drops the whole history of both render paths.
+    void clearVisuals();
+
+    // Picks the tiers of the history for the current camera, once per frame.
+    void evaluateLevelOfDetail();
+
+    // Copies the trace and writes it to the "Trace File" on a thread of its
+    // own, unless a write is still running; update() shows the result.
+    void writeTrace();
+    void writeTraceCopy();
+    void showTraceWritten();
+
+    // Writes the last "Export Seconds" of the history file to the "Export
+    // File" and shows the result.
+    void exportHistory();
+
+    void addToHistory( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs );
+    // addToHistory() for messages that waited for their transforms.
+    void addPending( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs,
+                     const std::vector<uint32_t>& elements );
+    void trimHistory();
+    // Hands the n oldest visuals back to the pool.
+    void releaseVisuals( size_t n );
+    // Destroys the idle visuals the history can no longer use.
+    void trimVisualPool();
+    // Hands the visuals of the envelope back to the pool.
+    void releaseEnvelopeVisuals();
+    // Creates visuals for the history records that have none yet.
+    void createVisuals();
+    // Shows history record record with visual, except for scale and width.
+    void updateVisual( rviz::WrenchVisual& visual, size_t record, const Ogre::ColourValue& force_color,
+                       const Ogre::ColourValue& torque_color, float alpha ) const;
+    // Applies the colors of history record record to visual.
+    void colorVisual( rviz::WrenchVisual& visual, size_t record, const Ogre::ColourValue& force_color,
+                      const Ogre::ColourValue& torque_color, float alpha ) const;
+
+    rviz::Display* display_;
+    rviz::DisplayContext* context_;
+    Ogre::SceneNode* scene_node_;
+
+    // The shown messages as plain records, whatever the render mode.
+    WrenchHistory history_;
+
+    // Every shown message, far beyond the history, while a "History File"
+    // is set.
+    WrenchHistoryFile history_file_;
+
+    // Storage for the list of visuals, one per history record in "Per Visual"
+    // render mode. It is a circular buffer where
+    // data gets popped from the front (oldest) and pushed to the back (newest)
+    //注意!! rviz::WrenchVisualはshared_prtの状態で扱うこと。解体する際に、rviz側でまだ利用中の場合に、突然プログラムが落ちる。
+    boost::circular_buffer<boost::shared_ptr<rviz::WrenchVisual> > visuals_;
+
+    // Minimum, maximum and mean visual of each element, while "Envelope" is on.
+    std::vector<boost::shared_ptr<rviz::WrenchVisual> > envelope_visuals_;
+
+    // Visuals dropped from visuals_ are kept here and reused by later messages.
+    WrenchVisualPool visual_pool_;
+    size_t max_array_size_;
+    bool skip_empty_;
+
+    // Messages whose elements wait for tf.
+    PendingTransforms pending_;
+
+    // Draws the whole history with a few draw calls in "Batched" render mode.
+    boost::scoped_ptr<WrenchBatchRenderer> batch_renderer_;
+
+    // Tiers of the history records for the current camera.
+    WrenchLevelOfDetail lod_;
+
+    // Range of each element over its last messages, and the version of it
+    // the envelope visuals show.
+    WrenchElementEnvelope envelope_;
+    unsigned long envelope_version_;
+
+    // Colors by magnitude, shared by both render paths.
+    WrenchColormap force_colormap_, torque_colormap_;
+
+    // Seconds since the trace was last written, to write it at most every
+    // few seconds on slow frames.
+    float since_trace_write_;
+    // Wall time at which the newest messages arrived at the subscriber.
+    boost::circular_buffer<std::pair<const void*, ros::WallTime> > receipts_;
+    // The trace writer thread and what it writes.
+    boost::thread trace_writer_;
+    std::vector<TraceEvent> trace_copy_;
+    std::string trace_path_;
+    std::atomic<bool> trace_writing_;
+    std::atomic<long> trace_written_;
+
+    // Property objects for user-editable properties.
+    rviz::ColorProperty *force_color_property_, *torque_color_property_;
+    rviz::FloatProperty *alpha_property_, *force_scale_property_, *torque_scale_property_, *width_property_;
+    rviz::EnumProperty *colormap_property_;
+    rviz::FloatProperty *force_min_property_, *force_max_property_, *torque_min_property_, *torque_max_property_;
+    rviz::IntProperty *history_length_property_;
+    rviz::FloatProperty *history_duration_property_;
+    rviz::IntProperty *history_memory_property_;
+    rviz::StringProperty *history_file_property_;
+    rviz::IntProperty *file_records_property_;
+    rviz::FloatProperty *export_seconds_property_;
+    rviz::EnumProperty *export_format_property_;
+    rviz::StringProperty *export_file_property_;
+    rviz::BoolProperty *export_replace_property_;
+    rviz::BoolProperty *export_property_;
+    rviz::EnumProperty *render_mode_property_;
+    rviz::BoolProperty *lod_property_;
+    rviz::FloatProperty *lod_full_size_property_, *lod_min_size_property_, *lod_line_distance_property_;
+    rviz::BoolProperty *latest_only_property_;
+    rviz::FloatProperty *max_update_rate_property_;
+    rviz::FloatProperty *transform_timeout_property_;
+    rviz::IntProperty *max_pending_property_;
+    rviz::IntProperty *max_pending_messages_property_;
+    rviz::Property *culling_property_;
+    rviz::FloatProperty *min_force_property_, *min_torque_property_;
+    rviz::BoolProperty *hide_torque_property_;
+    rviz::StringProperty *include_property_, *exclude_property_;
+    rviz::EnumProperty *filter_property_;
+    rviz::IntProperty *filter_window_property_;
+    rviz::BoolProperty *envelope_property_;
+    rviz::IntProperty *envelope_window_property_;
+    rviz::FloatProperty *envelope_alpha_property_;
+    rviz::BoolProperty *trace_property_;
+    rviz::StringProperty *trace_file_property_;
+    rviz::FloatProperty *slow_frame_property_;
+    rviz::BoolProperty *write_trace_property_;
+};
+
+// Display engine for one message type. Elements is one of the element
+// access policies of wrench_elements.h; resolving a message is
+// instantiated for it, so each message type gets its own extraction loop
+// and a new display only needs a policy and the rviz glue.
+template<class Elements>
+class WrenchDisplayEngine: public WrenchDisplayEngineBase
+{
+public:
+  typedef typename Elements::Message Message;
+  typedef typename Message::ConstPtr MessageConstPtr;
+  typedef boost::function<void( const MessageConstPtr& )> Handler;
+
+  explicit WrenchDisplayEngine( rviz::Display* display )
+    : WrenchDisplayEngineBase( display )
+    , handler_( boost::bind( &WrenchDisplayEngine::handleMessage, this, _1 ))
+  {
+  }
+
+  // Replaces handleMessage() for the messages that are not coalesced away,
+  // e.g. to resolve them on another thread.
+  void setHandler( const Handler& handler ) { handler_ = handler; }
+
+  // Register with the message_filters::Subscriber of the display, so that
+  // the trace shows how long messages wait in its tf MessageFilter.
+  void receiveMessage( const MessageConstPtr& msg )
+  {
+    if( trace_.enabled() )
+    {
+      noteReceipt( msg.get() );
+    }
+  }
+
+  // Call from the processMessage() of the display.
+  void processMessage( const MessageConstPtr& msg )
+  {
+    statistics_.received();
+    if( trace_.enabled() )
+    {
+      traceReceipt( msg.get() );
+    }
+    if( filter_.active() )
+    {
+      filterMessage( msg );
+      return;
+    }
+    if( latestOnly() )
+    {
+      coalescer_.push( msg );
+      return;
+    }
+    handler_( msg );
+  }
+
+  // Validates msg, resolves its transforms and adds it to the history.
+  void handleMessage( const MessageConstPtr& msg )
+  {
+    ScopedProcessTimer timer( statistics_ );
+    TraceScope scope( &trace_, "resolve" );
+    tf_cache_.beginMessage();
+    resolveElements( Elements( *msg ), cull_filter_, transform_source_, tf_cache_, resolved_, &trace_ );
+    scope.end();
+    applyBatch( resolved_ );
+  }
+
+protected:
+  virtual void flushMessages( float wall_dt, float max_rate )
+  {
+    coalescer_.flush( wall_dt, max_rate, handler_ );
+  }
+
+  virtual void clearMessages()
+  {
+    coalescer_.clear();
+    filtered_.reset();
+  }
+
+  virtual void setMessageCapacity( size_t capacity ) { coalescer_.setCapacity( capacity ); }
+  virtual size_t coalesced() const { return coalescer_.coalesced(); }
+
+  virtual void applyFiltered()
+  {
+    if( !filtered_ )
+    {
+      return;
+    }
+    ScopedProcessTimer timer( statistics_ );
+    TraceScope scope( &trace_, "resolve" );
+    tf_cache_.beginMessage();
+    resolveElements( FilteredElements<Elements>( *filtered_, filter_.output() ), cull_filter_,
+                     transform_source_, tf_cache_, resolved_, &trace_ );
+    scope.end();
+    filtered_.reset();
+    applyBatch( resolved_ );
+  }
+
+private:
+  // Adds the elements of msg to the filter; the message is kept until
+  // the next frame for its frames and stamps.
+  void filterMessage( const MessageConstPtr& msg )
+  {
+    Elements elements( *msg );
+    if( !elements.consistent() )
+    {
+      ROS_ERROR_THROTTLE(1.0, "Wrench message arrays have inconsistent sizes. Skipping the message");
+      return;
+    }
+    TraceScope scope( &trace_, "filter", elements.size() );
+    filter_.push( elements.load( filter_input_ ));
+    filtered_ = msg;
+  }
+
+  // Messages waiting for the next frame in "Latest Only" mode.
+  MessageCoalescer<Message> coalescer_;
+  Handler handler_;
+  // Newest message added to the filter since the last frame.
+  MessageConstPtr filtered_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_DISPLAY_ENGINE_H
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+
+#include "wrench_element_envelope.h"
+
+namespace my_rviz_plugin
+{
+
+const size_t WrenchElementEnvelope::MAX_WINDOW;
+const size_t WrenchElementEnvelope::MAX_SAMPLES;
+
+WrenchElementEnvelope::WrenchElementEnvelope()
+  : window_( 100 )
+  , messages_( 0 )
+  , version_( 0 )
+{
+}
+
+void WrenchElementEnvelope::setWindow( size_t samples )
+{
+  window_ = std::max<size_t>( 1, std::min( samples, MAX_WINDOW ));
+  clear();
+}
+
+void WrenchElementEnvelope::clear()
+{
+  states_.clear();
+  samples_.clear();
+  queues_.clear();
+  messages_ = 0;
+  version_++;
+}
+
+void WrenchElementEnvelope::push( const std::vector<WrenchGlyph>& glyphs, const std::vector<uint32_t>& elements,
+                                  bool complete )
+{
+  if( complete )
+  {
+    // Elements this message leaves out may stop being shown.
+    messages_++;
+    version_++;
+  }
+  for( size_t k = 0; k < glyphs.size() && k < elements.size(); k++ )
+  {
+    push( elements[k], glyphs[k] );
+  }
+}
+
+void WrenchElementEnvelope::push( size_t element, const WrenchGlyph& glyph )
+{
+  float force_length = glyph.force.length();
+  float torque_length = glyph.torque.length();
+  if( !std::isfinite( force_length ) || !std::isfinite( torque_length ) || element >= MAX_SAMPLES / window_ )
+  {
+    return;
+  }
+  if( element >= states_.size() )
+  {
+    // Elements keep their place, so a longer array only appends.
+    State state = State();
+    states_.resize( element + 1, state );
+    samples_.resize( states_.size() * window_ * SAMPLE_SIZE );
+    queues_.resize( states_.size() * QUEUES * window_ );
+  }
+
+  State& state = states_[element];
+  uint64_t n = state.count;
+  uint32_t offset = n % window_;
+  float* slot = sample( element, offset );
+  if( n >= window_ )
+  {
+    // Sample n - window_, the only one in this slot, leaves the window;
+    // only the front of a queue can hold it.
+    for( int c = 0; c < 6; c++ )
+    {
+      state.sums[c] -= slot[c];
+    }
+    for( int q = 0; q < QUEUES; q++ )
+    {
+      if( state.size[q] > 0 && queue( element, q )[state.head[q]] == offset )
+      {
+        state.head[q] = ( state.head[q] + 1 ) % window_;
+        state.size[q]--;
+      }
+    }
+  }
+
+  slot[FX] = glyph.force.x;
+  slot[FY] = glyph.force.y;
+  slot[FZ] = glyph.force.z;
+  slot[TX] = glyph.torque.x;
+  slot[TY] = glyph.torque.y;
+  slot[TZ] = glyph.torque.z;
+  slot[FORCE_LENGTH] = force_length;
+  slot[TORQUE_LENGTH] = torque_length;
+  for( int c = 0; c < 6; c++ )
+  {
+    state.sums[c] += slot[c];
+  }
+
+  for( int q = 0; q < QUEUES; q++ )
+  {
+    int component = q == MIN_FORCE || q == MAX_FORCE ? FORCE_LENGTH : TORQUE_LENGTH;
+    bool maximum = q == MAX_FORCE || q == MAX_TORQUE;
+    float length = slot[component];
+    uint32_t* ring = queue( element, q );
+    // Samples that cannot become the extreme while this one is in the
+    // window are dropped from the back.
+    while( state.size[q] > 0 )
+    {
+      float back = sample( element, ring[( state.head[q] + state.size[q] - 1 ) % window_] )[component];
+      if( maximum ? back > length : back < length )
+      {
+        break;
+      }
+      state.size[q]--;
+    }
+    ring[( state.head[q] + state.size[q] ) % window_] = offset;
+    state.size[q]++;
+  }
+
+  state.count = n + 1;
+  state.last = messages_;
+  state.position = glyph.position;
+  state.orientation = glyph.orientation;
+  version_++;
+}
+
+const float* WrenchElementEnvelope::front( size_t element, int q ) const
+{
+  const State& state = states_[element];
+  return sample( element, queues_[( element * QUEUES + q ) * window_ + state.head[q]] );
+}
+
+void WrenchElementEnvelope::get( size_t element, WrenchGlyph& min, WrenchGlyph& max, WrenchGlyph& mean ) const
+{
+  const State& state = states_[element];
+  const float* min_force = front( element, MIN_FORCE );
+  const float* max_force = front( element, MAX_FORCE );
+  const float* min_torque = front( element, MIN_TORQUE );
+  const float* max_torque = front( element, MAX_TORQUE );
+  min.force = Ogre::Vector3( min_force[FX], min_force[FY], min_force[FZ] );
+  min.torque = Ogre::Vector3( min_torque[TX], min_torque[TY], min_torque[TZ] );
+  max.force = Ogre::Vector3( max_force[FX], max_force[FY], max_force[FZ] );
+  max.torque = Ogre::Vector3( max_torque[TX], max_torque[TY], max_torque[TZ] );
+
+  double count = std::min<uint64_t>( state.count, window_ );
+  mean.force = Ogre::Vector3( state.sums[FX] / count, state.sums[FY] / count, state.sums[FZ] / count );
+  mean.torque = Ogre::Vector3( state.sums[TX] / count, state.sums[TY] / count, state.sums[TZ] / count );
+
+  min.position = max.position = mean.position = state.position;
+  min.orientation = max.orientation = mean.orientation = state.orientation;
+}
+
+size_t WrenchElementEnvelope::memoryUsage() const
+{
+  return states_.capacity() * sizeof( State ) + samples_.capacity() * sizeof( float ) +
+         queues_.capacity() * sizeof( uint32_t );
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,128 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_ELEMENT_ENVELOPE_H
+#define MY_RVIZ_PLUGIN_WRENCH_ELEMENT_ENVELOPE_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include "wrench_history.h"
+
+namespace my_rviz_plugin
+{
+
+// Minimum, maximum and mean force and torque of every element over its
+// last window samples, so that the range of a sensor can be shown with a
+// few arrows instead of a long history of overlapping ones.
+//
+// Minimum and maximum are by length. Each is kept in a monotonic queue of
+// the samples that can still become the extreme before they leave the
+// window, and the mean in running sums, so a sample costs O(1) amortized.
+// The minimum glyph has the force of the sample with the shortest force
+// and the torque of the sample with the shortest torque; likewise for the
+// maximum.
+//
+// Storage is window slots per element, so elements beyond
+// MAX_SAMPLES / window are left out.
+class WrenchElementEnvelope
+{
+public:
+  static const size_t MAX_WINDOW = 10000;
+  // Most sample slots over all elements, 48 bytes each.
+  static const size_t MAX_SAMPLES = 1 << 20;
+
+  WrenchElementEnvelope();
+
+  // Changing the window restarts the envelope.
+  void setWindow( size_t samples );
+  size_t window() const { return window_; }
+
+  // Adds glyphs[k] as the newest sample of element elements[k]. A
+  // complete message lists every element that still arrives; elements
+  // missing from window() complete messages in a row are no longer
+  // shown(). Messages that only carry changed elements, like deltas, are
+  // not complete and keep the others current.
+  void push( const std::vector<WrenchGlyph>& glyphs, const std::vector<uint32_t>& elements,
+             bool complete = true );
+
+  // Elements are numbered up to the highest one seen so far.
+  size_t elements() const { return states_.size(); }
+  // Whether element has an envelope to show: it has been sampled, and
+  // recently enough.
+  bool shown( size_t element ) const
+  {
+    const State& state = states_[element];
+    return state.count > 0 && messages_ - state.last < window_;
+  }
+
+  // Envelope of a sampled element, placed at the pose of its newest sample.
+  void get( size_t element, WrenchGlyph& min, WrenchGlyph& max, WrenchGlyph& mean ) const;
+
+  // Incremented by every change, so that visuals are only updated when needed.
+  unsigned long version() const { return version_; }
+
+  void clear();
+
+  size_t memoryUsage() const;
+
+private:
+  enum Queue
+  {
+    MIN_FORCE,
+    MAX_FORCE,
+    MIN_TORQUE,
+    MAX_TORQUE,
+    QUEUES
+  };
+
+  // Layout of a sample slot.
+  enum Component
+  {
+    FX, FY, FZ,
+    TX, TY, TZ,
+    FORCE_LENGTH,
+    TORQUE_LENGTH,
+    SAMPLE_SIZE
+  };
+
+  struct State
+  {
+    // Number of samples added, which also numbers them.
+    uint64_t count;
+    // Complete message of the newest sample.
+    uint64_t last;
+    double sums[6];
+    // Each queue is a ring of window_ slot offsets, oldest sample first.
+    size_t head[QUEUES];
+    size_t size[QUEUES];
+    Ogre::Vector3 position;
+    Ogre::Quaternion orientation;
+  };
+
+  // Samples with nans or infs are left out.
+  void push( size_t element, const WrenchGlyph& glyph );
+
+  float* sample( size_t element, uint32_t offset )
+  {
+    return &samples_[( element * window_ + offset ) * SAMPLE_SIZE];
+  }
+  const float* sample( size_t element, uint32_t offset ) const
+  {
+    return &samples_[( element * window_ + offset ) * SAMPLE_SIZE];
+  }
+  uint32_t* queue( size_t element, int q ) { return &queues_[( element * QUEUES + q ) * window_]; }
+  // Sample at the front of queue q of element, the extreme of its window.
+  const float* front( size_t element, int q ) const;
+
+  size_t window_;
+  std::vector<State> states_;
+  // Sample n of element i is in slot n % window_ of the element.
+  std::vector<float> samples_;
+  std::vector<uint32_t> queues_;
+  // Complete messages pushed.
+  uint64_t messages_;
+  unsigned long version_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_ELEMENT_ENVELOPE_H
@@ -0,0 +1,446 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_ELEMENTS_H
+#define MY_RVIZ_PLUGIN_WRENCH_ELEMENTS_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+
+#include <ros/ros.h>
+#include <geometry_msgs/WrenchStamped.h>
+#include <my_rviz_plugin/WrenchStampedArray.h>
+#include <my_rviz_plugin/WrenchStampedArrayCompact.h>
+#include <my_rviz_plugin/WrenchStampedArrayDelta.h>
+
+#include "wrench_history.h"
+#include "wrench_kernel.h"
+#include "wrench_cull_filter.h"
+#include "transform_source.h"
+#include "transform_cache.h"
+#include "wrench_shm_reader.h"
+#include "event_trace.h"
+
+namespace my_rviz_plugin
+{
+
+// An element whose transform was not available when it was resolved.
+struct UnresolvedWrench
+{
+  // Index in the whole array.
+  uint32_t element;
+  std::string frame;
+  ros::Time stamp;
+  Ogre::Vector3 force;
+  Ogre::Vector3 torque;
+};
+
+// Plain-data result of validating a message and resolving its transforms.
+// Applying it to Ogre is left to the main thread.
+struct WrenchRecordBatch
+{
+  ros::Time stamp;
+  std::vector<WrenchGlyph> glyphs;
+  // Elements with nans or infs.
+  size_t invalid;
+  // Components beyond the float range, drawn clamped to it.
+  size_t clamped;
+  // Elements whose transform could not be resolved. Those that failed
+  // because tf had no transform (yet) are also listed in unresolved.
+  size_t untransformed;
+  std::vector<UnresolvedWrench> unresolved;
+  // Elements dropped by the WrenchCullFilter before their transform was
+  // looked up.
+  size_t culled;
+  // Index in the whole array of the element of each glyph.
+  std::vector<uint32_t> elements;
+
+  // Scratch space of resolveElements(), kept with the batch so that it is
+  // reused.
+  WrenchSoA wrenches;
+  std::vector<uint8_t> valid;
+
+  void clear()
+  {
+    glyphs.clear();
+    elements.clear();
+    unresolved.clear();
+    invalid = 0;
+    clamped = 0;
+    untransformed = 0;
+    culled = 0;
+  }
+};
+
+// Element access policies. Each one wraps a message of one type and tells
+// resolveElements() how to read its elements:
+//
+//   bool consistent() const          false if the message is malformed
+//   size_t size() const              number of elements
+//   size_t index( size_t i ) const   index of element i in the whole array,
+//                                    which culling by index refers to
+//   const ros::Time& stamp() const   stamp of the message
+//   const WrenchSoA& load( WrenchSoA& scratch ) const
+//                                    components of all elements, in scratch
+//                                    unless the message already has them
+//   size_t clamped() const           components load() clamped to the
+//                                    float range
+//   bool hasFrame( size_t i ) const  false if element i names no frame
+//   const std::string& frame( size_t i ) const
+//   const ros::Time& stamp( size_t i ) const
+//
+// All of them are inline, so every message type gets its own loop without
+// any indirection per element. Policies used with WrenchDisplayEngine also
+// typedef the Message they wrap.
+
+namespace detail
+{
+// Finite doubles beyond the float range are clamped to it rather than
+// turned into infs, which validation would reject as invalid.
+inline float toFloat( double value, size_t& clamped )
+{
+  if( std::fabs( value ) > FLT_MAX && std::isfinite( value ))
+  {
+    clamped++;
+    return value > 0 ? FLT_MAX : -FLT_MAX;
+  }
+  return value;
+}
+
+inline void loadWrench( const geometry_msgs::Wrench& wrench, WrenchSoA& out, size_t i, size_t& clamped )
+{
+  out.fx[i] = toFloat( wrench.force.x, clamped );
+  out.fy[i] = toFloat( wrench.force.y, clamped );
+  out.fz[i] = toFloat( wrench.force.z, clamped );
+  out.tx[i] = toFloat( wrench.torque.x, clamped );
+  out.ty[i] = toFloat( wrench.torque.y, clamped );
+  out.tz[i] = toFloat( wrench.torque.z, clamped );
+}
+}
+
+class WrenchStampedElements
+{
+public:
+  typedef geometry_msgs::WrenchStamped Message;
+
+  explicit WrenchStampedElements( const Message& msg ) : msg_( msg ), clamped_( 0 ) {}
+
+  bool consistent() const { return true; }
+  size_t size() const { return 1; }
+  size_t index( size_t i ) const { return i; }
+  const ros::Time& stamp() const { return msg_.header.stamp; }
+
+  const WrenchSoA& load( WrenchSoA& scratch ) const
+  {
+    scratch.resize( 1 );
+    detail::loadWrench( msg_.wrench, scratch, 0, clamped_ );
+    return scratch;
+  }
+  size_t clamped() const { return clamped_; }
+
+  bool hasFrame( size_t ) const { return true; }
+  const std::string& frame( size_t ) const { return msg_.header.frame_id; }
+  const ros::Time& stamp( size_t ) const { return msg_.header.stamp; }
+
+private:
+  const Message& msg_;
+  mutable size_t clamped_;
+};
+
+class WrenchStampedArrayElements
+{
+public:
+  typedef my_rviz_plugin::WrenchStampedArray Message;
+
+  explicit WrenchStampedArrayElements( const Message& msg ) : msg_( msg ), clamped_( 0 ) {}
+
+  bool consistent() const { return true; }
+  size_t size() const { return msg_.wrenchstampeds.size(); }
+  size_t index( size_t i ) const { return i; }
+  const ros::Time& stamp() const { return msg_.header.stamp; }
+
+  const WrenchSoA& load( WrenchSoA& scratch ) const
+  {
+    size_t size = msg_.wrenchstampeds.size();
+    scratch.resize( size );
+    for( size_t i = 0; i < size; i++ )
+    {
+      const geometry_msgs::Wrench& wrench = msg_.wrenchstampeds[i].wrench;
+      detail::loadWrench( wrench, scratch, i, clamped_ );
+    }
+    return scratch;
+  }
+  size_t clamped() const { return clamped_; }
+
+  bool hasFrame( size_t ) const { return true; }
+  const std::string& frame( size_t i ) const { return msg_.wrenchstampeds[i].header.frame_id; }
+  const ros::Time& stamp( size_t i ) const { return msg_.wrenchstampeds[i].header.stamp; }
+
+private:
+  const Message& msg_;
+  mutable size_t clamped_;
+};
+
+class WrenchStampedArrayCompactElements
+{
+public:
+  typedef my_rviz_plugin::WrenchStampedArrayCompact Message;
+
+  explicit WrenchStampedArrayCompactElements( const Message& msg ) : msg_( msg ) {}
+
+  bool consistent() const
+  {
+    size_t size = msg_.frame_indices.size();
+    return msg_.forces.size() == 3 * size && msg_.torques.size() == 3 * size &&
+           ( msg_.stamps.empty() || msg_.stamps.size() == size );
+  }
+  size_t size() const { return msg_.frame_indices.size(); }
+  size_t index( size_t i ) const { return i; }
+  const ros::Time& stamp() const { return msg_.header.stamp; }
+
+  const WrenchSoA& load( WrenchSoA& scratch ) const
+  {
+    size_t size = msg_.frame_indices.size();
+    scratch.resize( size );
+    for( size_t i = 0; i < size; i++ )
+    {
+      scratch.fx[i] = msg_.forces[3 * i];
+      scratch.fy[i] = msg_.forces[3 * i + 1];
+      scratch.fz[i] = msg_.forces[3 * i + 2];
+      scratch.tx[i] = msg_.torques[3 * i];
+      scratch.ty[i] = msg_.torques[3 * i + 1];
+      scratch.tz[i] = msg_.torques[3 * i + 2];
+    }
+    return scratch;
+  }
+  size_t clamped() const { return 0; }
+
+  bool hasFrame( size_t i ) const { return msg_.frame_indices[i] < msg_.frame_ids.size(); }
+  const std::string& frame( size_t i ) const { return msg_.frame_ids[msg_.frame_indices[i]]; }
+  const ros::Time& stamp( size_t i ) const { return msg_.stamps.empty() ? msg_.header.stamp : msg_.stamps[i]; }
+
+private:
+  const Message& msg_;
+};
+
+// A message read from a WrenchShmReader together with the frame ids of
+// the segment. Its components, already copied out of the segment by the
+// reader, are used in place.
+class WrenchShmElements
+{
+public:
+  WrenchShmElements( const WrenchShmMessage& msg, const std::vector<std::string>& frame_ids )
+    : msg_( msg )
+    , frame_ids_( frame_ids )
+  {
+  }
+
+  bool consistent() const { return msg_.wrenches.size() == msg_.frame_indices.size(); }
+  size_t size() const { return msg_.frame_indices.size(); }
+  size_t index( size_t i ) const { return i; }
+  const ros::Time& stamp() const { return msg_.stamp; }
+  const WrenchSoA& load( WrenchSoA& ) const { return msg_.wrenches; }
+  size_t clamped() const { return 0; }
+  bool hasFrame( size_t i ) const { return msg_.frame_indices[i] < frame_ids_.size(); }
+  const std::string& frame( size_t i ) const { return frame_ids_[msg_.frame_indices[i]]; }
+  const ros::Time& stamp( size_t ) const { return msg_.stamp; }
+
+private:
+  const WrenchShmMessage& msg_;
+  const std::vector<std::string>& frame_ids_;
+};
+
+// Structure of a WrenchStampedArrayDelta: a keyframe carries every
+// element, a delta indices.size() changed ones. The elements themselves are
+// applied by WrenchDeltaState and resolved with
+// WrenchStampedArraySubsetElements.
+class WrenchStampedArrayDeltaElements
+{
+public:
+  typedef my_rviz_plugin::WrenchStampedArrayDelta Message;
+
+  explicit WrenchStampedArrayDeltaElements( const Message& msg ) : msg_( msg ) {}
+
+  bool consistent() const
+  {
+    return msg_.keyframe ? msg_.indices.empty() && msg_.wrenchstampeds.size() == msg_.size
+                         : msg_.indices.size() == msg_.wrenchstampeds.size();
+  }
+
+private:
+  const Message& msg_;
+};
+
+// Elements indices[0 ..] of a WrenchStampedArray, all looked up at stamp
+// except those stamped 0, which use the latest transform.
+class WrenchStampedArraySubsetElements
+{
+public:
+  typedef my_rviz_plugin::WrenchStampedArray Message;
+
+  WrenchStampedArraySubsetElements( const Message& msg, const std::vector<uint32_t>& indices,
+                                    const ros::Time& stamp )
+    : msg_( msg )
+    , indices_( indices )
+    , stamp_( stamp )
+    , clamped_( 0 )
+  {
+  }
+
+  bool consistent() const { return true; }
+  size_t size() const { return indices_.size(); }
+  size_t index( size_t i ) const { return indices_[i]; }
+  const ros::Time& stamp() const { return stamp_; }
+
+  const WrenchSoA& load( WrenchSoA& scratch ) const
+  {
+    size_t size = indices_.size();
+    scratch.resize( size );
+    for( size_t i = 0; i < size; i++ )
+    {
+      const geometry_msgs::Wrench& wrench = msg_.wrenchstampeds[indices_[i]].wrench;
+      detail::loadWrench( wrench, scratch, i, clamped_ );
+    }
+    return scratch;
+  }
+  size_t clamped() const { return clamped_; }
+
+  bool hasFrame( size_t ) const { return true; }
+  const std::string& frame( size_t i ) const { return msg_.wrenchstampeds[indices_[i]].header.frame_id; }
+  const ros::Time& stamp( size_t i ) const
+  {
+    const ros::Time& stamp = msg_.wrenchstampeds[indices_[i]].header.stamp;
+    return stamp.isZero() ? stamp : stamp_;
+  }
+
+private:
+  const Message& msg_;
+  const std::vector<uint32_t>& indices_;
+  const ros::Time& stamp_;
+  mutable size_t clamped_;
+};
+
+// Elements of a message with their components replaced by filtered
+// values, e.g. the output of a WrenchFilter. Frames and stamps still come
+// from the message.
+template<class Elements>
+class FilteredElements: public Elements
+{
+public:
+  FilteredElements( const typename Elements::Message& msg, const WrenchSoA& filtered )
+    : Elements( msg )
+    , filtered_( filtered )
+  {
+  }
+
+  bool consistent() const { return Elements::consistent() && filtered_.size() == Elements::size(); }
+  const WrenchSoA& load( WrenchSoA& ) const { return filtered_; }
+  size_t clamped() const { return 0; }
+
+private:
+  const WrenchSoA& filtered_;
+};
+
+namespace detail
+{
+// Parts that are not drawn are zero, which hides them in both render paths.
+inline void setParts( const WrenchSoA& wrenches, size_t i, unsigned parts,
+                      Ogre::Vector3& force, Ogre::Vector3& torque )
+{
+  force = ( parts & WrenchCullFilter::FORCE ) ?
+          Ogre::Vector3( wrenches.fx[i], wrenches.fy[i], wrenches.fz[i] ) : Ogre::Vector3::ZERO;
+  torque = ( parts & WrenchCullFilter::TORQUE ) ?
+           Ogre::Vector3( wrenches.tx[i], wrenches.ty[i], wrenches.tz[i] ) : Ogre::Vector3::ZERO;
+}
+}
+
+// Validates the elements and resolves their transforms into batch.
+// Safe to call from any thread as long as the cache is not shared.
+// Nothing here touches Ogre or a display, so it can also be driven
+// headless with a stand-in TransformSource. Validation and every tf
+// lookup that misses the cache are recorded to trace, if given.
+template<class Elements>
+void resolveElements( const Elements& elements, const WrenchCullFilter& cull,
+                      TransformSource& source, TransformCache& cache,
+                      WrenchRecordBatch& batch, EventTrace* trace = NULL )
+{
+  batch.clear();
+  batch.stamp = elements.stamp();
+  size_t size = elements.size();
+  if( !elements.consistent() )
+  {
+    ROS_ERROR_THROTTLE(1.0, "Wrench message arrays have inconsistent sizes. Skipping the message");
+    batch.invalid = std::max<size_t>( size, 1 );
+    return;
+  }
+  batch.glyphs.reserve( size );
+
+  // Validate the whole message at once.
+  TraceScope validation( trace, "validate", size );
+  const WrenchSoA& wrenches = elements.load( batch.wrenches );
+  batch.invalid = size - validateWrenches( wrenches, batch.valid );
+  batch.clamped = elements.clamped();
+  validation.end();
+
+  for( size_t i = 0; i < size; i++ )
+  {
+    if( !batch.valid[i] )
+    {
+      continue;
+    }
+    if( !elements.hasFrame( i ))
+    {
+      batch.invalid++;
+      continue;
+    }
+
+    const std::string& frame = elements.frame( i );
+    unsigned parts = cull.parts( elements.index( i ), frame, wrenches, i );
+    if( !parts )
+    {
+      batch.culled++;
+      continue;
+    }
+
+    const ros::Time& stamp = elements.stamp( i );
+    WrenchGlyph glyph;
+    TraceScope lookup( trace, "tf lookup" );
+    size_t misses = cache.misses();
+    bool transformed = cache.getTransform( source, frame, stamp, glyph.position, glyph.orientation );
+    // Cache hits are not worth an event.
+    if( cache.misses() == misses )
+    {
+      lookup.cancel();
+    }
+    lookup.end();
+    if( !transformed )
+    {
+      ROS_DEBUG( "Error transforming from frame '%s' to the fixed frame", frame.c_str() );
+      batch.untransformed++;
+      batch.unresolved.push_back( UnresolvedWrench() );
+      UnresolvedWrench& unresolved = batch.unresolved.back();
+      unresolved.element = elements.index( i );
+      unresolved.frame = frame;
+      unresolved.stamp = stamp;
+      detail::setParts( wrenches, i, parts, unresolved.force, unresolved.torque );
+      continue;
+    }
+
+    if ( glyph.position.isNaN() )
+    {
+      ROS_ERROR_THROTTLE(1.0, "Wrench position contains NaNs. Skipping render as long as the position is invalid");
+      batch.untransformed++;
+      continue;
+    }
+
+    detail::setParts( wrenches, i, parts, glyph.force, glyph.torque );
+    batch.glyphs.push_back( glyph );
+    batch.elements.push_back( elements.index( i ));
+  }
+}
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_ELEMENTS_H
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "wrench_filter.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+std::vector<float>& component( WrenchSoA& wrenches, int c )
+{
+  switch( c )
+  {
+  case 0: return wrenches.fx;
+  case 1: return wrenches.fy;
+  case 2: return wrenches.fz;
+  case 3: return wrenches.tx;
+  case 4: return wrenches.ty;
+  default: return wrenches.tz;
+  }
+}
+
+const std::vector<float>& component( const WrenchSoA& wrenches, int c )
+{
+  return component( const_cast<WrenchSoA&>( wrenches ), c );
+}
+}
+
+const size_t WrenchFilter::MAX_WINDOW;
+
+WrenchFilter::WrenchFilter()
+  : type_( NONE )
+  , window_( 10 )
+  , elements_( 0 )
+  , position_( 0 )
+  , count_( 0 )
+{
+}
+
+void WrenchFilter::setType( Type type )
+{
+  type_ = type;
+  clear();
+}
+
+void WrenchFilter::setWindow( size_t samples )
+{
+  window_ = std::max<size_t>( 1, std::min( samples, MAX_WINDOW ));
+  clear();
+}
+
+void WrenchFilter::clear()
+{
+  restart( 0 );
+}
+
+void WrenchFilter::restart( size_t elements )
+{
+  elements_ = elements;
+  output_.resize( elements );
+  for( int c = 0; c < 6; c++ )
+  {
+    std::fill( component( output_, c ).begin(), component( output_, c ).end(),
+               std::numeric_limits<float>::quiet_NaN() );
+  }
+  bool windowed = type_ == MOVING_AVERAGE || type_ == MEDIAN;
+  ring_.assign( windowed ? 6 * window_ * elements : 0, std::numeric_limits<float>::quiet_NaN() );
+  sums_.assign( type_ == MOVING_AVERAGE ? 6 * elements : 0, 0.0 );
+  filled_.assign( type_ == MOVING_AVERAGE ? elements : 0, 0 );
+  position_ = 0;
+  count_ = 0;
+}
+
+void WrenchFilter::push( const WrenchSoA& samples )
+{
+  if( type_ == NONE )
+  {
+    return;
+  }
+  size_t n = samples.size();
+  if( n != elements_ )
+  {
+    restart( n );
+  }
+  validateWrenches( samples, valid_ );
+
+  // Samples in the window after this one.
+  size_t count = std::min( count_ + 1, window_ );
+  size_t previous = ( position_ + window_ - 1 ) % window_;
+  float alpha = 2.0f / ( window_ + 1 );
+
+  // A sample and the ring slot it replaces are finite for all components
+  // or none, so the first component tells for all of them.
+  if( type_ == MOVING_AVERAGE )
+  {
+    const float* slot = &ring_[position_ * n];
+    const float* last = &ring_[previous * n];
+    for( size_t i = 0; i < n; i++ )
+    {
+      filled_[i] += ( valid_[i] || std::isfinite( last[i] )) - std::isfinite( slot[i] );
+    }
+  }
+
+  for( int c = 0; c < 6; c++ )
+  {
+    const float* in = component( samples, c ).data();
+    float* out = component( output_, c ).data();
+
+    if( type_ == LOW_PASS )
+    {
+      for( size_t i = 0; i < n; i++ )
+      {
+        if( !valid_[i] )
+        {
+          continue;
+        }
+        out[i] = std::isfinite( out[i] ) ? out[i] + alpha * ( in[i] - out[i] ) : in[i];
+      }
+      continue;
+    }
+
+    float* slot = &ring_[( c * window_ + position_ ) * n];
+    const float* last = &ring_[( c * window_ + previous ) * n];
+    if( type_ == MOVING_AVERAGE )
+    {
+      double* sums = &sums_[c * n];
+      for( size_t i = 0; i < n; i++ )
+      {
+        float value = valid_[i] ? in[i] : last[i];
+        if( std::isfinite( slot[i] ))
+        {
+          sums[i] -= slot[i];
+        }
+        if( std::isfinite( value ))
+        {
+          sums[i] += value;
+        }
+        slot[i] = value;
+        out[i] = filled_[i] ? sums[i] / filled_[i] : std::numeric_limits<float>::quiet_NaN();
+      }
+      continue;
+    }
+
+    // MEDIAN
+    scratch_.resize( count );
+    const float* ring = &ring_[c * window_ * n];
+    for( size_t i = 0; i < n; i++ )
+    {
+      slot[i] = valid_[i] ? in[i] : last[i];
+      // The filled slots are the first count ones until the ring wraps.
+      size_t finite = 0;
+      for( size_t k = 0; k < count; k++ )
+      {
+        float value = ring[k * n + i];
+        if( std::isfinite( value ))
+        {
+          scratch_[finite++] = value;
+        }
+      }
+      if( !finite )
+      {
+        out[i] = std::numeric_limits<float>::quiet_NaN();
+        continue;
+      }
+      std::nth_element( scratch_.begin(), scratch_.begin() + finite / 2, scratch_.begin() + finite );
+      out[i] = scratch_[finite / 2];
+    }
+  }
+
+  position_ = ( position_ + 1 ) % window_;
+  count_ = count;
+}
+
+size_t WrenchFilter::memoryUsage() const
+{
+  return ( 6 * output_.size() + ring_.capacity() + scratch_.capacity() ) * sizeof( float ) +
+         sums_.capacity() * sizeof( double ) + filled_.capacity() * sizeof( uint32_t ) + valid_.capacity();
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,87 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_FILTER_H
+#define MY_RVIZ_PLUGIN_WRENCH_FILTER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include "wrench_kernel.h"
+
+namespace my_rviz_plugin
+{
+
+// Smooths the wrenches of a stream of messages, element by element, so
+// that one arrow per sensor shows the trend instead of flickering.
+//
+// Every message adds one sample per element. The state of all elements is
+// laid out contiguously per component, and for the windowed filters per
+// ring slot, so a sample touches each component array once, front to
+// back:
+//
+//  - LOW_PASS: exponential moving average with the smoothing factor of a
+//    window-sample average, 2 / ( window + 1 ). O(1) per sample.
+//  - MOVING_AVERAGE: mean of the last window samples from running sums.
+//    O(1) per sample.
+//  - MEDIAN: median of the last window samples. O(window) per sample.
+//
+// A sample with nans or infs is replaced by the previous sample of its
+// element. An element is nan until its first valid sample, which the
+// windowed filters use alone until more arrive. A message with a
+// different number of elements restarts the filter.
+class WrenchFilter
+{
+public:
+  enum Type
+  {
+    NONE,
+    LOW_PASS,
+    MOVING_AVERAGE,
+    MEDIAN
+  };
+
+  static const size_t MAX_WINDOW = 1000;
+
+  WrenchFilter();
+
+  // Changing the type or window restarts the filter.
+  void setType( Type type );
+  void setWindow( size_t samples );
+  bool active() const { return type_ != NONE; }
+
+  // Adds one sample per element.
+  void push( const WrenchSoA& samples );
+
+  // Filtered value of every element after the last push(). Elements
+  // without any valid sample yet are nan.
+  const WrenchSoA& output() const { return output_; }
+
+  void clear();
+
+  size_t memoryUsage() const;
+
+private:
+  void restart( size_t elements );
+
+  Type type_;
+  size_t window_;
+  size_t elements_;
+  WrenchSoA output_;
+  std::vector<uint8_t> valid_;
+
+  // Moving average and median: the last window_ samples of component c
+  // of element i, slot k at ring_[( c * window_ + k ) * elements_ + i].
+  // Slots are nan until filled, and for samples before the first valid
+  // one of their element.
+  std::vector<float> ring_;
+  // Moving average: sum of the finite ring slots of each component and
+  // element, and their number for each element.
+  std::vector<double> sums_;
+  std::vector<uint32_t> filled_;
+  size_t position_;
+  size_t count_;
+  std::vector<float> scratch_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_FILTER_H
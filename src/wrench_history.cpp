@@ -0,0 +1,304 @@
+#include <algorithm>
+
+#include "wrench_history.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+const size_t MIN_CAPACITY = 16;
+// Position, rotation, force and torque.
+const size_t RECORD_BYTES = 13 * sizeof( float );
+}
+
+WrenchHistory::WrenchHistory( size_t length )
+  : entries_( length > 0 ? length : MIN_CAPACITY )
+  , length_( length )
+  , memory_limit_( 0 )
+  , record_overhead_( 0 )
+  , capacity_( 0 )
+  , head_( 0 )
+  , first_( 0 )
+  , records_( 0 )
+  , version_( 0 )
+  , replaced_from_( 0 )
+  , replaced_to_( static_cast<unsigned long>( -1 ))
+{
+  reallocate( MIN_CAPACITY );
+}
+
+size_t WrenchHistory::setLength( size_t length )
+{
+  length_ = length;
+  size_t dropped = 0;
+  if( length > 0 )
+  {
+    while( entries_.size() > length )
+    {
+      dropped += popFront();
+    }
+    entries_.set_capacity( length );
+  }
+  shrink();
+  version_++;
+  return dropped;
+}
+
+size_t WrenchHistory::expire( const ros::Time& stamp )
+{
+  size_t dropped = 0;
+  while( !entries_.empty() && entries_.front().stamp < stamp )
+  {
+    dropped += popFront();
+  }
+  if( dropped )
+  {
+    shrink();
+    version_++;
+  }
+  return dropped;
+}
+
+size_t WrenchHistory::setMemoryLimit( size_t bytes, size_t record_overhead )
+{
+  memory_limit_ = bytes;
+  record_overhead_ = record_overhead;
+  size_t dropped = trim( 0, 0, 1 );
+  if( dropped )
+  {
+    shrink();
+    version_++;
+  }
+  return dropped;
+}
+
+size_t WrenchHistory::trim( size_t records, size_t entries, size_t keep )
+{
+  size_t dropped = 0;
+  while( memory_limit_ > 0 && entries_.size() > keep &&
+         estimate( records_ + records, entries_.size() + entries ) > memory_limit_ )
+  {
+    dropped += popFront();
+  }
+  return dropped;
+}
+
+size_t WrenchHistory::estimate( size_t records, size_t entries ) const
+{
+  return records * ( RECORD_BYTES + record_overhead_ ) + entries * sizeof( Entry );
+}
+
+size_t WrenchHistory::push( const ros::Time& stamp, const WrenchGlyph* glyphs, size_t count )
+{
+  size_t evicted = 0;
+  if( entries_.full() )
+  {
+    if( length_ > 0 )
+    {
+      evicted = popFront();
+    }
+    else
+    {
+      entries_.set_capacity( 2 * entries_.capacity() );
+    }
+  }
+  // The oldest records make room for the new ones within the memory limit.
+  evicted += trim( count, 1, 0 );
+  if( records_ + count > capacity_ )
+  {
+    size_t capacity = std::max( 2 * capacity_, records_ + count );
+    if( memory_limit_ > 0 )
+    {
+      capacity = std::max( records_ + count, std::min( capacity, memory_limit_ / RECORD_BYTES ));
+    }
+    reallocate( capacity );
+  }
+
+  Entry entry;
+  entry.stamp = stamp;
+  entry.first = first_ + records_;
+  entry.count = count;
+  entries_.push_back( entry );
+
+  for( size_t i = 0; i < count; i++ )
+  {
+    store( slot( records_ + i ), glyphs[i] );
+  }
+  records_ += count;
+  version_++;
+  return evicted;
+}
+
+void WrenchHistory::replaceNewest( const ros::Time& stamp, const WrenchGlyph* glyphs, const uint32_t* records,
+                                   size_t count )
+{
+  Entry& entry = entries_.back();
+  entry.stamp = stamp;
+  size_t begin = entry.first - first_;
+  // A run of replacements is only worth listing while it is shorter than
+  // a full rebuild.
+  if( replaced_to_ != version_ || replaced_.size() + count > records_ )
+  {
+    replaced_.clear();
+    replaced_from_ = version_;
+  }
+  for( size_t k = 0; k < count; k++ )
+  {
+    store( slot( begin + records[k] ), glyphs[records[k]] );
+    replaced_.push_back( begin + records[k] );
+  }
+  version_++;
+  replaced_to_ = version_;
+}
+
+bool WrenchHistory::replacedSince( unsigned long version, const std::vector<uint32_t>*& records ) const
+{
+  if( replaced_to_ != version_ || version < replaced_from_ || version > version_ )
+  {
+    return false;
+  }
+  records = &replaced_;
+  return true;
+}
+
+void WrenchHistory::store( size_t s, const WrenchGlyph& glyph )
+{
+  px_[s] = glyph.position.x;
+  py_[s] = glyph.position.y;
+  pz_[s] = glyph.position.z;
+  rotations_.w[s] = glyph.orientation.w;
+  rotations_.x[s] = glyph.orientation.x;
+  rotations_.y[s] = glyph.orientation.y;
+  rotations_.z[s] = glyph.orientation.z;
+  wrenches_.fx[s] = glyph.force.x;
+  wrenches_.fy[s] = glyph.force.y;
+  wrenches_.fz[s] = glyph.force.z;
+  wrenches_.tx[s] = glyph.torque.x;
+  wrenches_.ty[s] = glyph.torque.y;
+  wrenches_.tz[s] = glyph.torque.z;
+}
+
+void WrenchHistory::clear()
+{
+  entries_.clear();
+  first_ += records_;
+  head_ = 0;
+  records_ = 0;
+  version_++;
+}
+
+size_t WrenchHistory::popFront()
+{
+  size_t count = entries_.front().count;
+  entries_.pop_front();
+  head_ = ( head_ + count ) % capacity_;
+  first_ += count;
+  records_ -= count;
+  return count;
+}
+
+void WrenchHistory::shrink()
+{
+  if( records_ * 4 < capacity_ && capacity_ > MIN_CAPACITY )
+  {
+    reallocate( std::max( 2 * records_, MIN_CAPACITY ));
+  }
+}
+
+void WrenchHistory::reallocate( size_t capacity )
+{
+  std::vector<float> px( capacity ), py( capacity ), pz( capacity );
+  RotationSoA rotations;
+  WrenchSoA wrenches;
+  rotations.resize( capacity );
+  wrenches.resize( capacity );
+  for( size_t i = 0; i < records_; i++ )
+  {
+    size_t s = slot( i );
+    px[i] = px_[s];
+    py[i] = py_[s];
+    pz[i] = pz_[s];
+    rotations.w[i] = rotations_.w[s];
+    rotations.x[i] = rotations_.x[s];
+    rotations.y[i] = rotations_.y[s];
+    rotations.z[i] = rotations_.z[s];
+    wrenches.fx[i] = wrenches_.fx[s];
+    wrenches.fy[i] = wrenches_.fy[s];
+    wrenches.fz[i] = wrenches_.fz[s];
+    wrenches.tx[i] = wrenches_.tx[s];
+    wrenches.ty[i] = wrenches_.ty[s];
+    wrenches.tz[i] = wrenches_.tz[s];
+  }
+  px_.swap( px );
+  py_.swap( py );
+  pz_.swap( pz );
+  std::swap( rotations_, rotations );
+  std::swap( wrenches_, wrenches );
+  capacity_ = capacity;
+  head_ = 0;
+}
+
+Ogre::Vector3 WrenchHistory::position( size_t record ) const
+{
+  size_t s = slot( record );
+  return Ogre::Vector3( px_[s], py_[s], pz_[s] );
+}
+
+Ogre::Quaternion WrenchHistory::orientation( size_t record ) const
+{
+  size_t s = slot( record );
+  return Ogre::Quaternion( rotations_.w[s], rotations_.x[s], rotations_.y[s], rotations_.z[s] );
+}
+
+Ogre::Vector3 WrenchHistory::force( size_t record ) const
+{
+  size_t s = slot( record );
+  return Ogre::Vector3( wrenches_.fx[s], wrenches_.fy[s], wrenches_.fz[s] );
+}
+
+Ogre::Vector3 WrenchHistory::torque( size_t record ) const
+{
+  size_t s = slot( record );
+  return Ogre::Vector3( wrenches_.tx[s], wrenches_.ty[s], wrenches_.tz[s] );
+}
+
+WrenchGlyph WrenchHistory::glyph( size_t record ) const
+{
+  WrenchGlyph glyph;
+  glyph.position = position( record );
+  glyph.orientation = orientation( record );
+  glyph.force = force( record );
+  glyph.torque = torque( record );
+  return glyph;
+}
+
+void WrenchHistory::copyTo( std::vector<Ogre::Vector3>& positions, RotationSoA& rotations,
+                            WrenchSoA& wrenches ) const
+{
+  positions.resize( records_ );
+  rotations.resize( records_ );
+  wrenches.resize( records_ );
+  for( size_t i = 0; i < records_; i++ )
+  {
+    size_t s = slot( i );
+    positions[i] = Ogre::Vector3( px_[s], py_[s], pz_[s] );
+    rotations.w[i] = rotations_.w[s];
+    rotations.x[i] = rotations_.x[s];
+    rotations.y[i] = rotations_.y[s];
+    rotations.z[i] = rotations_.z[s];
+    wrenches.fx[i] = wrenches_.fx[s];
+    wrenches.fy[i] = wrenches_.fy[s];
+    wrenches.fz[i] = wrenches_.fz[s];
+    wrenches.tx[i] = wrenches_.tx[s];
+    wrenches.ty[i] = wrenches_.ty[s];
+    wrenches.tz[i] = wrenches_.tz[s];
+  }
+}
+
+size_t WrenchHistory::memoryUsage() const
+{
+  return capacity_ * RECORD_BYTES + entries_.capacity() * sizeof( Entry );
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,160 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_HISTORY_H
+#define MY_RVIZ_PLUGIN_WRENCH_HISTORY_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#ifndef Q_MOC_RUN
+#include <boost/circular_buffer.hpp>
+#endif
+
+#include <ros/time.h>
+#include <OgreVector3.h>
+#include <OgreQuaternion.h>
+
+#include "wrench_kernel.h"
+
+namespace my_rviz_plugin
+{
+
+// One wrench as it is drawn: force and torque in the sensor frame and the
+// pose of the sensor frame in the fixed frame.
+struct WrenchGlyph
+{
+  Ogre::Vector3 position;
+  Ogre::Quaternion orientation;
+  Ogre::Vector3 force;
+  Ogre::Vector3 torque;
+};
+
+// The last n messages of a display as plain records, independent of how
+// they are rendered. Messages can also be kept by age or within a memory
+// limit, with expire() and setMemoryLimit().
+//
+// Records of all entries (one entry per message) live in one ring of
+// structure-of-arrays storage, oldest first, so pushing a message and
+// evicting the oldest one are O(1) per record and need no allocation once
+// the ring is large enough. The record storage grows geometrically and is
+// shrunk again when the history becomes much smaller.
+//
+// Records are addressed by their logical index, 0 being the oldest.
+class WrenchHistory
+{
+public:
+  // A length of 0 keeps any number of entries.
+  explicit WrenchHistory( size_t length = 1 );
+
+  // Drops the oldest entries beyond length right away. Returns the number
+  // of records dropped.
+  size_t setLength( size_t length );
+  size_t length() const { return length_; }
+
+  // Drops the oldest entries stamped before stamp, in O(dropped), assuming
+  // entries are pushed in stamp order. Returns the number of records
+  // dropped.
+  size_t expire( const ros::Time& stamp );
+
+  // Drops the oldest entries, right away and on every push, while the
+  // records and entries would take more than bytes, counting
+  // record_overhead bytes the caller spends per record elsewhere, e.g. on
+  // its visuals. The newest entry is always kept. 0 removes the limit.
+  // Returns the number of records dropped.
+  size_t setMemoryLimit( size_t bytes, size_t record_overhead = 0 );
+  size_t memoryLimit() const { return memory_limit_; }
+  // Bytes counted against the memory limit.
+  size_t memoryEstimate() const { return estimate( records_, entries_.size() ); }
+
+  // Appends an entry, evicting the oldest one if the history is full and
+  // the oldest ones it would not fit within the memory limit with.
+  // Returns the number of records evicted.
+  size_t push( const ros::Time& stamp, const WrenchGlyph* glyphs, size_t count );
+  size_t push( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs )
+  {
+    return push( stamp, glyphs.empty() ? NULL : &glyphs[0], glyphs.size() );
+  }
+
+  // Restamps the newest entry and overwrites its records records[0 ..
+  // count), each with the glyph of the same index. The newest entry must
+  // have a record for every index.
+  void replaceNewest( const ros::Time& stamp, const WrenchGlyph* glyphs, const uint32_t* records, size_t count );
+
+  void clear();
+
+  // Number of entries and of records over all entries.
+  size_t size() const { return entries_.size(); }
+  size_t records() const { return records_; }
+
+  // Records of entry i (0 is the oldest) are [entryBegin( i ), entryBegin( i ) + entrySize( i )).
+  size_t entryBegin( size_t i ) const { return entries_[i].first - first_; }
+  size_t entrySize( size_t i ) const { return entries_[i].count; }
+  const ros::Time& entryStamp( size_t i ) const { return entries_[i].stamp; }
+
+  Ogre::Vector3 position( size_t record ) const;
+  Ogre::Quaternion orientation( size_t record ) const;
+  Ogre::Vector3 force( size_t record ) const;
+  Ogre::Vector3 torque( size_t record ) const;
+  WrenchGlyph glyph( size_t record ) const;
+
+  // Copies all records, oldest first, into contiguous arrays.
+  void copyTo( std::vector<Ogre::Vector3>& positions, RotationSoA& rotations, WrenchSoA& wrenches ) const;
+
+  // Incremented by every change, so that renderers can skip rebuilding.
+  unsigned long version() const { return version_; }
+
+  // Records overwritten by replaceNewest() since version, if nothing else
+  // changed the history since then, so that a renderer built at version
+  // can update just those records. May list a record more than once.
+  // False if the history changed otherwise.
+  bool replacedSince( unsigned long version, const std::vector<uint32_t>*& records ) const;
+
+  // Bytes held by the record and entry storage.
+  size_t memoryUsage() const;
+
+private:
+  struct Entry
+  {
+    ros::Time stamp;
+    // Sequence number of the first record, counted since construction.
+    size_t first;
+    size_t count;
+  };
+
+  size_t slot( size_t record ) const { return ( head_ + record ) % capacity_; }
+  void store( size_t slot, const WrenchGlyph& glyph );
+  size_t popFront();
+  // Drops the oldest entries, keeping at least keep, while the history
+  // with records more records and entries more entries would be over the
+  // memory limit. Returns the number of records dropped.
+  size_t trim( size_t records, size_t entries, size_t keep );
+  size_t estimate( size_t records, size_t entries ) const;
+  // Reallocates the record storage to capacity, keeping the records in order.
+  void reallocate( size_t capacity );
+  // Gives back record storage the history has become much smaller than.
+  void shrink();
+
+  boost::circular_buffer<Entry> entries_;
+  size_t length_;
+  size_t memory_limit_;
+  size_t record_overhead_;
+
+  std::vector<float> px_, py_, pz_;
+  RotationSoA rotations_;
+  WrenchSoA wrenches_;
+  size_t capacity_;
+  // Slot and sequence number of the oldest record.
+  size_t head_;
+  size_t first_;
+  size_t records_;
+
+  unsigned long version_;
+  // Records of the replaceNewest() calls that took the history from
+  // version replaced_from_ to replaced_to_.
+  std::vector<uint32_t> replaced_;
+  unsigned long replaced_from_;
+  unsigned long replaced_to_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_HISTORY_H
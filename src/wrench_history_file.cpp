@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "wrench_history_file.h"
+
+namespace my_rviz_plugin
+{
+
+namespace ipc = boost::interprocess;
+using namespace wrench_history_file;
+
+namespace
+{
+void toRecord( const WrenchGlyph& glyph, Record& record )
+{
+  record.position[0] = glyph.position.x;
+  record.position[1] = glyph.position.y;
+  record.position[2] = glyph.position.z;
+  record.orientation[0] = glyph.orientation.w;
+  record.orientation[1] = glyph.orientation.x;
+  record.orientation[2] = glyph.orientation.y;
+  record.orientation[3] = glyph.orientation.z;
+  record.force[0] = glyph.force.x;
+  record.force[1] = glyph.force.y;
+  record.force[2] = glyph.force.z;
+  record.torque[0] = glyph.torque.x;
+  record.torque[1] = glyph.torque.y;
+  record.torque[2] = glyph.torque.z;
+}
+
+WrenchGlyph toGlyph( const Record& record )
+{
+  WrenchGlyph glyph;
+  glyph.position = Ogre::Vector3( record.position[0], record.position[1], record.position[2] );
+  glyph.orientation = Ogre::Quaternion( record.orientation[0], record.orientation[1],
+                                        record.orientation[2], record.orientation[3] );
+  glyph.force = Ogre::Vector3( record.force[0], record.force[1], record.force[2] );
+  glyph.torque = Ogre::Vector3( record.torque[0], record.torque[1], record.torque[2] );
+  return glyph;
+}
+
+// Creates path, empty, with room for entries entries and records records.
+bool createFile( const std::string& path, size_t entries, size_t records )
+{
+  std::filebuf file;
+  if( !file.open( path.c_str(), std::ios_base::in | std::ios_base::out |
+                  std::ios_base::trunc | std::ios_base::binary ))
+  {
+    return false;
+  }
+  Header header = Header();
+  header.record_capacity = records;
+  header.entry_capacity = entries;
+  // The magic is written last, once the file has its full size.
+  if( file.sputn( reinterpret_cast<const char*>( &header ), sizeof( header )) != sizeof( header ) ||
+      file.pubseekoff( fileSize( entries, records ) - 1, std::ios_base::beg ) < 0 ||
+      file.sputc( 0 ) == std::filebuf::traits_type::eof() ||
+      file.pubseekoff( 0, std::ios_base::beg ) < 0 )
+  {
+    return false;
+  }
+  header.magic = MAGIC;
+  header.version = VERSION;
+  file.sputn( reinterpret_cast<const char*>( &header ), sizeof( header ));
+  return file.close() != NULL;
+}
+
+bool sameFile( const std::string& a, const std::string& b )
+{
+  struct stat sa, sb;
+  return stat( a.c_str(), &sa ) == 0 && stat( b.c_str(), &sb ) == 0 &&
+         sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+}
+
+WrenchHistoryFile::WrenchHistoryFile()
+  : header_( NULL )
+  , entries_( NULL )
+  , records_( NULL )
+{
+}
+
+bool WrenchHistoryFile::open( const std::string& path, size_t records )
+{
+  close();
+  error_.clear();
+  if( records == 0 )
+  {
+    error_ = "no room for records";
+    return false;
+  }
+  // An existing history file is reused with its own capacity, which is
+  // how the history survives a restart and how exports are reloaded.
+  if( map( path ))
+  {
+    path_ = path;
+    dropOverwritten( header_->entries_written, header_->records_written );
+    return true;
+  }
+  close();
+  // Never overwrite a file that is not a history file.
+  if( std::ifstream( path.c_str() ).good() )
+  {
+    error_ = "'" + path + "' is not a history file";
+    return false;
+  }
+  if( !createFile( path, records, records ))
+  {
+    error_ = "cannot create '" + path + "'";
+    return false;
+  }
+  if( !map( path ))
+  {
+    close();
+    error_ = "cannot map '" + path + "'";
+    return false;
+  }
+  path_ = path;
+  return true;
+}
+
+bool WrenchHistoryFile::map( const std::string& path )
+{
+  try
+  {
+    ipc::file_mapping file( path.c_str(), ipc::read_write );
+    ipc::mapped_region region( file, ipc::read_write );
+    if( region.get_size() < sizeof( Header ))
+    {
+      return false;
+    }
+    Header* header = static_cast<Header*>( region.get_address() );
+    if( header->magic != MAGIC || header->version != VERSION ||
+        header->record_capacity == 0 || header->entry_capacity == 0 ||
+        region.get_size() < fileSize( header->entry_capacity, header->record_capacity ))
+    {
+      return false;
+    }
+    file_.swap( file );
+    region_.swap( region );
+    header_ = header;
+  }
+  catch( const ipc::interprocess_exception& )
+  {
+    return false;
+  }
+  char* base = static_cast<char*>( region_.get_address() );
+  entries_ = reinterpret_cast<Entry*>( base + entriesOffset() );
+  records_ = reinterpret_cast<Record*>( base + recordsOffset( header_->entry_capacity ));
+  return true;
+}
+
+void WrenchHistoryFile::close()
+{
+  header_ = NULL;
+  entries_ = NULL;
+  records_ = NULL;
+  path_.clear();
+  ipc::mapped_region().swap( region_ );
+  ipc::file_mapping().swap( file_ );
+}
+
+const Entry& WrenchHistoryFile::entry( uint64_t entry ) const
+{
+  return entries_[entry % header_->entry_capacity];
+}
+
+Record& WrenchHistoryFile::record( uint64_t record ) const
+{
+  return records_[record % header_->record_capacity];
+}
+
+void WrenchHistoryFile::dropOverwritten( uint64_t end, uint64_t records_written )
+{
+  uint64_t first = header_->first_entry;
+  if( end - first > header_->entry_capacity || first > end )
+  {
+    first = end - std::min<uint64_t>( end, header_->entry_capacity );
+  }
+  uint64_t oldest_record = records_written - std::min<uint64_t>( records_written, header_->record_capacity );
+  // Only entries already written are checked; a new one is never dropped.
+  while( first < header_->entries_written && entry( first ).first_record < oldest_record )
+  {
+    first++;
+  }
+  header_->first_entry = first;
+}
+
+void WrenchHistoryFile::append( const ros::Time& stamp, const WrenchGlyph* glyphs, size_t count )
+{
+  if( !header_ || count > header_->record_capacity )
+  {
+    return;
+  }
+  // The entries about to be overwritten are dropped first, then the
+  // records and the entry are written, then the counts, so that a file
+  // left behind by a crash of the process at any point still reads
+  // consistently. The fences keep the compiler to that order; the kernel
+  // writes the pages back in its own order, so a power loss can still
+  // tear the file.
+  uint64_t first = header_->records_written;
+  uint64_t index = header_->entries_written;
+  dropOverwritten( index + 1, first + count );
+  std::atomic_signal_fence( std::memory_order_seq_cst );
+  for( size_t i = 0; i < count; i++ )
+  {
+    toRecord( glyphs[i], record( first + i ));
+  }
+  Entry& slot = entries_[index % header_->entry_capacity];
+  slot.first_record = first;
+  slot.count = count;
+  slot.stamp_sec = stamp.sec;
+  slot.stamp_nsec = stamp.nsec;
+  slot.reserved = 0;
+  std::atomic_signal_fence( std::memory_order_seq_cst );
+  header_->records_written = first + count;
+  header_->entries_written = index + 1;
+}
+
+ros::Time WrenchHistoryFile::entryStamp( uint64_t index ) const
+{
+  const Entry& slot = entry( index );
+  return ros::Time( slot.stamp_sec, slot.stamp_nsec );
+}
+
+uint64_t WrenchHistoryFile::findEntry( const ros::Time& stamp ) const
+{
+  uint64_t begin = firstEntry();
+  uint64_t end = endEntry();
+  while( begin < end )
+  {
+    uint64_t middle = begin + ( end - begin ) / 2;
+    if( entryStamp( middle ) < stamp )
+    {
+      begin = middle + 1;
+    }
+    else
+    {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+void WrenchHistoryFile::load( uint64_t begin, uint64_t end, WrenchHistory& history ) const
+{
+  std::vector<WrenchGlyph> glyphs;
+  for( uint64_t i = std::max( begin, firstEntry() ); i < std::min( end, endEntry() ); i++ )
+  {
+    const Entry& slot = entry( i );
+    glyphs.resize( slot.count );
+    for( size_t k = 0; k < slot.count; k++ )
+    {
+      glyphs[k] = toGlyph( record( slot.first_record + k ));
+    }
+    history.push( entryStamp( i ), glyphs );
+  }
+}
+
+bool WrenchHistoryFile::checkExportPath( const std::string& path, bool replace )
+{
+  error_.clear();
+  // Truncating the mapped file would crash whoever has it open.
+  if( isOpen() && sameFile( path, path_ ))
+  {
+    error_ = "'" + path + "' is the open history file";
+    return false;
+  }
+  if( !replace && std::ifstream( path.c_str() ).good() )
+  {
+    error_ = "'" + path + "' exists";
+    return false;
+  }
+  return true;
+}
+
+long WrenchHistoryFile::exportCsv( const std::string& path, uint64_t begin, uint64_t end, bool replace )
+{
+  if( !checkExportPath( path, replace ))
+  {
+    return -1;
+  }
+  FILE* file = std::fopen( path.c_str(), "w" );
+  if( !file )
+  {
+    error_ = "cannot write '" + path + "'";
+    return -1;
+  }
+  std::fprintf( file, "stamp,entry,element,px,py,pz,qw,qx,qy,qz,fx,fy,fz,tx,ty,tz\n" );
+  long written = 0;
+  for( uint64_t i = std::max( begin, firstEntry() ); i < std::min( end, endEntry() ); i++ )
+  {
+    const Entry& slot = entry( i );
+    for( size_t k = 0; k < slot.count; k++ )
+    {
+      const Record& r = record( slot.first_record + k );
+      std::fprintf( file, "%u.%09u,%llu,%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                    slot.stamp_sec, slot.stamp_nsec, static_cast<unsigned long long>( i ),
+                    static_cast<unsigned>( k ),
+                    r.position[0], r.position[1], r.position[2],
+                    r.orientation[0], r.orientation[1], r.orientation[2], r.orientation[3],
+                    r.force[0], r.force[1], r.force[2], r.torque[0], r.torque[1], r.torque[2] );
+      written++;
+    }
+  }
+  if( std::fclose( file ) != 0 )
+  {
+    error_ = "cannot write '" + path + "'";
+    return -1;
+  }
+  return written;
+}
+
+long WrenchHistoryFile::exportBinary( const std::string& path, uint64_t begin, uint64_t end, bool replace )
+{
+  if( !checkExportPath( path, replace ))
+  {
+    return -1;
+  }
+  begin = std::max( begin, firstEntry() );
+  end = std::min( end, endEntry() );
+  size_t records = 0;
+  for( uint64_t i = begin; i < end; i++ )
+  {
+    records += entry( i ).count;
+  }
+  WrenchHistoryFile out;
+  if( !createFile( path, std::max<uint64_t>( end - begin, 1 ), std::max<size_t>( records, 1 )) ||
+      !out.map( path ))
+  {
+    error_ = "cannot write '" + path + "'";
+    return -1;
+  }
+  std::vector<WrenchGlyph> glyphs;
+  for( uint64_t i = begin; i < end; i++ )
+  {
+    const Entry& slot = entry( i );
+    glyphs.resize( slot.count );
+    for( size_t k = 0; k < slot.count; k++ )
+    {
+      glyphs[k] = toGlyph( record( slot.first_record + k ));
+    }
+    out.append( entryStamp( i ), glyphs.empty() ? NULL : &glyphs[0], glyphs.size() );
+  }
+  return records;
+}
+
+} // end namespace my_rviz_plugin
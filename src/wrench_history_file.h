@@ -0,0 +1,159 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_HISTORY_FILE_H
+#define MY_RVIZ_PLUGIN_WRENCH_HISTORY_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#ifndef Q_MOC_RUN
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+
+#include <ros/time.h>
+
+#include "wrench_history.h"
+
+namespace my_rviz_plugin
+{
+
+// Layout of a history file, a memory-mapped ring of the records a display
+// has shown:
+//
+//   [Header][Entry x entry_capacity][Record x record_capacity]
+//
+// Entry k (one per message, counted since the file was created) is
+// stored at k % entry_capacity, record n at n % record_capacity. An entry
+// is valid while neither it nor any of its records has been overwritten.
+// Poses are in the fixed frame of the display at the time they were shown.
+namespace wrench_history_file
+{
+
+const uint32_t MAGIC = 0x57524853; // "WRHS"
+const uint32_t VERSION = 1;
+
+struct Header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t record_capacity;
+  uint64_t entry_capacity;
+  uint64_t entries_written;
+  uint64_t records_written;
+  // Oldest entry that is still valid.
+  uint64_t first_entry;
+};
+
+struct Entry
+{
+  uint64_t first_record;
+  uint32_t count;
+  uint32_t stamp_sec;
+  uint32_t stamp_nsec;
+  uint32_t reserved;
+};
+
+struct Record
+{
+  float position[3];
+  // w, x, y, z
+  float orientation[4];
+  float force[3];
+  float torque[3];
+};
+
+inline size_t alignUp( size_t n, size_t alignment )
+{
+  return ( n + alignment - 1 ) / alignment * alignment;
+}
+
+inline size_t entriesOffset()
+{
+  return alignUp( sizeof( Header ), 64 );
+}
+
+inline size_t recordsOffset( size_t entry_capacity )
+{
+  return alignUp( entriesOffset() + entry_capacity * sizeof( Entry ), 64 );
+}
+
+inline size_t fileSize( size_t entry_capacity, size_t record_capacity )
+{
+  return recordsOffset( entry_capacity ) + record_capacity * sizeof( Record );
+}
+
+} // end namespace wrench_history_file
+
+// Long history of a display on disk, so that the last minutes of force
+// data can be looked at, exported or reloaded after a restart while only
+// a window of it is kept in a WrenchHistory and drawn.
+//
+// Appending writes through the mapping; the kernel writes the pages back,
+// so RAM use does not grow with the length of the file. A file is only
+// meant to be written by one display at a time.
+class WrenchHistoryFile
+{
+public:
+  WrenchHistoryFile();
+
+  // Maps the history file at path, creating it with room for records
+  // records if it does not exist. An existing one keeps its capacity; any
+  // other file is left alone. Returns false and sets error() on failure.
+  bool open( const std::string& path, size_t records );
+  void close();
+  bool isOpen() const { return header_ != NULL; }
+  const std::string& error() const { return error_; }
+
+  // Appends a message. Messages with more records than the file holds are
+  // left out.
+  void append( const ros::Time& stamp, const WrenchGlyph* glyphs, size_t count );
+  void append( const ros::Time& stamp, const std::vector<WrenchGlyph>& glyphs )
+  {
+    append( stamp, glyphs.empty() ? NULL : &glyphs[0], glyphs.size() );
+  }
+
+  // Valid entries are [firstEntry(), endEntry()), oldest first.
+  uint64_t firstEntry() const { return header_ ? header_->first_entry : 0; }
+  uint64_t endEntry() const { return header_ ? header_->entries_written : 0; }
+  ros::Time entryStamp( uint64_t entry ) const;
+  // First valid entry stamped at or after stamp, assuming entries are
+  // appended in stamp order.
+  uint64_t findEntry( const ros::Time& stamp ) const;
+
+  // Pushes entries [begin, end) into history.
+  void load( uint64_t begin, uint64_t end, WrenchHistory& history ) const;
+
+  // Write entries [begin, end) as CSV, one line per record, or as a
+  // history file of their own that open() can reload. An existing file at
+  // path is only replaced if replace is set, and the open file never is.
+  // Return the number of records written, or -1 and set error() on error.
+  long exportCsv( const std::string& path, uint64_t begin, uint64_t end, bool replace );
+  long exportBinary( const std::string& path, uint64_t begin, uint64_t end, bool replace );
+
+  // Size of the file and the number of records it holds.
+  size_t size() const { return region_.get_size(); }
+  size_t capacity() const { return header_ ? header_->record_capacity : 0; }
+
+private:
+  bool map( const std::string& path );
+  // False, setting error_, if an export must not write path.
+  bool checkExportPath( const std::string& path, bool replace );
+  const wrench_history_file::Entry& entry( uint64_t entry ) const;
+  wrench_history_file::Record& record( uint64_t record ) const;
+  // Advances first_entry past the entries that are overwritten once end
+  // entries and records_written records have been written.
+  void dropOverwritten( uint64_t end, uint64_t records_written );
+
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  wrench_history_file::Header* header_;
+  wrench_history_file::Entry* entries_;
+  wrench_history_file::Record* records_;
+  std::string path_;
+  std::string error_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_HISTORY_FILE_H
@@ -0,0 +1,205 @@
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "wrench_kernel.h"
+
+namespace my_rviz_plugin
+{
+
+namespace
+{
+
+inline bool isFinite( float x, float y, float z )
+{
+  return std::isfinite( x ) && std::isfinite( y ) && std::isfinite( z );
+}
+
+// v' = v + w t + q x t with t = 2 q x v
+inline void rotate( float qw, float qx, float qy, float qz, float& x, float& y, float& z )
+{
+  float tx = 2 * ( qy * z - qz * y );
+  float ty = 2 * ( qz * x - qx * z );
+  float tz = 2 * ( qx * y - qy * x );
+  float rx = x + qw * tx + ( qy * tz - qz * ty );
+  float ry = y + qw * ty + ( qz * tx - qx * tz );
+  float rz = z + qw * tz + ( qx * ty - qy * tx );
+  x = rx;
+  y = ry;
+  z = rz;
+}
+
+#ifdef __SSE2__
+// x - x is 0 for finite values and nan for nans and infs.
+inline __m128 isFinite4( __m128 x )
+{
+  return _mm_cmpeq_ps( _mm_sub_ps( x, x ), _mm_setzero_ps() );
+}
+
+inline void rotate4( __m128 qw, __m128 qx, __m128 qy, __m128 qz, __m128& x, __m128& y, __m128& z )
+{
+  const __m128 two = _mm_set1_ps( 2.0f );
+  __m128 tx = _mm_mul_ps( two, _mm_sub_ps( _mm_mul_ps( qy, z ), _mm_mul_ps( qz, y )));
+  __m128 ty = _mm_mul_ps( two, _mm_sub_ps( _mm_mul_ps( qz, x ), _mm_mul_ps( qx, z )));
+  __m128 tz = _mm_mul_ps( two, _mm_sub_ps( _mm_mul_ps( qx, y ), _mm_mul_ps( qy, x )));
+  __m128 rx = _mm_add_ps( _mm_add_ps( x, _mm_mul_ps( qw, tx )), _mm_sub_ps( _mm_mul_ps( qy, tz ), _mm_mul_ps( qz, ty )));
+  __m128 ry = _mm_add_ps( _mm_add_ps( y, _mm_mul_ps( qw, ty )), _mm_sub_ps( _mm_mul_ps( qz, tx ), _mm_mul_ps( qx, tz )));
+  __m128 rz = _mm_add_ps( _mm_add_ps( z, _mm_mul_ps( qw, tz )), _mm_sub_ps( _mm_mul_ps( qx, ty ), _mm_mul_ps( qy, tx )));
+  x = rx;
+  y = ry;
+  z = rz;
+}
+
+inline __m128 norm4( __m128 x, __m128 y, __m128 z )
+{
+  return _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y )), _mm_mul_ps( z, z )));
+}
+#endif
+
+// Scalar loops over the elements from begin on.
+size_t validateFrom( const WrenchSoA& in, std::vector<uint8_t>& valid, size_t begin )
+{
+  size_t count = 0;
+  for( size_t i = begin; i < in.size(); i++ )
+  {
+    valid[i] = isFinite( in.fx[i], in.fy[i], in.fz[i] ) && isFinite( in.tx[i], in.ty[i], in.tz[i] );
+    count += valid[i];
+  }
+  return count;
+}
+
+void transformFrom( const WrenchSoA& in, const RotationSoA& rotation, float force_scale, float torque_scale,
+                    WrenchSoA& out, std::vector<float>& force_norm, std::vector<float>& torque_norm, size_t begin )
+{
+  for( size_t i = begin; i < in.size(); i++ )
+  {
+    float x = in.fx[i], y = in.fy[i], z = in.fz[i];
+    rotate( rotation.w[i], rotation.x[i], rotation.y[i], rotation.z[i], x, y, z );
+    out.fx[i] = x * force_scale;
+    out.fy[i] = y * force_scale;
+    out.fz[i] = z * force_scale;
+    force_norm[i] = std::sqrt( out.fx[i] * out.fx[i] + out.fy[i] * out.fy[i] + out.fz[i] * out.fz[i] );
+
+    x = in.tx[i];
+    y = in.ty[i];
+    z = in.tz[i];
+    rotate( rotation.w[i], rotation.x[i], rotation.y[i], rotation.z[i], x, y, z );
+    out.tx[i] = x * torque_scale;
+    out.ty[i] = y * torque_scale;
+    out.tz[i] = z * torque_scale;
+    torque_norm[i] = std::sqrt( out.tx[i] * out.tx[i] + out.ty[i] * out.ty[i] + out.tz[i] * out.tz[i] );
+  }
+}
+
+}
+
+void WrenchSoA::resize( size_t size )
+{
+  fx.resize( size );
+  fy.resize( size );
+  fz.resize( size );
+  tx.resize( size );
+  ty.resize( size );
+  tz.resize( size );
+}
+
+void RotationSoA::resize( size_t size )
+{
+  w.resize( size );
+  x.resize( size );
+  y.resize( size );
+  z.resize( size );
+}
+
+size_t validateWrenches( const WrenchSoA& in, std::vector<uint8_t>& valid )
+{
+  size_t size = in.size();
+  valid.resize( size );
+  size_t count = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  for( ; i + 4 <= size; i += 4 )
+  {
+    __m128 mask = _mm_and_ps( _mm_and_ps( isFinite4( _mm_loadu_ps( &in.fx[i] )),
+                                          isFinite4( _mm_loadu_ps( &in.fy[i] ))),
+                              isFinite4( _mm_loadu_ps( &in.fz[i] )));
+    mask = _mm_and_ps( mask, _mm_and_ps( _mm_and_ps( isFinite4( _mm_loadu_ps( &in.tx[i] )),
+                                                     isFinite4( _mm_loadu_ps( &in.ty[i] ))),
+                                         isFinite4( _mm_loadu_ps( &in.tz[i] ))));
+    int bits = _mm_movemask_ps( mask );
+    for( int k = 0; k < 4; k++ )
+    {
+      valid[i + k] = ( bits >> k ) & 1;
+      count += valid[i + k];
+    }
+  }
+#endif
+  return count + validateFrom( in, valid, i );
+}
+
+size_t validateWrenchesScalar( const WrenchSoA& in, std::vector<uint8_t>& valid )
+{
+  valid.resize( in.size() );
+  return validateFrom( in, valid, 0 );
+}
+
+void transformWrenches( const WrenchSoA& in, const RotationSoA& rotation,
+                        float force_scale, float torque_scale,
+                        WrenchSoA& out, std::vector<float>& force_norm, std::vector<float>& torque_norm )
+{
+  size_t size = in.size();
+  out.resize( size );
+  force_norm.resize( size );
+  torque_norm.resize( size );
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128 fs = _mm_set1_ps( force_scale );
+  const __m128 ts = _mm_set1_ps( torque_scale );
+  for( ; i + 4 <= size; i += 4 )
+  {
+    __m128 qw = _mm_loadu_ps( &rotation.w[i] );
+    __m128 qx = _mm_loadu_ps( &rotation.x[i] );
+    __m128 qy = _mm_loadu_ps( &rotation.y[i] );
+    __m128 qz = _mm_loadu_ps( &rotation.z[i] );
+
+    __m128 x = _mm_loadu_ps( &in.fx[i] );
+    __m128 y = _mm_loadu_ps( &in.fy[i] );
+    __m128 z = _mm_loadu_ps( &in.fz[i] );
+    rotate4( qw, qx, qy, qz, x, y, z );
+    x = _mm_mul_ps( x, fs );
+    y = _mm_mul_ps( y, fs );
+    z = _mm_mul_ps( z, fs );
+    _mm_storeu_ps( &out.fx[i], x );
+    _mm_storeu_ps( &out.fy[i], y );
+    _mm_storeu_ps( &out.fz[i], z );
+    _mm_storeu_ps( &force_norm[i], norm4( x, y, z ));
+
+    x = _mm_loadu_ps( &in.tx[i] );
+    y = _mm_loadu_ps( &in.ty[i] );
+    z = _mm_loadu_ps( &in.tz[i] );
+    rotate4( qw, qx, qy, qz, x, y, z );
+    x = _mm_mul_ps( x, ts );
+    y = _mm_mul_ps( y, ts );
+    z = _mm_mul_ps( z, ts );
+    _mm_storeu_ps( &out.tx[i], x );
+    _mm_storeu_ps( &out.ty[i], y );
+    _mm_storeu_ps( &out.tz[i], z );
+    _mm_storeu_ps( &torque_norm[i], norm4( x, y, z ));
+  }
+#endif
+  transformFrom( in, rotation, force_scale, torque_scale, out, force_norm, torque_norm, i );
+}
+
+void transformWrenchesScalar( const WrenchSoA& in, const RotationSoA& rotation,
+                              float force_scale, float torque_scale,
+                              WrenchSoA& out, std::vector<float>& force_norm, std::vector<float>& torque_norm )
+{
+  out.resize( in.size() );
+  force_norm.resize( in.size() );
+  torque_norm.resize( in.size() );
+  transformFrom( in, rotation, force_scale, torque_scale, out, force_norm, torque_norm, 0 );
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,53 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_KERNEL_H
+#define MY_RVIZ_PLUGIN_WRENCH_KERNEL_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace my_rviz_plugin
+{
+
+// Contiguous structure-of-arrays block of wrenches, one entry per element.
+struct WrenchSoA
+{
+  std::vector<float> fx, fy, fz;
+  std::vector<float> tx, ty, tz;
+
+  void resize( size_t size );
+  size_t size() const { return fx.size(); }
+};
+
+// One unit quaternion per element.
+struct RotationSoA
+{
+  std::vector<float> w, x, y, z;
+
+  void resize( size_t size );
+  size_t size() const { return w.size(); }
+};
+
+// Batch kernels over whole wrench arrays. They do not depend on Ogre or
+// ROS and use SSE when the compiler targets it, four elements at a time,
+// with a scalar loop for the remainder.
+
+// Sets valid[i] to 1 if all six components of element i are finite and to
+// 0 otherwise. Returns the number of valid elements.
+size_t validateWrenches( const WrenchSoA& in, std::vector<uint8_t>& valid );
+
+// Rotates force and torque of element i by rotation i, multiplies them by
+// force_scale and torque_scale and stores the magnitudes of the results.
+// out may not alias in.
+void transformWrenches( const WrenchSoA& in, const RotationSoA& rotation,
+                        float force_scale, float torque_scale,
+                        WrenchSoA& out, std::vector<float>& force_norm, std::vector<float>& torque_norm );
+
+// The same without SSE, as the reference for tests and benchmarks.
+size_t validateWrenchesScalar( const WrenchSoA& in, std::vector<uint8_t>& valid );
+void transformWrenchesScalar( const WrenchSoA& in, const RotationSoA& rotation,
+                              float force_scale, float torque_scale,
+                              WrenchSoA& out, std::vector<float>& force_norm, std::vector<float>& torque_norm );
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_KERNEL_H
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+
+#include <OgreCamera.h>
+#include <OgreViewport.h>
+#include <OgrePlane.h>
+
+#include "wrench_lod.h"
+
+namespace my_rviz_plugin
+{
+
+bool LodView::fromCamera( Ogre::Camera* camera, LodView& view )
+{
+  if( !camera || !camera->getViewport() )
+  {
+    return false;
+  }
+  float height = camera->getViewport()->getActualHeight();
+  view.position = camera->getDerivedPosition();
+  view.direction = camera->getDerivedDirection();
+  view.orthographic = camera->getProjectionType() == Ogre::PT_ORTHOGRAPHIC;
+  if( view.orthographic )
+  {
+    view.pixels_per_unit = height / camera->getOrthoWindowHeight();
+  }
+  else
+  {
+    view.pixels_per_unit = height / ( 2 * std::tan( camera->getFOVy().valueRadians() / 2 ));
+  }
+  for( unsigned short i = 0; i < 6; i++ )
+  {
+    const Ogre::Plane& plane = camera->getFrustumPlane( i );
+    view.normals[i] = plane.normal;
+    view.distances[i] = plane.d;
+  }
+  return true;
+}
+
+WrenchLevelOfDetail::WrenchLevelOfDetail()
+  : full_size_( 20 )
+  , min_size_( 1 )
+  , line_distance_( 0 )
+  , force_scale_( 1 )
+  , torque_scale_( 1 )
+  , history_version_( 0 )
+  , norms_valid_( false )
+  , version_( 0 )
+{
+  counts_[CULLED] = counts_[LINE] = counts_[FULL] = 0;
+}
+
+void WrenchLevelOfDetail::setSizes( float full_size, float min_size )
+{
+  full_size_ = full_size;
+  min_size_ = min_size;
+}
+
+void WrenchLevelOfDetail::setLineDistance( float distance )
+{
+  line_distance_ = distance;
+}
+
+void WrenchLevelOfDetail::setScales( float force_scale, float torque_scale )
+{
+  force_scale_ = force_scale;
+  torque_scale_ = torque_scale;
+}
+
+bool WrenchLevelOfDetail::update( const WrenchHistory& history, const Ogre::Matrix4& to_world,
+                                  const LodView& view )
+{
+  size_t records = history.records();
+  bool changed = !norms_valid_ || history.version() != history_version_;
+  if( changed )
+  {
+    force_norms_.resize( records );
+    torque_norms_.resize( records );
+    for( size_t i = 0; i < records; i++ )
+    {
+      force_norms_[i] = history.force( i ).length();
+      torque_norms_[i] = history.torque( i ).length();
+    }
+    history_version_ = history.version();
+    norms_valid_ = true;
+  }
+
+  tiers_.swap( previous_ );
+  tiers_.resize( records );
+  counts_[CULLED] = counts_[LINE] = counts_[FULL] = 0;
+  float line_distance2 = line_distance_ * line_distance_;
+  for( size_t i = 0; i < records; i++ )
+  {
+    float size = std::max( force_norms_[i] * force_scale_, torque_norms_[i] * torque_scale_ );
+    Ogre::Vector3 position = to_world * history.position( i );
+
+    // The glyph lies within size of its origin.
+    uint8_t tier = FULL;
+    for( int k = 0; k < 6; k++ )
+    {
+      if( view.normals[k].dotProduct( position ) + view.distances[k] < -size )
+      {
+        tier = CULLED;
+        break;
+      }
+    }
+    if( tier != CULLED )
+    {
+      Ogre::Vector3 offset = position - view.position;
+      float pixels = size * view.pixels_per_unit;
+      if( !view.orthographic )
+      {
+        pixels /= std::max( offset.dotProduct( view.direction ), 1e-6f );
+      }
+      if( pixels < min_size_ )
+      {
+        tier = CULLED;
+      }
+      else if( pixels < full_size_ || ( line_distance2 > 0 && offset.squaredLength() > line_distance2 ))
+      {
+        tier = LINE;
+      }
+    }
+    tiers_[i] = tier;
+    counts_[tier]++;
+  }
+
+  changed = changed || tiers_ != previous_;
+  if( changed )
+  {
+    version_++;
+  }
+  return changed;
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,100 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_LOD_H
+#define MY_RVIZ_PLUGIN_WRENCH_LOD_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <OgreVector3.h>
+#include <OgreMatrix4.h>
+
+#include "wrench_history.h"
+
+namespace Ogre
+{
+class Camera;
+}
+
+namespace my_rviz_plugin
+{
+
+// What the level of detail needs to know about the camera, taken once
+// per frame.
+struct LodView
+{
+  Ogre::Vector3 position;
+  Ogre::Vector3 direction;
+  bool orthographic;
+  // Pixels per world unit, at unit depth for perspective projection.
+  float pixels_per_unit;
+  // Frustum planes, normals pointing inwards.
+  Ogre::Vector3 normals[6];
+  float distances[6];
+
+  // Returns false if the camera has no viewport yet.
+  static bool fromCamera( Ogre::Camera* camera, LodView& view );
+};
+
+// Picks how every record of a WrenchHistory is drawn, from its size on
+// screen and its distance to the camera:
+//
+//  - FULL: arrows and torque ring, as rviz::WrenchVisual draws them.
+//  - LINE: one line segment each for force and torque.
+//  - CULLED: nothing, for glyphs outside the view frustum or smaller than
+//    the minimum size.
+//
+// The size of a glyph is the longer of its scaled force and torque.
+// update() is cheap enough to run every frame; renderers only rebuild
+// their geometry when version() changes.
+class WrenchLevelOfDetail
+{
+public:
+  enum Tier
+  {
+    CULLED = 0,
+    LINE = 1,
+    FULL = 2
+  };
+
+  WrenchLevelOfDetail();
+
+  // Glyphs at least full_size pixels long are drawn in full, those at
+  // least min_size pixels long as lines.
+  void setSizes( float full_size, float min_size );
+  // Glyphs farther than distance are drawn as lines at most. 0 disables it.
+  void setLineDistance( float distance );
+  void setScales( float force_scale, float torque_scale );
+
+  // Recomputes the tiers for view. to_world maps history positions to
+  // world coordinates. Returns true if any tier changed.
+  bool update( const WrenchHistory& history, const Ogre::Matrix4& to_world, const LodView& view );
+
+  // Tier of every record of the history, oldest first.
+  const std::vector<uint8_t>& tiers() const { return tiers_; }
+  size_t count( Tier tier ) const { return counts_[tier]; }
+
+  // Incremented whenever the tiers change.
+  unsigned long version() const { return version_; }
+
+private:
+  float full_size_;
+  float min_size_;
+  float line_distance_;
+  float force_scale_;
+  float torque_scale_;
+
+  // Unscaled force and torque magnitudes, recomputed when the history changes.
+  std::vector<float> force_norms_;
+  std::vector<float> torque_norms_;
+  unsigned long history_version_;
+  bool norms_valid_;
+
+  std::vector<uint8_t> tiers_;
+  std::vector<uint8_t> previous_;
+  size_t counts_[3];
+  unsigned long version_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_LOD_H
@@ -0,0 +1,177 @@
+#include <rviz/properties/float_property.h>
+#include <rviz/properties/int_property.h>
+#include <rviz/properties/string_property.h>
+
+#include <boost/bind.hpp>
+
+#include "wrench_multi_display.h"
+
+namespace my_rviz_plugin
+{
+
+WrenchStampedMultiDisplay::WrenchStampedMultiDisplay()
+  : engine_( this )
+{
+    topics_property_ =
+            new rviz::StringProperty( "Topics", "",
+                                      "geometry_msgs::WrenchStamped topics to show, separated by commas or spaces. "
+                                      "Element indices of the Culling properties follow this order.",
+                                      this, SLOT( updateTopics() ));
+
+    tolerance_property_ =
+            new rviz::FloatProperty( "Sync Tolerance", 0.02,
+                                     "Maximum difference [s] between the stamps of the messages shown together.",
+                                     this, SLOT( updateSynchronization() ));
+    tolerance_property_->setMin( 0.0 );
+
+    queue_size_property_ =
+            new rviz::IntProperty( "Queue Size", 10,
+                                   "Messages per topic that wait for the other topics. Raise it for topics "
+                                   "with very different rates.",
+                                   this, SLOT( updateSynchronization() ));
+    queue_size_property_->setMin( 1 );
+}
+
+WrenchStampedMultiDisplay::~WrenchStampedMultiDisplay()
+{
+    unsubscribe();
+}
+
+void WrenchStampedMultiDisplay::onInitialize()
+{
+    engine_.initialize( context_, scene_node_ );
+    updateSynchronization( );
+    updateTopics( );
+}
+
+void WrenchStampedMultiDisplay::onEnable()
+{
+    subscribe();
+}
+
+void WrenchStampedMultiDisplay::onDisable()
+{
+    unsubscribe();
+    reset();
+}
+
+// Override rviz::Display's reset() function to add a call to clear().
+void WrenchStampedMultiDisplay::reset()
+{
+    Display::reset();
+    synchronizer_.clear();
+    engine_.reset();
+}
+
+void WrenchStampedMultiDisplay::update( float wall_dt, float ros_dt )
+{
+    Display::update( wall_dt, ros_dt );
+    if( !topics_.empty() )
+    {
+      setStatus( rviz::StatusProperty::Ok, "Synchronization",
+                 QString( "%1 sets, %2 messages dropped unmatched" )
+                 .arg( synchronizer_.sets() ).arg( synchronizer_.dropped() ));
+    }
+    engine_.update( wall_dt );
+    engine_.updateStatistics( wall_dt, update_nh_, synchronizer_.dropped() );
+}
+
+// Cached transforms are relative to the old fixed frame.
+void WrenchStampedMultiDisplay::fixedFrameChanged()
+{
+    engine_.fixedFrameChanged();
+    Display::fixedFrameChanged();
+}
+
+void WrenchStampedMultiDisplay::updateTopics()
+{
+    if( !context_ )
+    {
+      return;
+    }
+    unsubscribe();
+    topics_.clear();
+    std::string spec = topics_property_->getStdString();
+    size_t pos = 0;
+    while( pos < spec.size() )
+    {
+      size_t end = spec.find_first_of( ", \t", pos );
+      if( end == std::string::npos )
+      {
+        end = spec.size();
+      }
+      if( end > pos )
+      {
+        topics_.push_back( spec.substr( pos, end - pos ));
+      }
+      pos = end + 1;
+    }
+    synchronizer_.setTopics( topics_.size() );
+    reset();
+    if( isEnabled() )
+    {
+      subscribe();
+    }
+}
+
+void WrenchStampedMultiDisplay::updateSynchronization()
+{
+    synchronizer_.setTolerance( tolerance_property_->getFloat() );
+    synchronizer_.setQueueSize( queue_size_property_->getInt() );
+}
+
+void WrenchStampedMultiDisplay::subscribe()
+{
+    if( !isEnabled() || !subscribers_.empty() )
+    {
+      return;
+    }
+    if( topics_.empty() )
+    {
+      setStatus( rviz::StatusProperty::Warn, "Topics", "No topics" );
+      return;
+    }
+    try
+    {
+      // Callbacks come on the main thread, so the synchronizer and the
+      // engine need no locking.
+      for( size_t i = 0; i < topics_.size(); i++ )
+      {
+        subscribers_.push_back( update_nh_.subscribe<geometry_msgs::WrenchStamped>(
+                topics_[i], 10, boost::bind( &WrenchStampedMultiDisplay::processMessage, this, i, _1 )));
+      }
+      setStatus( rviz::StatusProperty::Ok, "Topics", QString( "%1 topics" ).arg( topics_.size() ));
+    }
+    catch( ros::Exception& e )
+    {
+      unsubscribe();
+      setStatus( rviz::StatusProperty::Error, "Topics", QString( "Error subscribing: " ) + e.what() );
+    }
+}
+
+void WrenchStampedMultiDisplay::unsubscribe()
+{
+    for( size_t i = 0; i < subscribers_.size(); i++ )
+    {
+      subscribers_[i].shutdown();
+    }
+    subscribers_.clear();
+}
+
+// This is our callback to handle an incoming message.
+void WrenchStampedMultiDisplay::processMessage( size_t topic, const geometry_msgs::WrenchStamped::ConstPtr& msg )
+{
+  synchronizer_.push( topic, msg );
+  my_rviz_plugin::WrenchStampedArrayPtr set;
+  while(( set = synchronizer_.next() ))
+    {
+      engine_.processMessage( set );
+    }
+}
+
+} // end namespace my_rviz_plugin
+
+// Tell pluginlib about this class.  It is important to do this in
+// global scope, outside our package's namespace.
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( my_rviz_plugin::WrenchStampedMultiDisplay, rviz::Display )
@@ -0,0 +1,76 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_MULTI_DISPLAY_H
+#define MY_RVIZ_PLUGIN_WRENCH_MULTI_DISPLAY_H
+
+#include <vector>
+
+#include <geometry_msgs/WrenchStamped.h>
+#include <rviz/display.h>
+
+#include "wrench_display_engine.h"
+#include "wrench_topic_synchronizer.h"
+
+namespace rviz
+{
+class FloatProperty;
+class IntProperty;
+class StringProperty;
+}
+
+namespace my_rviz_plugin
+{
+
+// Shows several WrenchStamped topics, e.g. one per foot and wrist sensor,
+// as one display. The topics are synchronized by approximate time and
+// every set becomes one history record of a WrenchStampedArray, element i
+// from topic i, so the subscriptions share one history, render path,
+// transform cache and set of properties instead of paying for them once
+// per topic.
+//
+// There is no tf MessageFilter per topic; elements whose transform is not
+// there yet wait in the pending transforms of the engine.
+class WrenchStampedMultiDisplay: public rviz::Display
+{
+    Q_OBJECT
+public:
+    // Constructor.  pluginlib::ClassLoader creates instances by calling
+    // the default constructor, so make sure you have one.
+    WrenchStampedMultiDisplay();
+    virtual ~WrenchStampedMultiDisplay();
+
+protected:
+    // Overrides of public virtual functions from the Display class.
+    virtual void onInitialize();
+    virtual void onEnable();
+    virtual void onDisable();
+    virtual void reset();
+    virtual void update( float wall_dt, float ros_dt );
+    virtual void fixedFrameChanged();
+
+private Q_SLOTS:
+    void updateTopics();
+    void updateSynchronization();
+
+private:
+  void subscribe();
+  void unsubscribe();
+
+  // Function to handle an incoming ROS message of the topic-th topic.
+  void processMessage( size_t topic, const geometry_msgs::WrenchStamped::ConstPtr& msg );
+
+  // History, rendering and the properties shared with the other wrench
+  // displays. A synchronized set is a history record of one element per topic.
+  WrenchDisplayEngine<WrenchStampedArrayElements> engine_;
+
+  WrenchTopicSynchronizer synchronizer_;
+  std::vector<std::string> topics_;
+  std::vector<ros::Subscriber> subscribers_;
+
+  // Property objects for user-editable properties.
+  rviz::StringProperty *topics_property_;
+  rviz::FloatProperty *tolerance_property_;
+  rviz::IntProperty *queue_size_property_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_MULTI_DISPLAY_H
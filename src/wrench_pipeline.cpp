@@ -0,0 +1,140 @@
+#include "wrench_pipeline.h"
+
+namespace my_rviz_plugin
+{
+
+WrenchPipeline::WrenchPipeline( TransformSource* source, size_t capacity, EventTrace* trace )
+  : source_( source )
+  , capacity_( capacity )
+  , trace_( trace )
+  , input_( capacity )
+  , output_( capacity )
+  , free_( capacity )
+  , invalidate_( false )
+  , cull_changed_( false )
+  , dropped_( 0 )
+  , tf_hits_( 0 )
+  , tf_misses_( 0 )
+  , running_( true )
+{
+  batches_.reserve( capacity_ );
+  thread_ = boost::thread( &WrenchPipeline::run, this );
+}
+
+WrenchPipeline::~WrenchPipeline()
+{
+  {
+    boost::mutex::scoped_lock lock( mutex_ );
+    running_ = false;
+  }
+  wakeup_.notify_all();
+  thread_.join();
+  for( size_t i = 0; i < batches_.size(); i++ )
+  {
+    delete batches_[i];
+  }
+}
+
+void WrenchPipeline::push( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+{
+  if( !input_.push( msg ))
+  {
+    dropped_++;
+    if( trace_ )
+    {
+      trace_->instant( "pipeline drop" );
+    }
+    return;
+  }
+  boost::mutex::scoped_lock lock( mutex_ );
+  wakeup_.notify_one();
+}
+
+WrenchRecordBatch* WrenchPipeline::pop()
+{
+  WrenchRecordBatch* batch;
+  if( output_.pop( batch ))
+  {
+    return batch;
+  }
+  return NULL;
+}
+
+void WrenchPipeline::recycle( WrenchRecordBatch* batch )
+{
+  free_.push( batch );
+}
+
+void WrenchPipeline::invalidateTransforms()
+{
+  invalidate_ = true;
+}
+
+void WrenchPipeline::setCullFilter( const WrenchCullFilter& cull )
+{
+  boost::mutex::scoped_lock lock( cull_mutex_ );
+  cull_ = cull;
+  cull_changed_ = true;
+}
+
+size_t WrenchPipeline::depth() const
+{
+  return ( capacity_ - input_.write_available() ) + output_.read_available();
+}
+
+void WrenchPipeline::run()
+{
+  while( true )
+  {
+    {
+      boost::mutex::scoped_lock lock( mutex_ );
+      while( running_ && !input_.read_available() )
+      {
+        wakeup_.wait( lock );
+      }
+      if( !running_ )
+      {
+        return;
+      }
+    }
+
+    my_rviz_plugin::WrenchStampedArray::ConstPtr msg;
+    input_.pop( msg );
+
+    if( invalidate_.exchange( false ))
+    {
+      tf_cache_.clear();
+    }
+    if( cull_changed_.exchange( false ))
+    {
+      boost::mutex::scoped_lock lock( cull_mutex_ );
+      worker_cull_ = cull_;
+    }
+
+    // There are never more batches than output_ can hold.
+    WrenchRecordBatch* batch = NULL;
+    if( !free_.pop( batch ))
+    {
+      if( batches_.size() >= capacity_ )
+      {
+        dropped_++;
+        if( trace_ )
+        {
+          trace_->instant( "pipeline drop" );
+        }
+        continue;
+      }
+      batch = new WrenchRecordBatch();
+      batches_.push_back( batch );
+    }
+
+    TraceScope scope( trace_, "resolve", msg->wrenchstampeds.size() );
+    tf_cache_.beginMessage();
+    resolveElements( WrenchStampedArrayElements( *msg ), worker_cull_, *source_, tf_cache_, *batch, trace_ );
+    tf_hits_ = tf_cache_.hits();
+    tf_misses_ = tf_cache_.misses();
+    output_.push( batch );
+  }
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,96 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_PIPELINE_H
+#define MY_RVIZ_PLUGIN_WRENCH_PIPELINE_H
+
+#include <vector>
+#include <atomic>
+
+#ifndef Q_MOC_RUN
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include <my_rviz_plugin/WrenchStampedArray.h>
+
+#include "transform_source.h"
+#include "transform_cache.h"
+#include "wrench_cull_filter.h"
+#include "wrench_elements.h"
+#include "event_trace.h"
+
+namespace my_rviz_plugin
+{
+
+// Resolves the elements of a WrenchStampedArray off the render thread.
+//
+// The main thread push()es messages and pop()s the resulting batches in
+// Display::update(). Both directions go through bounded single-producer
+// single-consumer lock-free queues; batches are recycled so that the
+// worker does not allocate in steady state. A message is dropped when the
+// input queue is full or when no batch is free.
+class WrenchPipeline
+{
+public:
+  // source is used from the worker thread and must outlive the pipeline,
+  // as must trace, which may be NULL.
+  WrenchPipeline( TransformSource* source, size_t capacity, EventTrace* trace = NULL );
+  ~WrenchPipeline();
+
+  // Main thread: hands a message to the worker.
+  void push( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg );
+
+  // Main thread: returns the next resolved batch or NULL. The batch must
+  // be given back with recycle() once applied.
+  WrenchRecordBatch* pop();
+  void recycle( WrenchRecordBatch* batch );
+
+  // Main thread: forgets cached transforms before the next message, e.g.
+  // when the fixed frame changed.
+  void invalidateTransforms();
+
+  // Main thread: the worker uses a copy of cull from the next message on.
+  void setCullFilter( const WrenchCullFilter& cull );
+
+  // Messages waiting for the worker plus batches waiting for the main thread.
+  size_t depth() const;
+  size_t dropped() const { return dropped_; }
+  size_t tfHits() const { return tf_hits_; }
+  size_t tfMisses() const { return tf_misses_; }
+
+private:
+  void run();
+
+  TransformSource* source_;
+  size_t capacity_;
+  EventTrace* trace_;
+
+  boost::lockfree::spsc_queue<my_rviz_plugin::WrenchStampedArray::ConstPtr> input_;
+  boost::lockfree::spsc_queue<WrenchRecordBatch*> output_;
+  boost::lockfree::spsc_queue<WrenchRecordBatch*> free_;
+
+  // Every batch ever created; only touched by the worker.
+  std::vector<WrenchRecordBatch*> batches_;
+
+  TransformCache tf_cache_;
+  std::atomic<bool> invalidate_;
+
+  // Written by the main thread under cull_mutex_, copied by the worker.
+  WrenchCullFilter cull_;
+  WrenchCullFilter worker_cull_;
+  std::atomic<bool> cull_changed_;
+  boost::mutex cull_mutex_;
+  std::atomic<size_t> dropped_;
+  std::atomic<size_t> tf_hits_;
+  std::atomic<size_t> tf_misses_;
+
+  boost::mutex mutex_;
+  boost::condition_variable wakeup_;
+  bool running_;
+  boost::thread thread_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_PIPELINE_H
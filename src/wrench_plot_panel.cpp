@@ -0,0 +1,274 @@
+#include <algorithm>
+
+#include <QPainter>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QTimer>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+#include <boost/bind.hpp>
+
+#include "wrench_plot_panel.h"
+
+namespace my_rviz_plugin
+{
+
+const int WrenchPlotPanel::REDRAW_RATE;
+const size_t WrenchPlotPanel::SAMPLES;
+
+namespace
+{
+
+// x, y and z are drawn in the colors of the rviz axes.
+const QColor CHANNEL_COLORS[3] = { QColor( 230, 40, 40 ), QColor( 40, 180, 40 ), QColor( 40, 80, 230 ) };
+
+}
+
+WrenchPlotWidget::WrenchPlotWidget( QWidget* parent )
+  : QWidget( parent )
+  , series_( NULL )
+  , duration_( 10.0 )
+{
+  setMinimumSize( 200, 160 );
+  setSizePolicy( QSizePolicy::Expanding, QSizePolicy::Expanding );
+}
+
+void WrenchPlotWidget::setSeries( const WrenchSeries* series )
+{
+  series_ = series;
+  envelope_.invalidate();
+  update();
+}
+
+void WrenchPlotWidget::setDuration( double duration )
+{
+  duration_ = duration;
+  update();
+}
+
+void WrenchPlotWidget::paintEvent( QPaintEvent* )
+{
+  QPainter painter( this );
+  painter.fillRect( rect(), Qt::white );
+  if( !series_ )
+    {
+      painter.drawText( rect(), Qt::AlignCenter, "No data" );
+      return;
+    }
+
+  envelope_.update( *series_, duration_, width() );
+
+  int half = height() / 2;
+  drawChannels( painter, QRect( 0, 0, width(), half ), 0, "Force" );
+  drawChannels( painter, QRect( 0, half, width(), height() - half ), 3, "Torque" );
+}
+
+void WrenchPlotWidget::drawChannels( QPainter& painter, const QRect& area, int first, const QString& label )
+{
+  painter.setPen( Qt::lightGray );
+  painter.drawRect( area.adjusted( 0, 0, -1, -1 ));
+
+  float min, max;
+  if( !envelope_.bounds( first, first + 3, min, max ))
+    {
+      painter.setPen( Qt::black );
+      painter.drawText( area.adjusted( 4, 2, 0, 0 ), Qt::AlignLeft | Qt::AlignTop, label );
+      return;
+    }
+  float margin = std::max( 0.05f * ( max - min ), 1e-3f );
+  min -= margin;
+  max += margin;
+  double scale = ( area.height() - 1 ) / ( max - min );
+
+  // Zero line.
+  if( min < 0 && max > 0 )
+    {
+      int y = area.bottom() - (int)(( 0 - min ) * scale );
+      painter.setPen( QPen( Qt::gray, 0, Qt::DashLine ));
+      painter.drawLine( area.left(), y, area.right(), y );
+    }
+
+  for( int channel = first; channel < first + 3; channel++ )
+    {
+      lines_.clear();
+      bool previous = false;
+      float previous_min = 0, previous_max = 0;
+      for( int c = 0; c < envelope_.width(); c++ )
+        {
+          float lo, hi;
+          if( !envelope_.column( c, channel, lo, hi ))
+            {
+              previous = false;
+              continue;
+            }
+          // Also cover the step from the previous column, so that the
+          // envelope stays connected.
+          float from = previous ? std::min( lo, previous_max ) : lo;
+          float to = previous ? std::max( hi, previous_min ) : hi;
+          lines_.push_back( QLine( area.left() + c, area.bottom() - (int)(( from - min ) * scale ),
+                                   area.left() + c, area.bottom() - (int)(( to - min ) * scale )));
+          previous = true;
+          previous_min = lo;
+          previous_max = hi;
+        }
+      painter.setPen( CHANNEL_COLORS[channel - first] );
+      painter.drawLines( lines_ );
+    }
+
+  painter.setPen( Qt::black );
+  painter.drawText( area.adjusted( 4, 2, 0, 0 ), Qt::AlignLeft | Qt::AlignTop,
+                    QString( "%1 [%2, %3]" ).arg( label ).arg( min, 0, 'g', 3 ).arg( max, 0, 'g', 3 ));
+}
+
+WrenchPlotPanel::WrenchPlotPanel( QWidget* parent )
+  : rviz::Panel( parent )
+  , dirty_( false )
+{
+  QHBoxLayout* controls = new QHBoxLayout;
+  controls->addWidget( new QLabel( "Topic:" ));
+  topic_editor_ = new QLineEdit;
+  controls->addWidget( topic_editor_ );
+  controls->addWidget( new QLabel( "Element:" ));
+  element_editor_ = new QSpinBox;
+  element_editor_->setRange( 0, 9999 );
+  controls->addWidget( element_editor_ );
+  controls->addWidget( new QLabel( "Window [s]:" ));
+  duration_editor_ = new QDoubleSpinBox;
+  duration_editor_->setRange( 0.1, 30.0 );
+  duration_editor_->setValue( 10.0 );
+  controls->addWidget( duration_editor_ );
+
+  plot_ = new WrenchPlotWidget;
+  info_label_ = new QLabel;
+
+  QVBoxLayout* layout = new QVBoxLayout;
+  layout->addLayout( controls );
+  layout->addWidget( plot_ );
+  layout->addWidget( info_label_ );
+  setLayout( layout );
+
+  redraw_timer_ = new QTimer( this );
+  connect( redraw_timer_, SIGNAL( timeout() ), this, SLOT( redraw() ));
+  connect( topic_editor_, SIGNAL( editingFinished() ), this, SLOT( updateTopic() ));
+  connect( element_editor_, SIGNAL( valueChanged( int )), this, SLOT( updateElement() ));
+  connect( duration_editor_, SIGNAL( valueChanged( double )), this, SLOT( updateDuration() ));
+  redraw_timer_->start( 1000 / REDRAW_RATE );
+}
+
+void WrenchPlotPanel::updateTopic()
+{
+  setTopic( topic_editor_->text() );
+}
+
+void WrenchPlotPanel::setTopic( const QString& topic )
+{
+  if( topic == topic_ )
+    {
+      return;
+    }
+  topic_ = topic;
+  topic_editor_->setText( topic );
+
+  subscriber_.shutdown();
+  plot_->setSeries( NULL );
+  series_.clear();
+  if( !topic_.isEmpty() )
+    {
+      // Panels get their callbacks on the main thread, like displays.
+      subscriber_ = nh_.subscribe<my_rviz_plugin::WrenchStampedArray>(
+              topic_.toStdString(), 100, boost::bind( &WrenchPlotPanel::processMessage, this, _1 ));
+    }
+  Q_EMIT configChanged();
+}
+
+void WrenchPlotPanel::updateElement()
+{
+  size_t element = element_editor_->value();
+  plot_->setSeries( element < series_.size() ? series_[element].get() : NULL );
+  Q_EMIT configChanged();
+}
+
+void WrenchPlotPanel::updateDuration()
+{
+  plot_->setDuration( duration_editor_->value() );
+  Q_EMIT configChanged();
+}
+
+void WrenchPlotPanel::processMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg )
+{
+  size_t size = msg->wrenchstampeds.size();
+  if( size > series_.size() )
+    {
+      size_t old_size = series_.size();
+      series_.resize( size );
+      for( size_t i = old_size; i < size; i++ )
+        {
+          series_[i].reset( new WrenchSeries( SAMPLES ));
+        }
+      updateElement();
+    }
+
+  for( size_t i = 0; i < size; i++ )
+    {
+      const geometry_msgs::WrenchStamped& wrench = msg->wrenchstampeds[i];
+      const ros::Time& stamp = wrench.header.stamp.isZero() ? msg->header.stamp : wrench.header.stamp;
+      float values[WrenchSeries::CHANNELS] = {
+        (float)wrench.wrench.force.x, (float)wrench.wrench.force.y, (float)wrench.wrench.force.z,
+        (float)wrench.wrench.torque.x, (float)wrench.wrench.torque.y, (float)wrench.wrench.torque.z };
+      series_[i]->push( stamp.toSec(), values );
+    }
+  dirty_ = true;
+}
+
+void WrenchPlotPanel::redraw()
+{
+  if( !dirty_ )
+    {
+      return;
+    }
+  dirty_ = false;
+  plot_->update();
+
+  size_t memory = 0;
+  for( size_t i = 0; i < series_.size(); i++ )
+    {
+      memory += series_[i]->memoryUsage();
+    }
+  info_label_->setText( QString( "%1 elements, %2 MB" ).arg( series_.size() ).arg( memory / 1e6, 0, 'f', 1 ));
+}
+
+void WrenchPlotPanel::save( rviz::Config config ) const
+{
+  rviz::Panel::save( config );
+  config.mapSetValue( "Topic", topic_ );
+  config.mapSetValue( "Element", element_editor_->value() );
+  config.mapSetValue( "Window", duration_editor_->value() );
+}
+
+void WrenchPlotPanel::load( const rviz::Config& config )
+{
+  rviz::Panel::load( config );
+  int element;
+  if( config.mapGetInt( "Element", &element ))
+    {
+      element_editor_->setValue( element );
+    }
+  float duration;
+  if( config.mapGetFloat( "Window", &duration ))
+    {
+      duration_editor_->setValue( duration );
+    }
+  QString topic;
+  if( config.mapGetString( "Topic", &topic ))
+    {
+      setTopic( topic );
+    }
+}
+
+} // end namespace my_rviz_plugin
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( my_rviz_plugin::WrenchPlotPanel, rviz::Panel )
@@ -0,0 +1,106 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_PLOT_PANEL_H
+#define MY_RVIZ_PLUGIN_WRENCH_PLOT_PANEL_H
+
+#ifndef Q_MOC_RUN
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <ros/ros.h>
+#include <my_rviz_plugin/WrenchStampedArray.h>
+#endif
+
+#include <QWidget>
+#include <QVector>
+#include <QLine>
+#include <rviz/panel.h>
+
+#include "wrench_plot_series.h"
+
+class QLineEdit;
+class QSpinBox;
+class QDoubleSpinBox;
+class QLabel;
+class QTimer;
+
+namespace my_rviz_plugin
+{
+
+// Draws the force (top) and torque (bottom) components of one
+// WrenchSeries over the last duration seconds. Each pixel column is drawn
+// as a vertical line from the minimum to the maximum of the samples that
+// fall into it, so no sample is hidden and the cost depends on the width
+// only.
+class WrenchPlotWidget: public QWidget
+{
+    Q_OBJECT
+public:
+    WrenchPlotWidget( QWidget* parent = 0 );
+
+    // series may be NULL and must outlive the widget or be replaced first.
+    void setSeries( const WrenchSeries* series );
+    void setDuration( double duration );
+
+protected:
+    virtual void paintEvent( QPaintEvent* event );
+
+private:
+    // Draws the channels [first, first + 3) into area.
+    void drawChannels( QPainter& painter, const QRect& area, int first, const QString& label );
+
+    const WrenchSeries* series_;
+    double duration_;
+    // Kept between paints, so only the columns of new samples are computed.
+    WrenchEnvelope envelope_;
+    QVector<QLine> lines_;
+};
+
+// Plots the force and torque history of one element of a
+// WrenchStampedArray topic.
+//
+// Every element of the topic has its own ring buffer of samples with a
+// min/max pyramid, so the element shown can be switched without losing
+// history. Messages are recorded as they arrive; the plot is redrawn at
+// most REDRAW_RATE times a second and only if new samples arrived.
+class WrenchPlotPanel: public rviz::Panel
+{
+    Q_OBJECT
+public:
+    static const int REDRAW_RATE = 30;
+    // Samples kept per element, about 32 seconds at 1 kHz.
+    static const size_t SAMPLES = 32768;
+
+    WrenchPlotPanel( QWidget* parent = 0 );
+
+    virtual void load( const rviz::Config& config );
+    virtual void save( rviz::Config config ) const;
+
+public Q_SLOTS:
+    void setTopic( const QString& topic );
+
+protected Q_SLOTS:
+    void updateTopic();
+    void updateElement();
+    void updateDuration();
+    void redraw();
+
+private:
+    void processMessage( const my_rviz_plugin::WrenchStampedArray::ConstPtr& msg );
+
+    ros::NodeHandle nh_;
+    ros::Subscriber subscriber_;
+    QString topic_;
+
+    QLineEdit* topic_editor_;
+    QSpinBox* element_editor_;
+    QDoubleSpinBox* duration_editor_;
+    QLabel* info_label_;
+    WrenchPlotWidget* plot_;
+    QTimer* redraw_timer_;
+
+    // One series per element index of the topic.
+    std::vector<boost::shared_ptr<WrenchSeries> > series_;
+    bool dirty_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_PLOT_PANEL_H
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "wrench_plot_series.h"
+
+namespace my_rviz_plugin
+{
+
+const size_t MinMaxPyramid::BASE;
+const int WrenchSeries::CHANNELS;
+
+MinMaxPyramid::MinMaxPyramid( size_t capacity )
+  : capacity_( 2 * BASE )
+  , end_( 0 )
+{
+  while( capacity_ < capacity )
+  {
+    capacity_ *= 2;
+  }
+  values_.resize( capacity_ );
+  for( size_t block = BASE; block <= capacity_; block *= 2 )
+  {
+    levels_.push_back( std::vector<float>( 2 * ( capacity_ / block )));
+  }
+}
+
+void MinMaxPyramid::push( float value )
+{
+  values_[end_ & ( capacity_ - 1 )] = value;
+  for( size_t k = 0; k < levels_.size(); k++ )
+  {
+    size_t block = BASE << k;
+    std::vector<float>& level = levels_[k];
+    size_t i = 2 * (( end_ / block ) & ( level.size() / 2 - 1 ));
+    if( end_ % block == 0 )
+    {
+      level[i] = value;
+      level[i + 1] = value;
+    }
+    else
+    {
+      level[i] = std::min( level[i], value );
+      level[i + 1] = std::max( level[i + 1], value );
+    }
+  }
+  end_++;
+}
+
+void MinMaxPyramid::clear()
+{
+  end_ = 0;
+}
+
+void MinMaxPyramid::range( uint64_t first, uint64_t last, float& min, float& max ) const
+{
+  min = std::numeric_limits<float>::infinity();
+  max = -std::numeric_limits<float>::infinity();
+
+  // Raw samples up to the first block boundary.
+  for( ; first < last && first % BASE; first++ )
+  {
+    min = std::min( min, value( first ));
+    max = std::max( max, value( first ));
+  }
+
+  // The largest aligned blocks that fit.
+  while( last - first >= BASE )
+  {
+    size_t k = 0;
+    while( k + 1 < levels_.size() && first % ( BASE << ( k + 1 )) == 0 &&
+           first + ( BASE << ( k + 1 )) <= last )
+    {
+      k++;
+    }
+    const std::vector<float>& level = levels_[k];
+    size_t i = 2 * (( first / ( BASE << k )) & ( level.size() / 2 - 1 ));
+    min = std::min( min, level[i] );
+    max = std::max( max, level[i + 1] );
+    first += BASE << k;
+  }
+
+  // Raw samples after the last block.
+  for( ; first < last; first++ )
+  {
+    min = std::min( min, value( first ));
+    max = std::max( max, value( first ));
+  }
+}
+
+size_t MinMaxPyramid::memoryUsage() const
+{
+  size_t bytes = values_.capacity() * sizeof( float );
+  for( size_t k = 0; k < levels_.size(); k++ )
+  {
+    bytes += levels_[k].capacity() * sizeof( float );
+  }
+  return bytes;
+}
+
+WrenchSeries::WrenchSeries( size_t capacity )
+  : channels_( CHANNELS, MinMaxPyramid( capacity ))
+  , epoch_( 0 )
+{
+  stamps_.resize( channels_[0].capacity() );
+}
+
+void WrenchSeries::push( double stamp, const float* values )
+{
+  if( !empty() )
+  {
+    double last = this->stamp( end() - 1 );
+    if( stamp < last - 1.0 )
+    {
+      clear();
+    }
+    else
+    {
+      stamp = std::max( stamp, last );
+    }
+  }
+  stamps_[end() & ( stamps_.size() - 1 )] = stamp;
+  for( int i = 0; i < CHANNELS; i++ )
+  {
+    channels_[i].push( values[i] );
+  }
+}
+
+void WrenchSeries::clear()
+{
+  for( int i = 0; i < CHANNELS; i++ )
+  {
+    channels_[i].clear();
+  }
+  epoch_++;
+}
+
+uint64_t WrenchSeries::lowerBound( double t ) const
+{
+  uint64_t first = begin();
+  uint64_t count = end() - first;
+  while( count > 0 )
+  {
+    uint64_t half = count / 2;
+    if( stamp( first + half ) < t )
+    {
+      first += half + 1;
+      count -= half + 1;
+    }
+    else
+    {
+      count = half;
+    }
+  }
+  return first;
+}
+
+size_t WrenchSeries::memoryUsage() const
+{
+  size_t bytes = stamps_.capacity() * sizeof( double );
+  for( int i = 0; i < CHANNELS; i++ )
+  {
+    bytes += channels_[i].memoryUsage();
+  }
+  return bytes;
+}
+
+WrenchEnvelope::WrenchEnvelope()
+  : width_( 0 )
+  , column_( 0 )
+  , end_index_( 0 )
+  , filled_( 0 )
+  , series_( NULL )
+  , epoch_( 0 )
+  , computed_( 0 )
+{
+}
+
+void WrenchEnvelope::update( const WrenchSeries& series, double duration, int width )
+{
+  computed_ = 0;
+  if( width <= 0 || duration <= 0 )
+  {
+    width_ = 0;
+    series_ = NULL;
+    return;
+  }
+
+  double column = duration / width;
+  int64_t end_index = series.empty() ? end_index_ : (int64_t)std::floor( series.stamp( series.end() - 1 ) / column ) + 1;
+  bool rebuild = width != width_ || column != column_ || &series != series_ || series.epoch() != epoch_ ||
+                 end_index < end_index_ || filled_ <= series.begin() || end_index - end_index_ >= width;
+
+  // Columns up to the one holding the last sample of the previous update
+  // are complete, since stamps never decrease.
+  int first = 0;
+  if( !rebuild )
+  {
+    int shift = end_index - end_index_;
+    if( shift > 0 )
+    {
+      size_t stride = 2 * WrenchSeries::CHANNELS;
+      std::memmove( &columns_[0], &columns_[shift * stride], ( width - shift ) * stride * sizeof( float ));
+      std::memmove( &valid_[0], &valid_[shift * WrenchSeries::CHANNELS],
+                    ( width - shift ) * WrenchSeries::CHANNELS );
+    }
+    double begin = ( end_index - width ) * column;
+    first = std::max( 0, (int)std::floor(( series.stamp( filled_ - 1 ) - begin ) / column ));
+  }
+
+  width_ = width;
+  column_ = column;
+  end_index_ = end_index;
+  series_ = &series;
+  epoch_ = series.epoch();
+  filled_ = series.end();
+  columns_.resize( 2 * width * WrenchSeries::CHANNELS );
+  valid_.resize( width * WrenchSeries::CHANNELS );
+  compute( series, first );
+}
+
+void WrenchEnvelope::compute( const WrenchSeries& series, int first )
+{
+  uint64_t a = series.lowerBound(( end_index_ - width_ + first ) * column_ );
+  for( int c = first; c < width_; c++ )
+  {
+    uint64_t b = series.lowerBound(( end_index_ - width_ + c + 1 ) * column_ );
+    for( int i = 0; i < WrenchSeries::CHANNELS; i++ )
+    {
+      size_t j = c * WrenchSeries::CHANNELS + i;
+      valid_[j] = a < b;
+      if( a < b )
+      {
+        series.channel( i ).range( a, b, columns_[2 * j], columns_[2 * j + 1] );
+      }
+    }
+    a = b;
+  }
+  computed_ = width_ - first;
+}
+
+bool WrenchEnvelope::bounds( int first, int last, float& min, float& max ) const
+{
+  min = std::numeric_limits<float>::infinity();
+  max = -std::numeric_limits<float>::infinity();
+  bool found = false;
+  for( int c = 0; c < width_; c++ )
+  {
+    for( int i = first; i < last; i++ )
+    {
+      float lo, hi;
+      if( column( c, i, lo, hi ))
+      {
+        min = std::min( min, lo );
+        max = std::max( max, hi );
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,142 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_PLOT_SERIES_H
+#define MY_RVIZ_PLUGIN_WRENCH_PLOT_SERIES_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace my_rviz_plugin
+{
+
+// Ring buffer of the samples of one channel with a min/max pyramid on top.
+//
+// Samples are addressed by their sequence number, counted from the first
+// push. Level k of the pyramid holds the minimum and maximum of the
+// aligned blocks of BASE << k samples, so the extrema of any range of
+// samples are found from O(log n) blocks and at most 2 * BASE raw samples.
+// Blocks are updated as samples arrive, also the one still being filled.
+class MinMaxPyramid
+{
+public:
+  // Smallest block size of the pyramid. Smaller blocks would cost more
+  // memory than they save time.
+  static const size_t BASE = 8;
+
+  // capacity is rounded up to a power of two of at least 2 * BASE.
+  explicit MinMaxPyramid( size_t capacity );
+
+  void push( float value );
+  void clear();
+
+  // Sequence numbers of the samples still held are [begin(), end()).
+  uint64_t begin() const { return end_ > capacity_ ? end_ - capacity_ : 0; }
+  uint64_t end() const { return end_; }
+  size_t capacity() const { return capacity_; }
+
+  float value( uint64_t seq ) const { return values_[seq & ( capacity_ - 1 )]; }
+
+  // Extrema of the samples [first, last). The range must be non-empty and
+  // held by the buffer.
+  void range( uint64_t first, uint64_t last, float& min, float& max ) const;
+
+  size_t memoryUsage() const;
+
+private:
+  size_t capacity_;
+  uint64_t end_;
+  std::vector<float> values_;
+  // levels_[k] holds capacity_ / ( BASE << k ) blocks as min, max pairs.
+  std::vector<std::vector<float> > levels_;
+};
+
+// Time series of the six force and torque components of one wrench.
+// The channels share their stamps, which never decrease.
+class WrenchSeries
+{
+public:
+  static const int CHANNELS = 6;
+
+  explicit WrenchSeries( size_t capacity );
+
+  // values are fx, fy, fz, tx, ty, tz. A stamp slightly older than the
+  // last one is moved forward to it; one more than a second older, as
+  // when a bag loops, clears the series first.
+  void push( double stamp, const float* values );
+  void clear();
+
+  bool empty() const { return begin() == end(); }
+  uint64_t begin() const { return channels_[0].begin(); }
+  uint64_t end() const { return channels_[0].end(); }
+  double stamp( uint64_t seq ) const { return stamps_[seq & ( stamps_.size() - 1 )]; }
+
+  // Sequence number of the first held sample stamped at or after t.
+  uint64_t lowerBound( double t ) const;
+
+  const MinMaxPyramid& channel( int i ) const { return channels_[i]; }
+
+  // Incremented by clear(), so that cached envelopes are rebuilt.
+  unsigned long epoch() const { return epoch_; }
+
+  size_t memoryUsage() const;
+
+private:
+  std::vector<MinMaxPyramid> channels_;
+  std::vector<double> stamps_;
+  unsigned long epoch_;
+};
+
+// Per pixel column extrema of a WrenchSeries over a scrolling time window.
+//
+// Columns are aligned to multiples of the column duration, so when the
+// window scrolls the known columns are shifted and only the new ones, and
+// the one that was still being filled, are computed. The cost of an
+// update thus depends on the number of new columns, not on the number of
+// samples.
+class WrenchEnvelope
+{
+public:
+  WrenchEnvelope();
+
+  // Brings the columns up to date for a window of duration seconds,
+  // width columns wide, ending just after the last sample of series.
+  void update( const WrenchSeries& series, double duration, int width );
+  void invalidate() { series_ = NULL; }
+
+  int width() const { return width_; }
+  // Start and end time of the window.
+  double begin() const { return ( end_index_ - width_ ) * column_; }
+  double end() const { return end_index_ * column_; }
+
+  // Extrema of channel in column c; false if the column has no samples.
+  bool column( int c, int channel, float& min, float& max ) const
+  {
+    size_t i = c * WrenchSeries::CHANNELS + channel;
+    min = columns_[2 * i];
+    max = columns_[2 * i + 1];
+    return valid_[i];
+  }
+
+  // Extrema over all columns of the channels [first, last).
+  bool bounds( int first, int last, float& min, float& max ) const;
+
+  // Number of columns computed by the last update().
+  int computed() const { return computed_; }
+
+private:
+  void compute( const WrenchSeries& series, int first );
+
+  int width_;
+  double column_;
+  int64_t end_index_;
+  uint64_t filled_;
+  const WrenchSeries* series_;
+  unsigned long epoch_;
+  int computed_;
+  // min, max pairs of ( c * CHANNELS + channel ).
+  std::vector<float> columns_;
+  std::vector<uint8_t> valid_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_PLOT_SERIES_H
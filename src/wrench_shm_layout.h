@@ -0,0 +1,111 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_SHM_LAYOUT_H
+#define MY_RVIZ_PLUGIN_WRENCH_SHM_LAYOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+namespace my_rviz_plugin
+{
+
+// Layout of a shared-memory segment through which a process on the same
+// host streams wrench arrays to WrenchStampedArrayDisplay without ROS
+// serialization.
+//
+//   [Header][slot 0][slot 1]...[slot slots-1]
+//   slot: [Slot][frame indices: uint16 x max_elements]
+//         [fx][fy][fz][tx][ty][tz]: float x max_elements each
+//
+// There is a single writer. Message k is written to slot k % slots. Each
+// slot is a seqlock: its sequence is odd while the writer fills it and
+// 2 * (k + 1) once message k is complete, so a reader can tell a torn or
+// overwritten slot from a valid one after copying it.
+//
+// A writer that restarts replaces the segment; readers keep the old one
+// mapped. The old writer sets closed when it goes away, and the writer
+// pid tells a reader that one has died, so that readers only look for a
+// new segment when theirs is dead.
+namespace wrench_shm
+{
+
+const uint32_t MAGIC = 0x57524e43; // "WRNC"
+const uint32_t VERSION = 2;
+const size_t MAX_FRAMES = 256;
+const size_t FRAME_ID_SIZE = 64;
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "shared-memory transport needs lock-free 64 bit atomics"
+#endif
+
+struct Header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t max_elements;
+  uint32_t writer_pid;
+  // Set once the writer is gone.
+  std::atomic<uint32_t> closed;
+  // Number of messages written so far.
+  std::atomic<uint64_t> written;
+  // Frames registered so far. The table is append only.
+  std::atomic<uint32_t> frame_count;
+  char frame_ids[MAX_FRAMES][FRAME_ID_SIZE];
+};
+
+struct Slot
+{
+  std::atomic<uint64_t> sequence;
+  uint32_t stamp_sec;
+  uint32_t stamp_nsec;
+  uint32_t count;
+};
+
+inline size_t alignUp( size_t n, size_t alignment )
+{
+  return ( n + alignment - 1 ) / alignment * alignment;
+}
+
+inline size_t indicesOffset()
+{
+  return alignUp( sizeof( Slot ), sizeof( float ));
+}
+
+inline size_t componentOffset( size_t max_elements, int component )
+{
+  return alignUp( indicesOffset() + max_elements * sizeof( uint16_t ), sizeof( float )) +
+         component * max_elements * sizeof( float );
+}
+
+inline size_t slotSize( size_t max_elements )
+{
+  return alignUp( componentOffset( max_elements, 6 ), 64 );
+}
+
+inline size_t segmentSize( size_t slots, size_t max_elements )
+{
+  return alignUp( sizeof( Header ), 64 ) + slots * slotSize( max_elements );
+}
+
+inline Slot* slotAt( Header* header, size_t index )
+{
+  return reinterpret_cast<Slot*>( reinterpret_cast<char*>( header ) + alignUp( sizeof( Header ), 64 ) +
+                                  index * slotSize( header->max_elements ));
+}
+
+inline uint16_t* frameIndices( Slot* slot )
+{
+  return reinterpret_cast<uint16_t*>( reinterpret_cast<char*>( slot ) + indicesOffset() );
+}
+
+// component 0-2 are force x, y, z and 3-5 torque x, y, z.
+inline float* component( Slot* slot, size_t max_elements, int component )
+{
+  return reinterpret_cast<float*>( reinterpret_cast<char*>( slot ) + componentOffset( max_elements, component ));
+}
+
+} // end namespace wrench_shm
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_SHM_LAYOUT_H
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <signal.h>
+
+#include "wrench_shm_reader.h"
+
+namespace my_rviz_plugin
+{
+
+namespace ipc = boost::interprocess;
+
+WrenchShmReader::WrenchShmReader()
+  : header_( NULL )
+  , next_( 0 )
+  , overruns_( 0 )
+  , skipped_( 0 )
+{
+}
+
+bool WrenchShmReader::open( const std::string& name )
+{
+  close();
+  try
+  {
+    ipc::shared_memory_object shm( ipc::open_only, name.c_str(), ipc::read_only );
+    ipc::mapped_region region( shm, ipc::read_only );
+    if( region.get_size() < sizeof( wrench_shm::Header ))
+    {
+      return false;
+    }
+    wrench_shm::Header* header = static_cast<wrench_shm::Header*>( region.get_address() );
+    if( header->magic != wrench_shm::MAGIC )
+    {
+      return false;
+    }
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if( header->version != wrench_shm::VERSION || header->slots == 0 ||
+        region.get_size() < wrench_shm::segmentSize( header->slots, header->max_elements ))
+    {
+      return false;
+    }
+    shm_.swap( shm );
+    region_.swap( region );
+    header_ = header;
+  }
+  catch( const ipc::interprocess_exception& )
+  {
+    return false;
+  }
+  next_ = header_->written.load( std::memory_order_acquire );
+  return true;
+}
+
+void WrenchShmReader::close()
+{
+  header_ = NULL;
+  ipc::mapped_region().swap( region_ );
+  ipc::shared_memory_object().swap( shm_ );
+  frame_ids_.clear();
+}
+
+bool WrenchShmReader::stale() const
+{
+  if( !header_ )
+  {
+    return true;
+  }
+  return header_->closed.load( std::memory_order_acquire ) != 0 ||
+         ( kill( header_->writer_pid, 0 ) != 0 && errno == ESRCH );
+}
+
+void WrenchShmReader::skip( size_t keep )
+{
+  if( !header_ )
+  {
+    return;
+  }
+  uint64_t written = header_->written.load( std::memory_order_acquire );
+  if( written > next_ + keep )
+  {
+    skipped_ += written - keep - next_;
+    next_ = written - keep;
+  }
+}
+
+bool WrenchShmReader::read( WrenchShmMessage& msg )
+{
+  if( !header_ )
+  {
+    return false;
+  }
+  size_t slots = header_->slots;
+  size_t max_elements = header_->max_elements;
+  while( true )
+  {
+    uint64_t written = header_->written.load( std::memory_order_acquire );
+    if( next_ >= written )
+    {
+      return false;
+    }
+    if( written - next_ > slots )
+    {
+      overruns_ += written - next_ - slots;
+      next_ = written - slots;
+    }
+
+    uint64_t n = next_++;
+    wrench_shm::Slot* slot = wrench_shm::slotAt( header_, n % slots );
+    uint64_t sequence = slot->sequence.load( std::memory_order_acquire );
+    if( sequence != 2 * n + 2 )
+    {
+      overruns_++;
+      continue;
+    }
+
+    size_t count = std::min<size_t>( slot->count, max_elements );
+    msg.stamp = ros::Time( slot->stamp_sec, slot->stamp_nsec );
+    msg.frame_indices.resize( count );
+    msg.wrenches.resize( count );
+    std::vector<float>* components[6] = { &msg.wrenches.fx, &msg.wrenches.fy, &msg.wrenches.fz,
+                                          &msg.wrenches.tx, &msg.wrenches.ty, &msg.wrenches.tz };
+    if( count > 0 )
+    {
+      std::memcpy( &msg.frame_indices[0], wrench_shm::frameIndices( slot ), count * sizeof( uint16_t ));
+      for( int k = 0; k < 6; k++ )
+      {
+        std::memcpy( &( *components[k] )[0], wrench_shm::component( slot, max_elements, k ),
+                     count * sizeof( float ));
+      }
+    }
+
+    // The writer may have started on this slot again while we copied.
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if( slot->sequence.load( std::memory_order_relaxed ) != sequence )
+    {
+      overruns_++;
+      continue;
+    }
+    return true;
+  }
+}
+
+const std::vector<std::string>& WrenchShmReader::frameIds()
+{
+  if( header_ )
+  {
+    size_t count = std::min<size_t>( header_->frame_count.load( std::memory_order_acquire ),
+                                     wrench_shm::MAX_FRAMES );
+    for( size_t i = frame_ids_.size(); i < count; i++ )
+    {
+      const char* frame = header_->frame_ids[i];
+      frame_ids_.push_back( std::string( frame, strnlen( frame, wrench_shm::FRAME_ID_SIZE )));
+    }
+  }
+  return frame_ids_;
+}
+
+} // end namespace my_rviz_plugin
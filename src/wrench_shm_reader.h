@@ -0,0 +1,74 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_SHM_READER_H
+#define MY_RVIZ_PLUGIN_WRENCH_SHM_READER_H
+
+#include <string>
+#include <vector>
+
+#ifndef Q_MOC_RUN
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+
+#include <ros/time.h>
+
+#include "wrench_shm_layout.h"
+#include "wrench_kernel.h"
+
+namespace my_rviz_plugin
+{
+
+// One message copied out of the segment. The wrenches keep the SoA layout
+// of the segment, so reading is a plain copy per component. The copy is
+// what makes the slot seqlock work: a slot is only known to be intact
+// after it has been read, and the kernels need the components in a
+// WrenchSoA anyway.
+struct WrenchShmMessage
+{
+  ros::Time stamp;
+  std::vector<uint16_t> frame_indices;
+  WrenchSoA wrenches;
+};
+
+// Display side of the shared-memory transport written by WrenchShmWriter.
+// Maps the segment read-only and never blocks the writer.
+class WrenchShmReader
+{
+public:
+  WrenchShmReader();
+
+  // Maps the segment name. Returns false if it does not exist (yet) or
+  // has an unknown layout. Only messages written after open() are read.
+  bool open( const std::string& name );
+  void close();
+  bool isOpen() const { return header_ != NULL; }
+  // Whether the writer of the open segment is gone, closed or dead, so
+  // that a restarted writer has to be looked for with open().
+  bool stale() const;
+
+  // Drops all unread messages but the newest keep ones.
+  void skip( size_t keep );
+
+  // Copies the next unread message into msg. Returns false if there is
+  // none. Messages overwritten before they could be read are counted in
+  // overruns().
+  bool read( WrenchShmMessage& msg );
+
+  // Frame table of the segment; frame_indices of messages index into it.
+  const std::vector<std::string>& frameIds();
+
+  size_t overruns() const { return overruns_; }
+  size_t skipped() const { return skipped_; }
+
+private:
+  boost::interprocess::shared_memory_object shm_;
+  boost::interprocess::mapped_region region_;
+  wrench_shm::Header* header_;
+  uint64_t next_;
+  std::vector<std::string> frame_ids_;
+  size_t overruns_;
+  size_t skipped_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_SHM_READER_H
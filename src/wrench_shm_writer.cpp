@@ -0,0 +1,132 @@
+#include <cstring>
+
+#include <unistd.h>
+
+#include "wrench_shm_writer.h"
+
+namespace my_rviz_plugin
+{
+
+namespace ipc = boost::interprocess;
+
+WrenchShmWriter::WrenchShmWriter( const std::string& name, size_t slots, size_t max_elements )
+  : name_( name )
+{
+  ipc::shared_memory_object::remove( name_.c_str() );
+  ipc::shared_memory_object shm( ipc::create_only, name_.c_str(), ipc::read_write );
+  shm.truncate( wrench_shm::segmentSize( slots, max_elements ));
+  ipc::mapped_region region( shm, ipc::read_write );
+  shm_.swap( shm );
+  region_.swap( region );
+
+  header_ = new ( region_.get_address() ) wrench_shm::Header();
+  header_->slots = slots;
+  header_->max_elements = max_elements;
+  header_->writer_pid = getpid();
+  header_->closed.store( 0 );
+  header_->written.store( 0 );
+  header_->frame_count.store( 0 );
+  for( size_t i = 0; i < slots; i++ )
+  {
+    new ( wrench_shm::slotAt( header_, i )) wrench_shm::Slot();
+    wrench_shm::slotAt( header_, i )->sequence.store( 0 );
+  }
+  header_->version = wrench_shm::VERSION;
+  // Readers check the magic last.
+  std::atomic_thread_fence( std::memory_order_release );
+  header_->magic = wrench_shm::MAGIC;
+}
+
+WrenchShmWriter::~WrenchShmWriter()
+{
+  header_->closed.store( 1, std::memory_order_release );
+  ipc::shared_memory_object::remove( name_.c_str() );
+}
+
+int WrenchShmWriter::frameIndex( const std::string& frame )
+{
+  for( size_t i = 0; i < frames_.size(); i++ )
+  {
+    if( frames_[i] == frame )
+    {
+      return i;
+    }
+  }
+  if( frames_.size() >= wrench_shm::MAX_FRAMES || frame.size() >= wrench_shm::FRAME_ID_SIZE )
+  {
+    return -1;
+  }
+  size_t index = frames_.size();
+  std::memset( header_->frame_ids[index], 0, wrench_shm::FRAME_ID_SIZE );
+  std::memcpy( header_->frame_ids[index], frame.c_str(), frame.size() );
+  header_->frame_count.store( index + 1, std::memory_order_release );
+  frames_.push_back( frame );
+  return index;
+}
+
+bool WrenchShmWriter::write( const ros::Time& stamp, const uint16_t* frame_indices,
+                             const float* forces, const float* torques, size_t count )
+{
+  size_t max_elements = header_->max_elements;
+  if( count > max_elements )
+  {
+    return false;
+  }
+  uint64_t n = header_->written.load( std::memory_order_relaxed );
+  wrench_shm::Slot* slot = wrench_shm::slotAt( header_, n % header_->slots );
+
+  slot->sequence.store( 2 * n + 1, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+
+  slot->stamp_sec = stamp.sec;
+  slot->stamp_nsec = stamp.nsec;
+  slot->count = count;
+  float* component[6];
+  for( int k = 0; k < 6; k++ )
+  {
+    component[k] = wrench_shm::component( slot, max_elements, k );
+  }
+  uint16_t* indices = wrench_shm::frameIndices( slot );
+  for( size_t i = 0; i < count; i++ )
+  {
+    indices[i] = frame_indices[i];
+    component[0][i] = forces[3 * i];
+    component[1][i] = forces[3 * i + 1];
+    component[2][i] = forces[3 * i + 2];
+    component[3][i] = torques[3 * i];
+    component[4][i] = torques[3 * i + 1];
+    component[5][i] = torques[3 * i + 2];
+  }
+
+  slot->sequence.store( 2 * n + 2, std::memory_order_release );
+  header_->written.store( n + 1, std::memory_order_release );
+  return true;
+}
+
+bool WrenchShmWriter::write( const my_rviz_plugin::WrenchStampedArray& msg )
+{
+  indices_.clear();
+  forces_.clear();
+  torques_.clear();
+  for( size_t i = 0; i < msg.wrenchstampeds.size(); i++ )
+  {
+    const geometry_msgs::WrenchStamped& wrench = msg.wrenchstampeds[i];
+    int index = frameIndex( wrench.header.frame_id );
+    if( index < 0 )
+    {
+      continue;
+    }
+    indices_.push_back( index );
+    forces_.push_back( wrench.wrench.force.x );
+    forces_.push_back( wrench.wrench.force.y );
+    forces_.push_back( wrench.wrench.force.z );
+    torques_.push_back( wrench.wrench.torque.x );
+    torques_.push_back( wrench.wrench.torque.y );
+    torques_.push_back( wrench.wrench.torque.z );
+  }
+  return write( msg.header.stamp, indices_.empty() ? NULL : &indices_[0],
+                forces_.empty() ? NULL : &forces_[0], torques_.empty() ? NULL : &torques_[0],
+                indices_.size() );
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,69 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_SHM_WRITER_H
+#define MY_RVIZ_PLUGIN_WRENCH_SHM_WRITER_H
+
+#include <string>
+#include <vector>
+
+#ifndef Q_MOC_RUN
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+
+#include <ros/time.h>
+#include <my_rviz_plugin/WrenchStampedArray.h>
+
+#include "wrench_shm_layout.h"
+
+namespace my_rviz_plugin
+{
+
+// Publisher side of the shared-memory transport, for a controller running
+// on the same host as rviz. Point the "Shared Memory" property of a
+// WrenchStampedArray display at the same name.
+//
+//   my_rviz_plugin::WrenchShmWriter writer( "wrenches", 64, 16 );
+//   writer.write( msg );
+//
+// write() never blocks and never allocates once the frames are known;
+// readers that fall more than slots messages behind lose the oldest ones.
+class WrenchShmWriter
+{
+public:
+  // Creates the segment name, replacing an existing one, for the last
+  // slots messages of at most max_elements elements each.
+  // Throws boost::interprocess::interprocess_exception on failure.
+  WrenchShmWriter( const std::string& name, size_t slots, size_t max_elements );
+  // Marks the segment closed and removes the name; readers keep their
+  // mapping.
+  ~WrenchShmWriter();
+
+  // Index of frame in the frame table, registering it on first use.
+  // Returns -1 if the table is full or the name too long.
+  int frameIndex( const std::string& frame );
+
+  // forces and torques hold count xyz triples. Returns false, writing
+  // nothing, if count exceeds maxElements().
+  bool write( const ros::Time& stamp, const uint16_t* frame_indices,
+              const float* forces, const float* torques, size_t count );
+  // Elements in frames that cannot be registered are skipped. Uses the
+  // header stamp for all elements.
+  bool write( const my_rviz_plugin::WrenchStampedArray& msg );
+
+  size_t maxElements() const { return header_->max_elements; }
+  size_t written() const { return header_->written.load( std::memory_order_relaxed ); }
+
+private:
+  std::string name_;
+  boost::interprocess::shared_memory_object shm_;
+  boost::interprocess::mapped_region region_;
+  wrench_shm::Header* header_;
+  std::vector<std::string> frames_;
+
+  // Scratch space of write( msg ).
+  std::vector<uint16_t> indices_;
+  std::vector<float> forces_, torques_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_SHM_WRITER_H
@@ -0,0 +1,135 @@
+#include "wrench_topic_synchronizer.h"
+
+namespace my_rviz_plugin
+{
+
+WrenchTopicSynchronizer::WrenchTopicSynchronizer()
+  : tolerance_( 0.02 )
+  , queue_size_( 10 )
+  , dropped_( 0 )
+  , sets_( 0 )
+{
+}
+
+void WrenchTopicSynchronizer::setTopics( size_t topics )
+{
+  queues_.clear();
+  queues_.resize( topics );
+}
+
+void WrenchTopicSynchronizer::setTolerance( double seconds )
+{
+  tolerance_ = ros::Duration( seconds > 0 ? seconds : 0 );
+}
+
+void WrenchTopicSynchronizer::setQueueSize( size_t queue_size )
+{
+  queue_size_ = queue_size > 0 ? queue_size : 1;
+  for( size_t i = 0; i < queues_.size(); i++ )
+  {
+    while( queues_[i].size() > queue_size_ )
+    {
+      queues_[i].pop_front();
+      dropped_++;
+    }
+  }
+}
+
+void WrenchTopicSynchronizer::push( size_t topic, const geometry_msgs::WrenchStamped::ConstPtr& msg )
+{
+  if( topic >= queues_.size() )
+  {
+    return;
+  }
+  Queue& queue = queues_[topic];
+  // A stamp that went back, e.g. after a bag loops, restarts the topic.
+  if( !queue.empty() && msg->header.stamp < queue.back()->header.stamp )
+  {
+    dropped_ += queue.size();
+    queue.clear();
+  }
+  if( queue.size() >= queue_size_ )
+  {
+    queue.pop_front();
+    dropped_++;
+  }
+  queue.push_back( msg );
+}
+
+bool WrenchTopicSynchronizer::align( ros::Time& pivot )
+{
+  if( queues_.empty() )
+  {
+    return false;
+  }
+  for( ;; )
+  {
+    pivot = ros::Time();
+    for( size_t i = 0; i < queues_.size(); i++ )
+    {
+      if( queues_[i].empty() )
+      {
+        return false;
+      }
+      if( queues_[i].front()->header.stamp > pivot )
+      {
+        pivot = queues_[i].front()->header.stamp;
+      }
+    }
+
+    bool dropped = false;
+    for( size_t i = 0; i < queues_.size(); i++ )
+    {
+      Queue& queue = queues_[i];
+      while( !queue.empty() && queue.front()->header.stamp + tolerance_ < pivot )
+      {
+        queue.pop_front();
+        dropped_++;
+        dropped = true;
+      }
+    }
+    // Otherwise all fronts are in [ pivot - tolerance, pivot ].
+    if( !dropped )
+    {
+      return true;
+    }
+  }
+}
+
+my_rviz_plugin::WrenchStampedArrayPtr WrenchTopicSynchronizer::next()
+{
+  ros::Time pivot;
+  if( !align( pivot ))
+  {
+    return my_rviz_plugin::WrenchStampedArrayPtr();
+  }
+  my_rviz_plugin::WrenchStampedArrayPtr set( new my_rviz_plugin::WrenchStampedArray );
+  set->header.stamp = pivot;
+  set->wrenchstampeds.resize( queues_.size() );
+  for( size_t i = 0; i < queues_.size(); i++ )
+  {
+    Queue& queue = queues_[i];
+    // The newest message not after the pivot is the closest one.
+    while( queue.size() > 1 && queue[1]->header.stamp <= pivot )
+    {
+      queue.pop_front();
+      dropped_++;
+    }
+    set->wrenchstampeds[i] = *queue.front();
+    queue.pop_front();
+  }
+  sets_++;
+  return set;
+}
+
+void WrenchTopicSynchronizer::clear()
+{
+  for( size_t i = 0; i < queues_.size(); i++ )
+  {
+    queues_[i].clear();
+  }
+  dropped_ = 0;
+  sets_ = 0;
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,64 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_TOPIC_SYNCHRONIZER_H
+#define MY_RVIZ_PLUGIN_WRENCH_TOPIC_SYNCHRONIZER_H
+
+#include <deque>
+#include <vector>
+
+#include <geometry_msgs/WrenchStamped.h>
+#include <my_rviz_plugin/WrenchStampedArray.h>
+
+namespace my_rviz_plugin
+{
+
+// Approximate-time synchronization of a runtime number of WrenchStamped
+// topics, e.g. one per foot and wrist sensor.
+//
+// message_filters::Synchronizer fixes the number of topics at compile
+// time, so this is a small policy of its own. A set takes one message per
+// topic, all stamped within the tolerance of each other. Every set must
+// contain a message of the topic whose oldest queued message is the
+// newest, the pivot, so messages older than the pivot minus the tolerance
+// can never be matched and are dropped. Once every topic has a message in
+// [ pivot - tolerance, pivot ], the newest of them forms the next set and
+// everything up to it is consumed. Each topic must publish in stamp order.
+class WrenchTopicSynchronizer
+{
+public:
+  WrenchTopicSynchronizer();
+
+  // Restarts with topics empty queues.
+  void setTopics( size_t topics );
+  size_t topics() const { return queues_.size(); }
+  void setTolerance( double seconds );
+  // Messages beyond queue_size per topic drop the oldest one.
+  void setQueueSize( size_t queue_size );
+
+  void push( size_t topic, const geometry_msgs::WrenchStamped::ConstPtr& msg );
+
+  // The next complete set, element i from topic i, stamped with the
+  // pivot. Null if some topic has no message close enough yet.
+  my_rviz_plugin::WrenchStampedArrayPtr next();
+
+  void clear();
+
+  // Messages dropped without being part of a set.
+  size_t dropped() const { return dropped_; }
+  size_t sets() const { return sets_; }
+
+private:
+  typedef std::deque<geometry_msgs::WrenchStamped::ConstPtr> Queue;
+
+  // Drops the messages that cannot be matched any more. False if a queue
+  // runs empty; otherwise pivot is left at the stamp of the next set.
+  bool align( ros::Time& pivot );
+
+  std::vector<Queue> queues_;
+  ros::Duration tolerance_;
+  size_t queue_size_;
+  size_t dropped_;
+  size_t sets_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_TOPIC_SYNCHRONIZER_H
@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include <OgreSceneNode.h>
+#include <OgreSceneManager.h>
+
+#include <rviz/default_plugin/wrench_visual.h>
+
+#include "wrench_visual_pool.h"
+
+namespace my_rviz_plugin
+{
+
+WrenchVisualPool::WrenchVisualPool()
+  : scene_manager_( NULL )
+  , parent_node_( NULL )
+  , allocations_( 0 )
+  , reuses_( 0 )
+{
+}
+
+WrenchVisualPool::~WrenchVisualPool()
+{
+}
+
+void WrenchVisualPool::initialize( Ogre::SceneManager* scene_manager, Ogre::SceneNode* parent_node )
+{
+  scene_manager_ = scene_manager;
+  parent_node_ = parent_node;
+}
+
+boost::shared_ptr<rviz::WrenchVisual> WrenchVisualPool::acquire()
+{
+  boost::shared_ptr<rviz::WrenchVisual> visual;
+  if( !idle_.empty() )
+  {
+    visual = idle_.back();
+    idle_.pop_back();
+    visual->setVisible( true );
+    reuses_++;
+  }
+  else
+  {
+    visual.reset( new rviz::WrenchVisual( scene_manager_, parent_node_ ));
+    allocations_++;
+  }
+  return visual;
+}
+
+void WrenchVisualPool::release( const boost::shared_ptr<rviz::WrenchVisual>& visual )
+{
+  visual->setVisible( false );
+  idle_.push_back( visual );
+}
+
+void WrenchVisualPool::reserve( size_t n )
+{
+  // max_array_size * History Length can be far more than will ever be
+  // idle at once, e.g. with long histories of large arrays.
+  n = std::min( n, MAX_RESERVE );
+  if( idle_.capacity() < n )
+  {
+    idle_.reserve( n );
+  }
+}
+
+void WrenchVisualPool::trim( size_t keep )
+{
+  if( idle_.size() > keep )
+  {
+    idle_.resize( keep );
+  }
+}
+
+} // end namespace my_rviz_plugin
@@ -0,0 +1,76 @@
+#ifndef MY_RVIZ_PLUGIN_WRENCH_VISUAL_POOL_H
+#define MY_RVIZ_PLUGIN_WRENCH_VISUAL_POOL_H
+
+#include <vector>
+#include <cstddef>
+
+#include <boost/shared_ptr.hpp>
+
+namespace Ogre
+{
+class SceneManager;
+class SceneNode;
+}
+
+namespace rviz
+{
+  class WrenchVisual;
+}
+
+namespace my_rviz_plugin
+{
+
+// Arena of rviz::WrenchVisual owned by a display.
+// Visuals that are no longer displayed are hidden and kept here instead of
+// being destroyed, so that a display in steady state only updates existing
+// visuals and does not create or tear down any Ogre objects.
+class WrenchVisualPool
+{
+public:
+  // Rough size of one rviz::WrenchVisual with its scene nodes, two arrows
+  // and the torque ring, for memory estimates.
+  static const size_t VISUAL_BYTES = 8 * 1024;
+
+  WrenchVisualPool();
+  ~WrenchVisualPool();
+
+  void initialize( Ogre::SceneManager* scene_manager, Ogre::SceneNode* parent_node );
+
+  // Returns a visible visual, reusing an idle one if there is any.
+  boost::shared_ptr<rviz::WrenchVisual> acquire();
+
+  // Hides the visual and keeps it for a later acquire().
+  void release( const boost::shared_ptr<rviz::WrenchVisual>& visual );
+
+  // Most visuals reserve() makes room for. Beyond that, the pool grows as
+  // visuals are released.
+  static const size_t MAX_RESERVE = 65536;
+
+  // Makes room for n visuals in total, at most MAX_RESERVE, so that
+  // releasing them does not reallocate.
+  void reserve( size_t n );
+
+  // Destroys the idle visuals beyond the first keep.
+  void trim( size_t keep );
+
+  // Number of visuals created since initialize().
+  size_t allocations() const { return allocations_; }
+  // Number of acquire() calls served by an idle visual.
+  size_t reuses() const { return reuses_; }
+  // Number of visuals currently waiting in the pool.
+  size_t idle() const { return idle_.size(); }
+
+private:
+  Ogre::SceneManager* scene_manager_;
+  Ogre::SceneNode* parent_node_;
+
+  //注意!! rviz::WrenchVisualはshared_prtの状態で扱うこと。
+  std::vector<boost::shared_ptr<rviz::WrenchVisual> > idle_;
+
+  size_t allocations_;
+  size_t reuses_;
+};
+
+} // end namespace my_rviz_plugin
+
+#endif // MY_RVIZ_PLUGIN_WRENCH_VISUAL_POOL_H
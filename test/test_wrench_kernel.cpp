@@ -0,0 +1,193 @@
+// Checks the SSE kernels of wrench_kernel.h against their scalar
+// reference and against Ogre, for sizes around the four-element blocks.
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include <OgreVector3.h>
+#include <OgreQuaternion.h>
+
+#include "wrench_kernel.h"
+
+using namespace my_rviz_plugin;
+
+namespace
+{
+const size_t SIZES[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 31, 64, 1001 };
+
+float uniform( float min, float max )
+{
+  return min + ( max - min ) * std::rand() / static_cast<float>( RAND_MAX );
+}
+
+std::vector<float>& component( WrenchSoA& wrenches, int c )
+{
+  switch( c )
+  {
+  case 0: return wrenches.fx;
+  case 1: return wrenches.fy;
+  case 2: return wrenches.fz;
+  case 3: return wrenches.tx;
+  case 4: return wrenches.ty;
+  default: return wrenches.tz;
+  }
+}
+
+WrenchSoA randomWrenches( size_t size )
+{
+  WrenchSoA wrenches;
+  wrenches.resize( size );
+  for( int c = 0; c < 6; c++ )
+  {
+    for( size_t i = 0; i < size; i++ )
+    {
+      component( wrenches, c )[i] = uniform( -100, 100 );
+    }
+  }
+  return wrenches;
+}
+
+RotationSoA randomRotations( size_t size )
+{
+  RotationSoA rotations;
+  rotations.resize( size );
+  for( size_t i = 0; i < size; i++ )
+  {
+    float w = uniform( -1, 1 ), x = uniform( -1, 1 ), y = uniform( -1, 1 ), z = uniform( -1, 1 );
+    float norm = std::sqrt( w * w + x * x + y * y + z * z );
+    if( norm < 1e-3f )
+    {
+      w = norm = 1;
+    }
+    rotations.w[i] = w / norm;
+    rotations.x[i] = x / norm;
+    rotations.y[i] = y / norm;
+    rotations.z[i] = z / norm;
+  }
+  return rotations;
+}
+
+void expectNear( const Ogre::Vector3& expected, float x, float y, float z )
+{
+  float tolerance = 1e-4f * std::max( 1.0f, expected.length() );
+  EXPECT_NEAR( expected.x, x, tolerance );
+  EXPECT_NEAR( expected.y, y, tolerance );
+  EXPECT_NEAR( expected.z, z, tolerance );
+}
+}
+
+TEST( WrenchKernel, ValidateFiniteWrenches )
+{
+  for( size_t s = 0; s < sizeof( SIZES ) / sizeof( SIZES[0] ); s++ )
+  {
+    WrenchSoA wrenches = randomWrenches( SIZES[s] );
+    std::vector<uint8_t> valid, reference;
+    EXPECT_EQ( SIZES[s], validateWrenches( wrenches, valid ));
+    EXPECT_EQ( SIZES[s], validateWrenchesScalar( wrenches, reference ));
+    EXPECT_EQ( reference, valid );
+  }
+}
+
+// Every non-finite value in every component, in the SSE blocks and in the
+// scalar tail.
+TEST( WrenchKernel, ValidateNonFiniteComponents )
+{
+  const float BAD[] = { std::numeric_limits<float>::quiet_NaN(),
+                        std::numeric_limits<float>::infinity(),
+                        -std::numeric_limits<float>::infinity() };
+  for( size_t s = 0; s < sizeof( SIZES ) / sizeof( SIZES[0] ); s++ )
+  {
+    size_t size = SIZES[s];
+    for( size_t element = 0; element < size; element += ( size > 16 ? 7 : 1 ))
+    {
+      for( int c = 0; c < 6; c++ )
+      {
+        for( int b = 0; b < 3; b++ )
+        {
+          WrenchSoA wrenches = randomWrenches( size );
+          component( wrenches, c )[element] = BAD[b];
+          // The last element, which is in the tail unless size is a
+          // multiple of four, is always bad too.
+          component( wrenches, 5 - c )[size - 1] = BAD[( b + 1 ) % 3];
+          std::vector<uint8_t> valid, reference;
+          size_t expected = size - ( element == size - 1 ? 1 : 2 );
+          ASSERT_EQ( expected, validateWrenches( wrenches, valid ))
+              << "size " << size << " element " << element << " component " << c;
+          ASSERT_EQ( expected, validateWrenchesScalar( wrenches, reference ));
+          ASSERT_EQ( reference, valid );
+          EXPECT_EQ( 0, valid[element] );
+          EXPECT_EQ( 0, valid[size - 1] );
+        }
+      }
+    }
+  }
+}
+
+TEST( WrenchKernel, TransformMatchesScalarAndOgre )
+{
+  const float FORCE_SCALE = 0.5f, TORQUE_SCALE = 2.0f;
+  for( size_t s = 0; s < sizeof( SIZES ) / sizeof( SIZES[0] ); s++ )
+  {
+    size_t size = SIZES[s];
+    WrenchSoA wrenches = randomWrenches( size );
+    RotationSoA rotations = randomRotations( size );
+
+    WrenchSoA out, reference;
+    std::vector<float> force_norm, torque_norm, reference_force_norm, reference_torque_norm;
+    transformWrenches( wrenches, rotations, FORCE_SCALE, TORQUE_SCALE, out, force_norm, torque_norm );
+    transformWrenchesScalar( wrenches, rotations, FORCE_SCALE, TORQUE_SCALE,
+                             reference, reference_force_norm, reference_torque_norm );
+    ASSERT_EQ( size, out.size() );
+    ASSERT_EQ( size, force_norm.size() );
+    ASSERT_EQ( size, torque_norm.size() );
+
+    for( size_t i = 0; i < size; i++ )
+    {
+      Ogre::Quaternion q( rotations.w[i], rotations.x[i], rotations.y[i], rotations.z[i] );
+      Ogre::Vector3 force = q * Ogre::Vector3( wrenches.fx[i], wrenches.fy[i], wrenches.fz[i] ) * FORCE_SCALE;
+      Ogre::Vector3 torque = q * Ogre::Vector3( wrenches.tx[i], wrenches.ty[i], wrenches.tz[i] ) * TORQUE_SCALE;
+
+      expectNear( force, out.fx[i], out.fy[i], out.fz[i] );
+      expectNear( torque, out.tx[i], out.ty[i], out.tz[i] );
+      expectNear( force, reference.fx[i], reference.fy[i], reference.fz[i] );
+      expectNear( torque, reference.tx[i], reference.ty[i], reference.tz[i] );
+      EXPECT_NEAR( force.length(), force_norm[i], 1e-4f * std::max( 1.0f, force.length() ));
+      EXPECT_NEAR( torque.length(), torque_norm[i], 1e-4f * std::max( 1.0f, torque.length() ));
+      EXPECT_NEAR( reference_force_norm[i], force_norm[i], 1e-4f * std::max( 1.0f, force.length() ));
+      EXPECT_NEAR( reference_torque_norm[i], torque_norm[i], 1e-4f * std::max( 1.0f, torque.length() ));
+    }
+  }
+}
+
+TEST( WrenchKernel, IdentityKeepsWrenches )
+{
+  WrenchSoA wrenches = randomWrenches( 7 );
+  RotationSoA rotations;
+  rotations.resize( 7 );
+  for( size_t i = 0; i < 7; i++ )
+  {
+    rotations.w[i] = 1;
+    rotations.x[i] = rotations.y[i] = rotations.z[i] = 0;
+  }
+  WrenchSoA out;
+  std::vector<float> force_norm, torque_norm;
+  transformWrenches( wrenches, rotations, 1, 1, out, force_norm, torque_norm );
+  for( int c = 0; c < 6; c++ )
+  {
+    for( size_t i = 0; i < 7; i++ )
+    {
+      EXPECT_FLOAT_EQ( component( wrenches, c )[i], component( out, c )[i] );
+    }
+  }
+}
+
+int main( int argc, char** argv )
+{
+  testing::InitGoogleTest( &argc, argv );
+  std::srand( 1 );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,336 @@
+// Checks WrenchShmReader against a WrenchShmWriter in a forked process:
+// messages arrive complete and in order, readers that fall behind count
+// overruns, no torn message is ever returned, and a restarted writer is
+// found again by reopening the segment.
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "wrench_shm_reader.h"
+#include "wrench_shm_writer.h"
+
+using namespace my_rviz_plugin;
+
+namespace
+{
+const size_t SLOTS = 8;
+const size_t MAX_ELEMENTS = 5;
+
+std::string segmentName()
+{
+  std::ostringstream name;
+  name << "my_rviz_plugin_test_" << getpid();
+  return name.str();
+}
+
+// Message n has n % max_elements + 1 elements whose components all encode
+// n, element and component, exactly in a float, so that a torn message
+// cannot pass check().
+float value( uint32_t n, size_t element, int component )
+{
+  return ( n % 4096 ) * 4096.0f + ( element % 512 ) * 8.0f + component;
+}
+
+void write( WrenchShmWriter& writer, uint32_t n )
+{
+  size_t count = n % writer.maxElements() + 1;
+  std::vector<uint16_t> indices( count, 0 );
+  std::vector<float> forces( 3 * count ), torques( 3 * count );
+  for( size_t i = 0; i < count; i++ )
+  {
+    for( int k = 0; k < 3; k++ )
+    {
+      forces[3 * i + k] = value( n, i, k );
+      torques[3 * i + k] = value( n, i, 3 + k );
+    }
+  }
+  writer.write( ros::Time( n, 0 ), &indices[0], &forces[0], &torques[0], count );
+}
+
+// Returns the n message msg is, or fails the test if msg is not exactly a
+// message written by write().
+uint32_t check( const WrenchShmMessage& msg, size_t max_elements = MAX_ELEMENTS )
+{
+  uint32_t n = msg.stamp.sec;
+  size_t count = n % max_elements + 1;
+  EXPECT_EQ( count, msg.frame_indices.size() );
+  EXPECT_EQ( count, msg.wrenches.size() );
+  const std::vector<float>* components[6] = { &msg.wrenches.fx, &msg.wrenches.fy, &msg.wrenches.fz,
+                                              &msg.wrenches.tx, &msg.wrenches.ty, &msg.wrenches.tz };
+  for( size_t i = 0; i < count && i < msg.wrenches.size(); i++ )
+  {
+    for( int k = 0; k < 6; k++ )
+    {
+      EXPECT_EQ( value( n, i, k ), ( *components[k] )[i] ) << "message " << n << " element " << i;
+    }
+  }
+  return n;
+}
+
+// A writer in a child process, driven by one byte commands through a pipe
+// and acknowledging each of them through another.
+class WriterProcess
+{
+public:
+  // 'w': write the next message, 'b': write the next burst of messages
+  // without waiting, 'q': remove the segment and exit.
+  WriterProcess( const std::string& name, uint32_t first = 0, uint32_t burst = 0,
+                 size_t max_elements = MAX_ELEMENTS )
+  {
+    int commands[2], acks[2];
+    if( pipe( commands ) != 0 || pipe( acks ) != 0 )
+    {
+      ADD_FAILURE() << "pipe failed";
+    }
+    pid_ = fork();
+    if( pid_ == 0 )
+    {
+      close( commands[1] );
+      close( acks[0] );
+      run( name, first, burst, max_elements, commands[0], acks[1] );
+    }
+    close( commands[0] );
+    close( acks[1] );
+    commands_ = commands[1];
+    acks_ = acks[0];
+    // The segment exists once the child acknowledges its start.
+    wait();
+  }
+
+  ~WriterProcess()
+  {
+    quit();
+  }
+
+  void command( char c )
+  {
+    ASSERT_EQ( 1, ::write( commands_, &c, 1 ));
+    wait();
+  }
+
+  void quit()
+  {
+    if( pid_ > 0 )
+    {
+      command( 'q' );
+      int status = 0;
+      waitpid( pid_, &status, 0 );
+      EXPECT_TRUE( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+      close( commands_ );
+      close( acks_ );
+      pid_ = 0;
+    }
+  }
+
+private:
+  void wait()
+  {
+    char c;
+    ASSERT_EQ( 1, read( acks_, &c, 1 ));
+  }
+
+  static void run( const std::string& name, uint32_t n, uint32_t burst, size_t max_elements,
+                   int commands, int acks )
+  {
+    int status = 0;
+    try
+    {
+      WrenchShmWriter writer( name, SLOTS, max_elements );
+      writer.frameIndex( "sensor" );
+      char c = 0;
+      while( ::write( acks, &c, 1 ) == 1 && read( commands, &c, 1 ) == 1 && c != 'q' )
+      {
+        for( uint32_t end = n + ( c == 'b' ? burst : 1 ); n < end; n++ )
+        {
+          write( writer, n );
+        }
+      }
+    }
+    catch( ... )
+    {
+      status = 1;
+    }
+    // The writer is gone, which removed the segment.
+    char c = 0;
+    if( ::write( acks, &c, 1 ) != 1 )
+    {
+      status = 1;
+    }
+    _exit( status );
+  }
+
+  pid_t pid_;
+  int commands_;
+  int acks_;
+};
+}
+
+TEST( WrenchShm, ReadsMessagesInOrder )
+{
+  std::string name = segmentName();
+  WriterProcess writer( name );
+  WrenchShmReader reader;
+  ASSERT_TRUE( reader.open( name ));
+
+  WrenchShmMessage msg;
+  EXPECT_FALSE( reader.read( msg ));
+  for( uint32_t n = 0; n < 3 * SLOTS; n++ )
+  {
+    writer.command( 'w' );
+    ASSERT_TRUE( reader.read( msg ));
+    EXPECT_EQ( n, check( msg ));
+    EXPECT_FALSE( reader.read( msg ));
+  }
+  EXPECT_EQ( 0u, reader.overruns() );
+  ASSERT_EQ( 1u, reader.frameIds().size() );
+  EXPECT_EQ( "sensor", reader.frameIds()[0] );
+}
+
+TEST( WrenchShm, OnlyReadsMessagesAfterOpen )
+{
+  std::string name = segmentName();
+  WriterProcess writer( name, 0, 3 );
+  writer.command( 'b' );
+  WrenchShmReader reader;
+  ASSERT_TRUE( reader.open( name ));
+  writer.command( 'w' );
+
+  WrenchShmMessage msg;
+  ASSERT_TRUE( reader.read( msg ));
+  EXPECT_EQ( 3u, check( msg ));
+  EXPECT_FALSE( reader.read( msg ));
+}
+
+// A reader that falls more than SLOTS messages behind gets the newest
+// SLOTS ones and counts the rest as overruns.
+TEST( WrenchShm, CountsOverruns )
+{
+  std::string name = segmentName();
+  const uint32_t BURST = SLOTS + 5;
+  WriterProcess writer( name, 0, BURST );
+  WrenchShmReader reader;
+  ASSERT_TRUE( reader.open( name ));
+  writer.command( 'b' );
+
+  WrenchShmMessage msg;
+  for( uint32_t n = BURST - SLOTS; n < BURST; n++ )
+  {
+    ASSERT_TRUE( reader.read( msg ));
+    EXPECT_EQ( n, check( msg ));
+  }
+  EXPECT_FALSE( reader.read( msg ));
+  EXPECT_EQ( BURST - SLOTS, reader.overruns() );
+}
+
+TEST( WrenchShm, SkipKeepsNewest )
+{
+  std::string name = segmentName();
+  WriterProcess writer( name, 0, 6 );
+  WrenchShmReader reader;
+  ASSERT_TRUE( reader.open( name ));
+  writer.command( 'b' );
+
+  reader.skip( 2 );
+  WrenchShmMessage msg;
+  ASSERT_TRUE( reader.read( msg ));
+  EXPECT_EQ( 4u, check( msg ));
+  ASSERT_TRUE( reader.read( msg ));
+  EXPECT_EQ( 5u, check( msg ));
+  EXPECT_FALSE( reader.read( msg ));
+  EXPECT_EQ( 4u, reader.skipped() );
+  EXPECT_EQ( 0u, reader.overruns() );
+}
+
+// The writer overwrites slots while they are read. Every message read
+// must be one the writer wrote, never a mix of two. Messages are large so
+// that copying one takes about as long as writing one.
+TEST( WrenchShm, NeverReturnsTornMessages )
+{
+  std::string name = segmentName();
+  const uint32_t BURST = 20000;
+  const size_t LARGE = 4096;
+  WriterProcess writer( name, 0, BURST, LARGE );
+  WrenchShmReader reader;
+  ASSERT_TRUE( reader.open( name ));
+
+  pid_t child = fork();
+  if( child == 0 )
+  {
+    // Burst from a second process so that the reader below runs at the
+    // same time; the writer process acknowledges when done.
+    writer.command( 'b' );
+    _exit( 0 );
+  }
+  WrenchShmMessage msg;
+  size_t reads = 0;
+  uint32_t last = 0;
+  int status = 0;
+  bool done = false;
+  while( true )
+  {
+    if( reader.read( msg ))
+    {
+      uint32_t n = check( msg, LARGE );
+      ASSERT_TRUE( reads == 0 || n > last ) << n << " after " << last;
+      last = n;
+      reads++;
+    }
+    else if( done )
+    {
+      break;
+    }
+    else
+    {
+      // One more pass after the burst, for the messages left.
+      done = waitpid( child, &status, WNOHANG ) != 0;
+    }
+  }
+  EXPECT_TRUE( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 );
+  EXPECT_GT( reads, 0u );
+  EXPECT_EQ( BURST - 1, last );
+}
+
+// A restarted writer replaces the segment. The old mapping goes quiet and
+// stale, and reopening finds the new writer, as the display does.
+TEST( WrenchShm, ReopensAfterWriterRestart )
+{
+  std::string name = segmentName();
+  WrenchShmReader reader;
+  WrenchShmMessage msg;
+  {
+    WriterProcess writer( name );
+    ASSERT_TRUE( reader.open( name ));
+    writer.command( 'w' );
+    ASSERT_TRUE( reader.read( msg ));
+    EXPECT_EQ( 0u, check( msg ));
+    EXPECT_FALSE( reader.stale() );
+  }
+  EXPECT_FALSE( reader.read( msg ));
+  EXPECT_TRUE( reader.stale() );
+  WrenchShmReader missing;
+  EXPECT_FALSE( missing.open( name ));
+
+  WriterProcess writer( name, 1000 );
+  writer.command( 'w' );
+  EXPECT_FALSE( reader.read( msg ));
+
+  ASSERT_TRUE( reader.open( name ));
+  EXPECT_FALSE( reader.stale() );
+  writer.command( 'w' );
+  ASSERT_TRUE( reader.read( msg ));
+  EXPECT_EQ( 1001u, check( msg ));
+  EXPECT_FALSE( reader.read( msg ));
+}
+
+int main( int argc, char** argv )
+{
+  testing::InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,180 @@
+// Microbenchmark of the wrench kernels against the per-element path they
+// replaced, for arrays of 1 to 10000 elements.
+//
+//   rosrun my_rviz_plugin wrench_kernel_benchmark [seconds per case]
+//
+// "element" validates and rotates one geometry_msgs::Wrench at a time
+// with Ogre, as the displays did before the kernels; "scalar" is the SoA
+// loop without SSE; "kernel" is validateWrenches() plus
+// transformWrenches(). Times are nanoseconds per element.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+
+#include <OgreVector3.h>
+#include <OgreQuaternion.h>
+#include <geometry_msgs/Wrench.h>
+
+#include "wrench_kernel.h"
+
+using namespace my_rviz_plugin;
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+struct Data
+{
+  std::vector<geometry_msgs::Wrench> messages;
+  std::vector<Ogre::Quaternion> orientations;
+  WrenchSoA wrenches;
+  RotationSoA rotations;
+};
+
+float uniform( float min, float max )
+{
+  return min + ( max - min ) * std::rand() / static_cast<float>( RAND_MAX );
+}
+
+void makeData( size_t size, Data& data )
+{
+  data.messages.resize( size );
+  data.orientations.resize( size );
+  data.wrenches.resize( size );
+  data.rotations.resize( size );
+  for( size_t i = 0; i < size; i++ )
+  {
+    geometry_msgs::Wrench& wrench = data.messages[i];
+    wrench.force.x = data.wrenches.fx[i] = uniform( -100, 100 );
+    wrench.force.y = data.wrenches.fy[i] = uniform( -100, 100 );
+    wrench.force.z = data.wrenches.fz[i] = uniform( -100, 100 );
+    wrench.torque.x = data.wrenches.tx[i] = uniform( -10, 10 );
+    wrench.torque.y = data.wrenches.ty[i] = uniform( -10, 10 );
+    wrench.torque.z = data.wrenches.tz[i] = uniform( -10, 10 );
+    Ogre::Vector3 axis( uniform( -1, 1 ), uniform( -1, 1 ), 1 );
+    float angle = uniform( -3, 3 );
+    float s = std::sin( angle / 2 ) / axis.length();
+    data.orientations[i] = Ogre::Quaternion( std::cos( angle / 2 ), axis.x * s, axis.y * s, axis.z * s );
+    data.rotations.w[i] = data.orientations[i].w;
+    data.rotations.x[i] = data.orientations[i].x;
+    data.rotations.y[i] = data.orientations[i].y;
+    data.rotations.z[i] = data.orientations[i].z;
+  }
+}
+
+// Keeps the results alive so that the compiler cannot drop the work.
+volatile float g_sink;
+
+bool finite( const geometry_msgs::Vector3& v )
+{
+  return std::isfinite( v.x ) && std::isfinite( v.y ) && std::isfinite( v.z );
+}
+
+void perElement( const Data& data )
+{
+  float sum = 0;
+  for( size_t i = 0; i < data.messages.size(); i++ )
+  {
+    const geometry_msgs::Wrench& wrench = data.messages[i];
+    if( !finite( wrench.force ) || !finite( wrench.torque ))
+    {
+      continue;
+    }
+    Ogre::Vector3 force = data.orientations[i] * Ogre::Vector3( wrench.force.x, wrench.force.y, wrench.force.z ) * 0.5f;
+    Ogre::Vector3 torque = data.orientations[i] * Ogre::Vector3( wrench.torque.x, wrench.torque.y, wrench.torque.z ) * 2.0f;
+    sum += force.length() + torque.length();
+  }
+  g_sink = sum;
+}
+
+struct Scratch
+{
+  std::vector<uint8_t> valid;
+  WrenchSoA out;
+  std::vector<float> force_norm, torque_norm;
+};
+
+void scalar( const Data& data, Scratch& scratch )
+{
+  validateWrenchesScalar( data.wrenches, scratch.valid );
+  transformWrenchesScalar( data.wrenches, data.rotations, 0.5f, 2.0f,
+                           scratch.out, scratch.force_norm, scratch.torque_norm );
+  g_sink = scratch.force_norm.empty() ? 0 : scratch.force_norm.back();
+}
+
+void kernel( const Data& data, Scratch& scratch )
+{
+  validateWrenches( data.wrenches, scratch.valid );
+  transformWrenches( data.wrenches, data.rotations, 0.5f, 2.0f,
+                     scratch.out, scratch.force_norm, scratch.torque_norm );
+  g_sink = scratch.force_norm.empty() ? 0 : scratch.force_norm.back();
+}
+
+// Runs f repeatedly for about seconds and returns nanoseconds per element.
+template<class Function>
+double measure( size_t size, double seconds, Function f )
+{
+  f();
+  size_t iterations = 0;
+  Clock::time_point start = Clock::now();
+  double elapsed = 0;
+  do
+  {
+    for( int k = 0; k < 16; k++ )
+    {
+      f();
+    }
+    iterations += 16;
+    elapsed = std::chrono::duration<double>( Clock::now() - start ).count();
+  }
+  while( elapsed < seconds );
+  return elapsed * 1e9 / ( iterations * size );
+}
+
+struct PerElement
+{
+  const Data& data;
+  void operator()() const { perElement( data ); }
+};
+
+struct Scalar
+{
+  const Data& data;
+  Scratch& scratch;
+  void operator()() const { scalar( data, scratch ); }
+};
+
+struct Kernel
+{
+  const Data& data;
+  Scratch& scratch;
+  void operator()() const { kernel( data, scratch ); }
+};
+}
+
+int main( int argc, char** argv )
+{
+  double seconds = argc > 1 ? std::atof( argv[1] ) : 0.2;
+  const size_t SIZES[] = { 1, 3, 10, 100, 1000, 10000 };
+  std::srand( 1 );
+
+  std::printf( "%8s %12s %12s %12s %10s\n", "elements", "element ns", "scalar ns", "kernel ns", "speedup" );
+  for( size_t s = 0; s < sizeof( SIZES ) / sizeof( SIZES[0] ); s++ )
+  {
+    size_t size = SIZES[s];
+    Data data;
+    makeData( size, data );
+    Scratch scratch;
+    PerElement element_case = { data };
+    Scalar scalar_case = { data, scratch };
+    Kernel kernel_case = { data, scratch };
+    double element_ns = measure( size, seconds, element_case );
+    double scalar_ns = measure( size, seconds, scalar_case );
+    double kernel_ns = measure( size, seconds, kernel_case );
+    std::printf( "%8zu %12.2f %12.2f %12.2f %9.2fx\n", size, element_ns, scalar_ns, kernel_ns, element_ns / kernel_ns );
+  }
+  return 0;
+}
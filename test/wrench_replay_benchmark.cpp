@@ -0,0 +1,580 @@
+// Headless replay benchmark of the wrench display processing.
+//
+// Feeds WrenchStampedArray and WrenchStamped streams through the same
+// code the displays run in a message callback: resolveElements() with a
+// TransformCache, and WrenchHistory::push(). With "pipeline", the messages
+// go through the WrenchPipeline worker instead. Transforms come from a
+// table of fixed poses, so no ROS master, tf, GPU or render window is
+// needed.
+//
+// Array size and History Length are swept over synthetic streams, or a
+// recorded bag is replayed with every History Length. Each case reports:
+//  - per-message latency percentiles
+//  - throughput
+//  - heap allocations per message, in steady state
+//  - peak heap growth
+// as the best of several runs.
+//
+//   rosrun my_rviz_plugin wrench_replay_benchmark
+//       [--baseline FILE] [--write-baseline FILE] [--tolerance 1.0]
+//       [--messages 1000] [--repeat 5] [--bag FILE --topic TOPIC]
+//
+// With --baseline, the run fails with exit code 1 if any case regressed:
+//  - more allocations per message than recorded
+//  - more than 10% more peak memory than recorded
+//  - more p99 latency or less throughput than recorded, by more than the
+//    tolerance, as timings vary between runs
+// --write-baseline records the current results.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <ros/time.h>
+#include <geometry_msgs/WrenchStamped.h>
+#include <my_rviz_plugin/WrenchStampedArray.h>
+
+#ifdef MY_RVIZ_PLUGIN_HAVE_ROSBAG
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#endif
+
+#include "wrench_elements.h"
+#include "wrench_history.h"
+#include "wrench_pipeline.h"
+#include "transform_cache.h"
+#include "wrench_cull_filter.h"
+
+// Every heap allocation of the process goes through these, so that the
+// cases can count allocations and track the live heap. Each block has a
+// header with its size.
+namespace
+{
+const size_t HEADER = 16;
+std::atomic<size_t> g_allocations( 0 );
+std::atomic<size_t> g_live( 0 );
+std::atomic<size_t> g_peak( 0 );
+}
+
+void* operator new( size_t size )
+{
+  char* block = static_cast<char*>( std::malloc( size + HEADER ));
+  if( !block )
+  {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<size_t*>( block ) = size;
+  g_allocations++;
+  size_t live = g_live += size;
+  size_t peak = g_peak.load();
+  while( live > peak && !g_peak.compare_exchange_weak( peak, live ))
+  {
+  }
+  return block + HEADER;
+}
+
+void operator delete( void* p ) noexcept
+{
+  if( !p )
+  {
+    return;
+  }
+  char* block = static_cast<char*>( p ) - HEADER;
+  g_live -= *reinterpret_cast<size_t*>( block );
+  std::free( block );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+  operator delete( p );
+}
+
+namespace
+{
+using namespace my_rviz_plugin;
+
+// Fixed pose per frame, like a static tf tree.
+class StubTransformSource : public TransformSource
+{
+public:
+  virtual bool getTransform( const std::string& frame, const ros::Time&,
+                             Ogre::Vector3& position, Ogre::Quaternion& orientation )
+  {
+    size_t hash = boost::hash<std::string>()( frame );
+    position = Ogre::Vector3( hash % 7, hash % 11, hash % 13 );
+    orientation = Ogre::Quaternion( 0.5f, 0.5f, 0.5f, 0.5f );
+    return true;
+  }
+};
+
+struct Result
+{
+  std::string name;
+  double p50, p90, p99, max;
+  double throughput;
+  double allocations;
+  double peak_kb;
+};
+
+// Measures one case. Peak memory counts from construction, so it includes
+// the history and caches the case sets up; allocations, latency and
+// throughput count from start(), after the warm-up.
+class Measurement
+{
+public:
+  explicit Measurement( size_t messages )
+  {
+    latencies_.reserve( messages );
+    live_ = g_live.load();
+    g_peak = live_;
+  }
+
+  void start()
+  {
+    allocations_ = g_allocations.load();
+    begin_ = ros::WallTime::now();
+  }
+
+  void record( const ros::WallTime& start, const ros::WallTime& end )
+  {
+    latencies_.push_back(( end - start ).toSec() * 1e6 );
+  }
+
+  Result finish( const std::string& name )
+  {
+    double seconds = ( ros::WallTime::now() - begin_ ).toSec();
+    Result result;
+    result.allocations = static_cast<double>( g_allocations.load() - allocations_ ) / latencies_.size();
+    result.name = name;
+    result.peak_kb = ( g_peak.load() - live_ ) / 1024.0;
+    result.throughput = latencies_.size() / seconds;
+    std::sort( latencies_.begin(), latencies_.end() );
+    result.p50 = percentile( 0.5 );
+    result.p90 = percentile( 0.9 );
+    result.p99 = percentile( 0.99 );
+    result.max = latencies_.back();
+    return result;
+  }
+
+private:
+  double percentile( double p ) const
+  {
+    return latencies_[std::min( latencies_.size() - 1, static_cast<size_t>( p * latencies_.size() ))];
+  }
+
+  std::vector<double> latencies_;
+  size_t allocations_;
+  size_t live_;
+  ros::WallTime begin_;
+};
+
+// What a display does in its message callback.
+template<class Elements>
+Result replayDirectOnce( const std::string& name, const std::vector<typename Elements::Message::ConstPtr>& stream,
+                         size_t history_length, size_t messages )
+{
+  Measurement measurement( messages );
+  StubTransformSource source;
+  TransformCache cache;
+  WrenchCullFilter cull;
+  WrenchRecordBatch batch;
+  WrenchHistory history( history_length );
+
+  // Warm up until the history is full, which is the steady state.
+  for( size_t k = 0; k < history_length + stream.size(); k++ )
+  {
+    cache.beginMessage();
+    resolveElements( Elements( *stream[k % stream.size()] ), cull, source, cache, batch );
+    history.push( batch.stamp, batch.glyphs );
+  }
+
+  measurement.start();
+  for( size_t k = 0; k < messages; k++ )
+  {
+    ros::WallTime start = ros::WallTime::now();
+    cache.beginMessage();
+    resolveElements( Elements( *stream[k % stream.size()] ), cull, source, cache, batch );
+    history.push( batch.stamp, batch.glyphs );
+    measurement.record( start, ros::WallTime::now() );
+  }
+  return measurement.finish( name );
+}
+
+// What an array display with "Threaded Processing" does. Latency is from
+// push() to the batch being in the history, so it includes the hand-off
+// to the worker and back.
+Result replayPipelineOnce( const std::string& name, const std::vector<WrenchStampedArray::ConstPtr>& stream,
+                           size_t history_length, size_t messages )
+{
+  Measurement measurement( messages );
+  StubTransformSource source;
+  WrenchPipeline pipeline( &source, 16 );
+  WrenchHistory history( history_length );
+
+  for( size_t k = 0; k < history_length + stream.size() + messages; k++ )
+  {
+    if( k == history_length + stream.size() )
+    {
+      measurement.start();
+    }
+    ros::WallTime start = ros::WallTime::now();
+    pipeline.push( stream[k % stream.size()] );
+    WrenchRecordBatch* batch;
+    while( !( batch = pipeline.pop() ))
+    {
+    }
+    history.push( batch->stamp, batch->glyphs );
+    pipeline.recycle( batch );
+    if( k >= history_length + stream.size() )
+    {
+      measurement.record( start, ros::WallTime::now() );
+    }
+  }
+  return measurement.finish( name );
+}
+
+// The best of two runs of a case. Other processes and frequency scaling
+// only ever make a run slower, so the best of a few runs is what can be
+// compared between runs.
+Result best( const Result& a, const Result& b )
+{
+  Result result = a;
+  result.p50 = std::min( a.p50, b.p50 );
+  result.p90 = std::min( a.p90, b.p90 );
+  result.p99 = std::min( a.p99, b.p99 );
+  result.max = std::min( a.max, b.max );
+  result.throughput = std::max( a.throughput, b.throughput );
+  result.allocations = std::min( a.allocations, b.allocations );
+  result.peak_kb = std::min( a.peak_kb, b.peak_kb );
+  return result;
+}
+
+template<class Elements>
+Result replayDirect( const std::string& name, const std::vector<typename Elements::Message::ConstPtr>& stream,
+                     size_t history_length, size_t messages, int repeats )
+{
+  Result result = replayDirectOnce<Elements>( name, stream, history_length, messages );
+  for( int r = 1; r < repeats; r++ )
+  {
+    result = best( result, replayDirectOnce<Elements>( name, stream, history_length, messages ));
+  }
+  return result;
+}
+
+Result replayPipeline( const std::string& name, const std::vector<WrenchStampedArray::ConstPtr>& stream,
+                       size_t history_length, size_t messages, int repeats )
+{
+  Result result = replayPipelineOnce( name, stream, history_length, messages );
+  for( int r = 1; r < repeats; r++ )
+  {
+    result = best( result, replayPipelineOnce( name, stream, history_length, messages ));
+  }
+  return result;
+}
+
+// A few distinct messages of size elements in eight sensor frames. The
+// elements are stamped 0, so transforms are looked up for every message
+// as with most publishers.
+std::vector<WrenchStampedArray::ConstPtr> syntheticArrays( size_t size )
+{
+  std::vector<WrenchStampedArray::ConstPtr> stream;
+  for( int m = 0; m < 8; m++ )
+  {
+    WrenchStampedArray::Ptr msg( new WrenchStampedArray );
+    msg->header.stamp = ros::Time( 1000 + m, 0 );
+    msg->wrenchstampeds.resize( size );
+    for( size_t i = 0; i < size; i++ )
+    {
+      geometry_msgs::WrenchStamped& element = msg->wrenchstampeds[i];
+      std::ostringstream frame;
+      frame << "sensor_" << i % 8;
+      element.header.frame_id = frame.str();
+      element.wrench.force.x = 10.0 * m + i;
+      element.wrench.force.y = -5.0;
+      element.wrench.force.z = 0.1 * i;
+      element.wrench.torque.x = 0.5;
+      element.wrench.torque.y = m;
+      element.wrench.torque.z = -0.25 * i;
+    }
+    stream.push_back( msg );
+  }
+  return stream;
+}
+
+std::vector<geometry_msgs::WrenchStamped::ConstPtr> syntheticWrenches()
+{
+  std::vector<geometry_msgs::WrenchStamped::ConstPtr> stream;
+  for( int m = 0; m < 8; m++ )
+  {
+    geometry_msgs::WrenchStamped::Ptr msg( new geometry_msgs::WrenchStamped );
+    msg->header.frame_id = "sensor";
+    msg->wrench.force.x = m;
+    msg->wrench.torque.z = -m;
+    stream.push_back( msg );
+  }
+  return stream;
+}
+
+std::string caseName( const char* path, const char* input, size_t size, size_t history_length )
+{
+  std::ostringstream name;
+  name << path << "/" << input << "/size=" << size << "/history=" << history_length;
+  return name.str();
+}
+
+bool readBaseline( const std::string& path, std::map<std::string, Result>& baseline )
+{
+  std::ifstream file( path.c_str() );
+  if( !file )
+  {
+    return false;
+  }
+  std::string line;
+  while( std::getline( file, line ))
+  {
+    if( line.empty() || line[0] == '#' )
+    {
+      continue;
+    }
+    std::istringstream fields( line );
+    Result result = Result();
+    if( fields >> result.name >> result.p99 >> result.throughput >> result.allocations >> result.peak_kb )
+    {
+      baseline[result.name] = result;
+    }
+  }
+  return true;
+}
+
+bool writeBaseline( const std::string& path, const std::vector<Result>& results )
+{
+  std::ofstream file( path.c_str() );
+  file << "# Written by wrench_replay_benchmark --write-baseline\n"
+       << "# case p99_us throughput_msgs_per_s allocations_per_msg peak_kb\n";
+  for( size_t i = 0; i < results.size(); i++ )
+  {
+    const Result& r = results[i];
+    file << r.name << " " << r.p99 << " " << r.throughput << " " << r.allocations << " " << r.peak_kb << "\n";
+  }
+  return file.good();
+}
+
+// Prints the regressions of result against baseline and returns their number.
+int compare( const Result& result, const Result& baseline, double tolerance )
+{
+  int regressions = 0;
+  if( result.allocations > baseline.allocations + 0.5 )
+  {
+    std::printf( "REGRESSION %s: %.1f allocations per message, baseline %.1f\n",
+                 result.name.c_str(), result.allocations, baseline.allocations );
+    regressions++;
+  }
+  if( result.peak_kb > baseline.peak_kb * 1.1 + 64 )
+  {
+    std::printf( "REGRESSION %s: peak %.0f kB, baseline %.0f kB\n",
+                 result.name.c_str(), result.peak_kb, baseline.peak_kb );
+    regressions++;
+  }
+  if( result.p99 > baseline.p99 * ( 1 + tolerance ))
+  {
+    std::printf( "REGRESSION %s: p99 latency %.1f us, baseline %.1f us\n",
+                 result.name.c_str(), result.p99, baseline.p99 );
+    regressions++;
+  }
+  if( result.throughput < baseline.throughput / ( 1 + tolerance ))
+  {
+    std::printf( "REGRESSION %s: %.0f messages/s, baseline %.0f messages/s\n",
+                 result.name.c_str(), result.throughput, baseline.throughput );
+    regressions++;
+  }
+  return regressions;
+}
+
+#ifdef MY_RVIZ_PLUGIN_HAVE_ROSBAG
+// Reads the WrenchStampedArray or WrenchStamped messages of topic.
+bool readBag( const std::string& path, const std::string& topic,
+              std::vector<WrenchStampedArray::ConstPtr>& arrays,
+              std::vector<geometry_msgs::WrenchStamped::ConstPtr>& wrenches )
+{
+  try
+  {
+    rosbag::Bag bag( path, rosbag::bagmode::Read );
+    rosbag::View view( bag, rosbag::TopicQuery( topic ));
+    for( rosbag::View::iterator it = view.begin(); it != view.end(); ++it )
+    {
+      if( WrenchStampedArray::ConstPtr array = it->instantiate<WrenchStampedArray>() )
+      {
+        arrays.push_back( array );
+      }
+      else if( geometry_msgs::WrenchStamped::ConstPtr wrench = it->instantiate<geometry_msgs::WrenchStamped>() )
+      {
+        wrenches.push_back( wrench );
+      }
+    }
+  }
+  catch( const rosbag::BagException& e )
+  {
+    std::fprintf( stderr, "Cannot read '%s': %s\n", path.c_str(), e.what() );
+    return false;
+  }
+  return true;
+}
+#endif
+}
+
+int main( int argc, char** argv )
+{
+  std::string baseline_path, write_path, bag_path, topic;
+  double tolerance = 1.0;
+  size_t messages = 1000;
+  int repeats = 5;
+  for( int i = 1; i < argc; i++ )
+  {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if( arg == "--baseline" && has_value )
+    {
+      baseline_path = argv[++i];
+    }
+    else if( arg == "--write-baseline" && has_value )
+    {
+      write_path = argv[++i];
+    }
+    else if( arg == "--tolerance" && has_value )
+    {
+      tolerance = std::atof( argv[++i] );
+    }
+    else if( arg == "--messages" && has_value )
+    {
+      messages = std::max( 1, std::atoi( argv[++i] ));
+    }
+    else if( arg == "--repeat" && has_value )
+    {
+      repeats = std::max( 1, std::atoi( argv[++i] ));
+    }
+    else if( arg == "--bag" && has_value )
+    {
+      bag_path = argv[++i];
+    }
+    else if( arg == "--topic" && has_value )
+    {
+      topic = argv[++i];
+    }
+    else
+    {
+      std::fprintf( stderr, "usage: %s [--baseline FILE] [--write-baseline FILE] [--tolerance T] "
+                    "[--messages N] [--repeat N] [--bag FILE --topic TOPIC]\n", argv[0] );
+      return 2;
+    }
+  }
+
+  // Stamps and log throttling need a clock, but no master.
+  ros::Time::init();
+
+  const size_t HISTORY_LENGTHS[] = { 1, 100, 1000 };
+  const size_t SIZES[] = { 1, 10, 100, 1000 };
+  std::vector<Result> results;
+
+  if( !bag_path.empty() )
+  {
+#ifdef MY_RVIZ_PLUGIN_HAVE_ROSBAG
+    std::vector<WrenchStampedArray::ConstPtr> arrays;
+    std::vector<geometry_msgs::WrenchStamped::ConstPtr> wrenches;
+    if( !readBag( bag_path, topic, arrays, wrenches ))
+    {
+      return 2;
+    }
+    if( arrays.empty() && wrenches.empty() )
+    {
+      std::fprintf( stderr, "No WrenchStampedArray or WrenchStamped messages on '%s'\n", topic.c_str() );
+      return 2;
+    }
+    for( size_t h = 0; h < sizeof( HISTORY_LENGTHS ) / sizeof( HISTORY_LENGTHS[0] ); h++ )
+    {
+      size_t length = HISTORY_LENGTHS[h];
+      if( !arrays.empty() )
+      {
+        size_t size = arrays.front()->wrenchstampeds.size();
+        results.push_back( replayDirect<WrenchStampedArrayElements>(
+                caseName( "array", "bag", size, length ), arrays, length, messages, repeats ));
+        results.push_back( replayPipeline( caseName( "pipeline", "bag", size, length ), arrays, length, messages, repeats ));
+      }
+      else
+      {
+        results.push_back( replayDirect<WrenchStampedElements>(
+                caseName( "single", "bag", 1, length ), wrenches, length, messages, repeats ));
+      }
+    }
+#else
+    std::fprintf( stderr, "Built without rosbag, --bag is not available\n" );
+    return 2;
+#endif
+  }
+  else
+  {
+    std::vector<geometry_msgs::WrenchStamped::ConstPtr> wrenches = syntheticWrenches();
+    for( size_t h = 0; h < sizeof( HISTORY_LENGTHS ) / sizeof( HISTORY_LENGTHS[0] ); h++ )
+    {
+      size_t length = HISTORY_LENGTHS[h];
+      results.push_back( replayDirect<WrenchStampedElements>(
+              caseName( "single", "synthetic", 1, length ), wrenches, length, messages, repeats ));
+      for( size_t s = 0; s < sizeof( SIZES ) / sizeof( SIZES[0] ); s++ )
+      {
+        std::vector<WrenchStampedArray::ConstPtr> arrays = syntheticArrays( SIZES[s] );
+        results.push_back( replayDirect<WrenchStampedArrayElements>(
+                caseName( "array", "synthetic", SIZES[s], length ), arrays, length, messages, repeats ));
+        results.push_back( replayPipeline(
+                caseName( "pipeline", "synthetic", SIZES[s], length ), arrays, length, messages, repeats ));
+      }
+    }
+  }
+
+  std::printf( "%-42s %9s %9s %9s %9s %12s %8s %10s\n",
+               "case", "p50 us", "p90 us", "p99 us", "max us", "msgs/s", "allocs", "peak kB" );
+  for( size_t i = 0; i < results.size(); i++ )
+  {
+    const Result& r = results[i];
+    std::printf( "%-42s %9.1f %9.1f %9.1f %9.1f %12.0f %8.1f %10.0f\n",
+                 r.name.c_str(), r.p50, r.p90, r.p99, r.max, r.throughput, r.allocations, r.peak_kb );
+  }
+
+  if( !write_path.empty() && !writeBaseline( write_path, results ))
+  {
+    std::fprintf( stderr, "Cannot write '%s'\n", write_path.c_str() );
+    return 2;
+  }
+
+  if( baseline_path.empty() )
+  {
+    return 0;
+  }
+  std::map<std::string, Result> baseline;
+  if( !readBaseline( baseline_path, baseline ))
+  {
+    std::fprintf( stderr, "Cannot read '%s'\n", baseline_path.c_str() );
+    return 2;
+  }
+  int regressions = 0;
+  for( size_t i = 0; i < results.size(); i++ )
+  {
+    std::map<std::string, Result>::const_iterator it = baseline.find( results[i].name );
+    if( it == baseline.end() )
+    {
+      std::printf( "NEW %s: not in the baseline\n", results[i].name.c_str() );
+      continue;
+    }
+    regressions += compare( results[i], it->second, tolerance );
+  }
+  std::printf( "%d regressions against '%s'\n", regressions, baseline_path.c_str() );
+  return regressions > 0 ? 1 : 0;
+}